@@ -0,0 +1,53 @@
+#version 430
+#extension GL_ARB_shader_draw_parameters : enable
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal; // Adding normal attribute
+layout(location = 3) in vec2 texCoord; // Add texture coordinate attribute
+
+// Fallback for the draw index when gl_DrawIDARB is not available. Sourced
+// with a divisor of one, starting at each command's baseInstance. See
+// MultiDrawList in main/multi_draw.hpp
+layout(location = 4) in uint drawIndex;
+
+#ifdef GL_ARB_shader_draw_parameters
+#   define DRAW_ID gl_DrawIDARB
+#else
+#   define DRAW_ID drawIndex
+#endif
+
+#include "frame_block.glsl"
+
+// Per-draw data, one element per command of the multi-draw. Keep in sync
+// with DrawData in main/uniform_blocks.hpp
+struct Draw
+{
+    mat4 model;
+    uint flags;
+};
+
+layout(std430, row_major, binding = 1) readonly buffer Draws
+{
+    Draw draws[];
+};
+
+out vec3 fragColor;
+out vec3 fragPosition; // World-space position for the point lights
+out vec3 fragNormal; // Output the normal to the fragment shader
+out vec2 fragTexCoord; // Output the texture coordinate to the fragment shader
+flat out uint fragFlags;
+
+// Must match depth.vert bit for bit (depth pre-pass with GL_EQUAL)
+invariant gl_Position;
+
+void main() {
+    mat4 model = draws[DRAW_ID].model;
+    vec4 worldPosition = model * vec4(position, 1.0);
+    gl_Position = projView * worldPosition;
+    fragColor = color;
+    fragPosition = worldPosition.xyz;
+    fragNormal = mat3(model) * normal; // Models are rigid, no inverse-transpose needed
+    fragTexCoord = texCoord;
+    fragFlags = draws[DRAW_ID].flags;
+}
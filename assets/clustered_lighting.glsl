@@ -0,0 +1,68 @@
+// Clustered point lights, shared by default.frag and deferred.frag (which
+// #include this file; see ShaderProgram). Needs the Frame block for view.
+// Keep in sync with ClusterUniforms and PointLightData in
+// main/uniform_blocks.hpp, and see ClusteredLights in
+// main/clustered_lights.hpp
+layout(std140, binding = 2) uniform Clusters
+{
+    uvec3 clusterGridSize;
+    uint lightCount;
+    vec2 clusterTileSize; // pixels
+    float clusterSliceScale;
+    float clusterSliceBias;
+};
+
+struct PointLight
+{
+    vec4 positionRadius; // xyz = world-space position, w = radius
+    vec4 color;
+};
+
+layout(std430, binding = 2) readonly buffer Lights
+{
+    PointLight lights[];
+};
+
+// (first index, count) into lightIndices, per cluster
+layout(std430, binding = 3) readonly buffer ClusterRanges
+{
+    uvec2 clusterRanges[];
+};
+
+layout(std430, binding = 4) readonly buffer LightIndices
+{
+    uint lightIndices[];
+};
+
+uint cluster_index(vec3 worldPosition) {
+    float viewDepth = -(view * vec4(worldPosition, 1.0)).z;
+
+    uvec3 cell;
+    cell.xy = uvec2(gl_FragCoord.xy / clusterTileSize);
+    cell.z = uint(max(log(viewDepth) * clusterSliceScale + clusterSliceBias, 0.0));
+    cell = min(cell, clusterGridSize - 1u);
+
+    return cell.x + clusterGridSize.x * (cell.y + clusterGridSize.y * cell.z);
+}
+
+// Diffuse light from the point lights that overlap this fragment's cluster
+vec3 point_lighting(vec3 worldPosition, vec3 norm) {
+    vec3 result = vec3(0.0);
+
+    uvec2 range = clusterRanges[cluster_index(worldPosition)];
+    for (uint i = range.x; i < range.x + range.y; ++i) {
+        PointLight light = lights[lightIndices[i]];
+
+        vec3 toLight = light.positionRadius.xyz - worldPosition;
+        float dist = length(toLight);
+
+        // Inverse square falloff, windowed to reach zero at the radius
+        float window = clamp(1.0 - pow(dist / light.positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (dist * dist + 1.0);
+
+        float diffI = max(dot(norm, toLight / max(dist, 1e-4)), 0.0);
+        result += diffI * attenuation * light.color.rgb;
+    }
+
+    return result;
+}
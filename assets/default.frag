@@ -1,68 +1,84 @@
 #version 430
 
+// Variants (see ShaderVariants in support/shader_variants.hpp and the
+// kShade* features in main/main.cpp). Each is 0 or 1; disabled features are
+// compiled out, along with the resources that only they use.
+//  SHADE_TEXTURED: modulate by textureSampler
+//  SHADE_LIT: ambient and directional light (otherwise unlit)
+//  SHADE_POINT_LIGHTS: clustered point lights
+//  SHADE_PER_DRAW_LIGHTING: point lights only for draws with
+//      OBJECT_FLAG_APPLY_LIGHTING (otherwise for all fragments)
+#ifndef SHADE_TEXTURED
+#   define SHADE_TEXTURED 1
+#endif
+#ifndef SHADE_LIT
+#   define SHADE_LIT 1
+#endif
+#ifndef SHADE_POINT_LIGHTS
+#   define SHADE_POINT_LIGHTS 1
+#endif
+#ifndef SHADE_PER_DRAW_LIGHTING
+#   define SHADE_PER_DRAW_LIGHTING 1
+#endif
+
 in vec3 fragPosition;
 in vec3 fragNormal;
 in vec2 fragTexCoord;
 in vec3 fragColor;
+flat in uint fragFlags;
 
+#if SHADE_TEXTURED
 uniform sampler2D textureSampler;
-uniform bool applyLighting; // Uniform to toggle point lighting for specific objects
+#endif
 
-// Uniforms for the directional light
-uniform vec3 dirLightDirection;
-uniform vec3 dirLightColor;
-uniform vec3 ambientColor;
+#include "object_flags.glsl"
 
-// Uniforms for the point lights
-uniform vec3 lightPos1;
-uniform vec3 lightColor1;
-uniform vec3 lightPos2;
-uniform vec3 lightColor2;
-uniform vec3 lightPos3;
-uniform vec3 lightColor3;
+#include "frame_block.glsl"
 
-out vec4 outColor;
+#if SHADE_LIT && SHADE_POINT_LIGHTS
+#   include "clustered_lighting.glsl"
+#endif
 
+out vec4 outColor;
 
 void main() {
+#if SHADE_TEXTURED
     vec4 texColor = texture(textureSampler, fragTexCoord);
+#else
+    vec4 texColor = vec4(1.0);
+#endif
+
+#if SHADE_LIT
     vec3 norm = normalize(fragNormal);
     vec3 lightResult = vec3(0.0);
 
     // Ambient lighting
-    vec3 ambient = ambientColor * texColor.rgb;
+    vec3 ambient = ambientColor.rgb * texColor.rgb;
 
     // Directional lighting
-    vec3 lightDir = normalize(-dirLightDirection);
+    vec3 lightDir = normalize(-dirLightDirection.xyz);
     float diffDir = max(dot(norm, lightDir), 0.0);
-    vec3 diffuseDir = diffDir * dirLightColor;
+    vec3 diffuseDir = diffDir * dirLightColor.rgb;
 
     // Add the result of directional lighting to the final result
     lightResult += diffuseDir;
 
-    if (applyLighting) {
-        // Point lighting is enabled for this object
-
-        // Point light 1
-        vec3 lightDir1 = normalize(lightPos1 - fragPosition);
-        float diff1 = max(dot(norm, lightDir1), 0.0);
-        vec3 diffuse1 = diff1 * lightColor1;
-
-        // Point light 2
-        vec3 lightDir2 = normalize(lightPos2 - fragPosition);
-        float diff2 = max(dot(norm, lightDir2), 0.0);
-        vec3 diffuse2 = diff2 * lightColor2;
-
-        // Point light 2
-        vec3 lightDir3 = normalize(lightPos3 - fragPosition);
-        float diff3 = max(dot(norm, lightDir3), 0.0);
-        vec3 diffuse3 = diff3 * lightColor3;
-
-        // Add the point lighting results
-        lightResult += (diffuse1 + diffuse2 + diffuse3);
+#   if SHADE_POINT_LIGHTS
+#       if SHADE_PER_DRAW_LIGHTING
+    if (0u != (fragFlags & OBJECT_FLAG_APPLY_LIGHTING))
+#       endif
+    {
+        // Point lighting is enabled for this object. Only the lights that
+        // overlap this fragment's cluster are evaluated.
+        lightResult += point_lighting(fragPosition, norm);
     }
+#   endif
 
     // Combine the ambient light with the calculated lighting and apply it to the texture color
     vec3 finalColor = (ambient + lightResult) * texColor.rgb * fragColor;
+#else
+    vec3 finalColor = texColor.rgb * fragColor;
+#endif
+
     outColor = vec4(finalColor, texColor.a);
-}
\ No newline at end of file
+}
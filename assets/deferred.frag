@@ -0,0 +1,57 @@
+#version 430
+
+// Lighting pass of the deferred path, drawn as a full-screen triangle
+// (fullscreen.vert). Reads the G-buffer written by gbuffer.frag and shades
+// each pixel once, with the same lights and clusters as default.frag.
+
+layout(binding = 0) uniform sampler2D gbufferAlbedo;
+layout(binding = 1) uniform sampler2D gbufferNormal;
+layout(binding = 2) uniform sampler2D gbufferDepth;
+
+// Inverse of Frame.projView, to reconstruct world-space positions from depth
+uniform mat4 invProjView;
+
+#include "frame_block.glsl"
+
+#include "clustered_lighting.glsl"
+
+in vec2 fragTexCoord;
+
+out vec4 outColor;
+
+// Inverse of oct_encode() in gbuffer.frag
+vec2 sign_not_zero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 oct_decode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+    return normalize(n);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+
+    float depth = texelFetch(gbufferDepth, pixel, 0).r;
+    if (depth >= 1.0)
+        discard; // Background
+
+    vec4 clip = invProjView * vec4(vec3(fragTexCoord, depth) * 2.0 - 1.0, 1.0);
+    vec3 worldPosition = clip.xyz / clip.w;
+
+    vec4 albedo = texelFetch(gbufferAlbedo, pixel, 0);
+    vec3 norm = oct_decode(texelFetch(gbufferNormal, pixel, 0).xy);
+
+    // Ambient and directional lighting
+    vec3 lightDir = normalize(-dirLightDirection.xyz);
+    vec3 lightResult = ambientColor.rgb + max(dot(norm, lightDir), 0.0) * dirLightColor.rgb;
+
+    if (albedo.a > 0.5) {
+        // Point lights of this pixel's cluster
+        lightResult += point_lighting(worldPosition, norm);
+    }
+
+    outColor = vec4(lightResult * albedo.rgb, 1.0);
+}
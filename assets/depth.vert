@@ -0,0 +1,43 @@
+#version 430
+#extension GL_ARB_shader_draw_parameters : enable
+
+// Depth-only vertex shader for the depth pre-pass. Draws the same
+// multi-draw commands as batched.vert, with a position-only VAO and without
+// a fragment shader.
+//
+// gl_Position must be bit-identical to batched.vert, as the colour pass tests
+// against the pre-pass depth with GL_EQUAL. Both shaders therefore declare it
+// invariant and compute it with the same expression.
+
+layout(location = 0) in vec3 position;
+
+// See batched.vert
+layout(location = 4) in uint drawIndex;
+
+#ifdef GL_ARB_shader_draw_parameters
+#   define DRAW_ID gl_DrawIDARB
+#else
+#   define DRAW_ID drawIndex
+#endif
+
+#include "frame_block.glsl"
+
+// Per-draw data. Keep in sync with DrawData in main/uniform_blocks.hpp
+struct Draw
+{
+    mat4 model;
+    uint flags;
+};
+
+layout(std430, row_major, binding = 1) readonly buffer Draws
+{
+    Draw draws[];
+};
+
+invariant gl_Position;
+
+void main() {
+    mat4 model = draws[DRAW_ID].model;
+    vec4 worldPosition = model * vec4(position, 1.0);
+    gl_Position = projView * worldPosition;
+}
@@ -0,0 +1,12 @@
+// Per-frame data, shared by all shaders that draw the scene (which #include
+// this file; see ShaderProgram). Keep in sync with FrameUniforms in
+// main/uniform_blocks.hpp
+layout(std140, row_major, binding = 0) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 projView;
+    vec4 dirLightDirection;
+    vec4 dirLightColor;
+    vec4 ambientColor;
+};
@@ -0,0 +1,12 @@
+#version 430
+
+// Full-screen triangle, generated from gl_VertexID. Draw three vertices with
+// an empty VAO; the triangle covers the viewport with a single primitive.
+
+out vec2 fragTexCoord;
+
+void main() {
+    vec2 p = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    fragTexCoord = p;
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,38 @@
+#version 430
+
+// Geometry pass of the deferred path: writes the surface attributes into the
+// G-buffer (see GBuffer in main/gbuffer.hpp). Lighting happens later, once
+// per pixel, in deferred.frag.
+
+in vec3 fragPosition;
+in vec3 fragNormal;
+in vec2 fragTexCoord;
+in vec3 fragColor;
+flat in uint fragFlags;
+
+uniform sampler2D textureSampler;
+
+#include "object_flags.glsl"
+
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec2 outNormal;
+
+// Octahedral normal encoding: the unit sphere is projected onto the
+// octahedron |x|+|y|+|z| = 1, whose lower half is folded over the upper
+// half, giving a square. Decoded by oct_decode() in deferred.frag.
+vec2 sign_not_zero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 oct_encode(vec3 n) {
+    vec2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    return n.z >= 0.0 ? p : (1.0 - abs(p.yx)) * sign_not_zero(p);
+}
+
+void main() {
+    vec4 texColor = texture(textureSampler, fragTexCoord);
+
+    float applyLighting = (0u != (fragFlags & OBJECT_FLAG_APPLY_LIGHTING)) ? 1.0 : 0.0;
+    outAlbedo = vec4(texColor.rgb * fragColor, applyLighting);
+    outNormal = oct_encode(normalize(fragNormal));
+}
@@ -0,0 +1,43 @@
+#version 430
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal; // Adding normal attribute
+layout(location = 3) in vec2 texCoord; // Add texture coordinate attribute
+
+#include "frame_block.glsl"
+
+// Per-instance data, indexed by gl_InstanceID. The range for the current
+// draw is selected with glBindBufferRange(). Keep in sync with InstanceData
+// in main/uniform_blocks.hpp
+struct Instance
+{
+    mat4 model;
+    uint flags;
+};
+
+layout(std430, row_major, binding = 0) readonly buffer Instances
+{
+    Instance instances[];
+};
+
+out vec3 fragColor;
+out vec3 fragPosition; // World-space position for the point lights
+out vec3 fragNormal; // Output the normal to the fragment shader
+out vec2 fragTexCoord; // Output the texture coordinate to the fragment shader
+flat out uint fragFlags;
+
+// The depth pre-pass draws the instances with this shader alone; the colour
+// pass then tests against its depth with GL_EQUAL.
+invariant gl_Position;
+
+void main() {
+    mat4 model = instances[gl_InstanceID].model;
+    vec4 worldPosition = model * vec4(position, 1.0);
+    gl_Position = projView * worldPosition;
+    fragColor = color;
+    fragPosition = worldPosition.xyz;
+    fragNormal = mat3(model) * normal; // Models are rigid, no inverse-transpose needed
+    fragTexCoord = texCoord;
+    fragFlags = instances[gl_InstanceID].flags;
+}
@@ -0,0 +1,4 @@
+// Bits of the per-draw flags (Draw::flags, terrainFlags), which reach the
+// fragment shaders as fragFlags. Shared by default.frag and gbuffer.frag.
+// Keep in sync with the kObjectFlag* constants in main/uniform_blocks.hpp
+#define OBJECT_FLAG_APPLY_LIGHTING 1u // Toggle point lighting for specific objects
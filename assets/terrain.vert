@@ -0,0 +1,13 @@
+#version 430
+
+// Tessellated terrain (see TessellatedTerrain in main/tessellated_terrain.hpp).
+// The vertices are the patch corners, in grid units; terrain.tesc and
+// terrain.tese place them in the world.
+
+layout(location = 0) in vec2 gridCorner;
+
+out vec2 tcsGridCorner;
+
+void main() {
+    tcsGridCorner = gridCorner;
+}
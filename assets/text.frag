@@ -0,0 +1,19 @@
+#version 430
+
+// Glyphs are coverage masks in the red channel of the atlas. Rectangles have
+// negative texture coordinates and are drawn in their flat colour.
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+layout(binding = 0) uniform sampler2D glyphAtlas;
+
+out vec4 outColor;
+
+void main() {
+    float coverage = 1.0;
+    if (fragTexCoord.x >= 0.0)
+        coverage = texture(glyphAtlas, fragTexCoord / vec2(textureSize(glyphAtlas, 0))).r;
+
+    outColor = vec4(fragColor.rgb, fragColor.a * coverage);
+}
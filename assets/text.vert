@@ -0,0 +1,25 @@
+#version 430
+
+// Screen-space text and rectangles of the HUD (see TextRenderer in
+// main/text_renderer.hpp). Positions are in pixels with the origin at the
+// top-left corner; texture coordinates are in texels of the glyph atlas.
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 texCoord;
+layout(location = 2) in vec4 color;
+
+uniform vec2 viewportSize;
+
+out vec2 fragTexCoord;
+out vec4 fragColor;
+
+void main() {
+    fragTexCoord = texCoord;
+
+    // Colours are given in sRGB, but are blended and written to an sRGB
+    // framebuffer in linear space.
+    fragColor = vec4(pow(color.rgb, vec3(2.2)), color.a);
+
+    vec2 ndc = position / viewportSize * 2.0 - 1.0;
+    gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+}
@@ -0,0 +1,96 @@
+#include "bench.hpp"
+
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#include "../support/hash.hpp"
+
+namespace
+{
+	constexpr float kPi_ = 3.1415926f;
+
+	void write_scopes_( std::FILE* aOut, std::vector<Profiler::ScopeStats> const& aScopes, Profiler::Track aTrack )
+	{
+		std::fprintf( aOut, "{" );
+
+		bool first = true;
+		for( auto const& scope : aScopes )
+		{
+			if( aTrack != scope.track )
+				continue;
+
+			std::fprintf( aOut, "%s\n    ", first ? "" : "," );
+			write_json_string( aOut, scope.name );
+			std::fprintf( aOut, ": { \"samples\": %zu, \"min\": %.4f, \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+				scope.samples,
+				double(scope.minMs), double(scope.avgMs),
+				double(scope.p50Ms), double(scope.p95Ms), double(scope.p99Ms),
+				double(scope.maxMs)
+			);
+
+			first = false;
+		}
+
+		std::fprintf( aOut, first ? "}" : "\n  }" );
+	}
+}
+
+BenchCamera bench_camera( std::size_t aFrame, std::size_t aFrameCount ) noexcept
+{
+	// Half an orbit, swinging up and down once and moving in towards the
+	// middle of the path, then holding still for kBenchHoldFrames frames.
+	auto const pathFrames = aFrameCount > kBenchHoldFrames + 1 ? aFrameCount - kBenchHoldFrames - 1 : 1;
+	float const t = std::min( float(aFrame) / float(pathFrames), 1.f );
+
+	BenchCamera camera;
+	camera.phi = kPi_ * t;
+	camera.theta = 0.15f * std::sin( 2.f * kPi_ * t );
+	camera.radius = 10.f - 4.f * std::sin( kPi_ * t );
+	return camera;
+}
+
+std::uint64_t image_checksum( std::vector<std::uint8_t> const& aPixels ) noexcept
+{
+	return hash_bytes( aPixels.data(), aPixels.size() );
+}
+
+bool write_bench_json( std::FILE* aOut, BenchResults const& aResults )
+{
+	assert( aOut );
+
+	auto sorted = aResults.frameMs;
+	std::sort( sorted.begin(), sorted.end() );
+
+	double sum = 0.0;
+	for( auto const ms : sorted )
+		sum += double(ms);
+
+	std::fprintf( aOut, "{\n  \"renderer\": " );
+	write_json_string( aOut, aResults.renderer.c_str() );
+	std::fprintf( aOut, ",\n  \"width\": %d,\n  \"height\": %d,\n", int(aResults.width), int(aResults.height) );
+	std::fprintf( aOut, "  \"frames\": %zu,\n  \"warmup_frames\": %zu,\n  \"seconds\": %.4f,\n", sorted.size(), aResults.warmupFrames, sum * 1e-3 );
+
+	if( !sorted.empty() )
+	{
+		std::fprintf( aOut, "  \"frame_ms\": { \"min\": %.4f, \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+			double(sorted.front()), sum / double(sorted.size()),
+			double(percentile( sorted, 50.f )), double(percentile( sorted, 95.f )), double(percentile( sorted, 99.f )),
+			double(sorted.back())
+		);
+	}
+	else
+	{
+		std::fprintf( aOut, "  \"frame_ms\": null,\n" );
+	}
+
+	std::fprintf( aOut, "  \"cpu_ms\": " );
+	write_scopes_( aOut, aResults.scopes, Profiler::Track::Cpu );
+	std::fprintf( aOut, ",\n  \"gpu_ms\": " );
+	write_scopes_( aOut, aResults.scopes, Profiler::Track::Gpu );
+
+	std::fprintf( aOut, ",\n  \"checksum\": \"%016llx\"\n}\n", (unsigned long long)aResults.checksum );
+
+	return !std::ferror( aOut );
+}
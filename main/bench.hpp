@@ -0,0 +1,67 @@
+#ifndef BENCH_HPP_2F86D0A4_97B1_4C3E_A7D5_1E4C08F6B92D
+#define BENCH_HPP_2F86D0A4_97B1_4C3E_A7D5_1E4C08F6B92D
+
+#include <glad.h>
+
+#include <string>
+#include <vector>
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+#include "../support/profiler.hpp"
+
+/* Scripted headless benchmark (--bench)
+ *
+ * The camera follows a fixed path (bench_camera()), and the animation
+ * advances by kBenchFrameSeconds per frame regardless of how long a frame
+ * took, so that every run renders the same frames. The last
+ * kBenchHoldFrames frames keep the camera still, so that the final image
+ * does not depend on when the asynchronous occlusion readbacks arrived;
+ * its checksum can therefore be compared between runs.
+ *
+ * The results are written as JSON by write_bench_json():
+ *
+ *   {
+ *     "renderer": "...", "width": 1280, "height": 720,
+ *     "frames": 300, "warmup_frames": 10, "seconds": 4.56,
+ *     "frame_ms": { "min": ..., "avg": ..., "p50": ..., "p95": ..., "p99": ..., "max": ... },
+ *     "cpu_ms": { "<scope>": { "samples": ..., "min": ..., ... }, ... },
+ *     "gpu_ms": { "<scope>": { ... }, ... },
+ *     "checksum": "0123456789abcdef"
+ *   }
+ *
+ * frame_ms is the wall-clock time of each measured frame. The CPU and GPU
+ * times are the Profiler scopes over the measured frames (at most the last
+ * Profiler::kStatsWindow of them). The checksum is the 64-bit FNV-1a hash
+ * of the RGBA8 pixels of the final frame.
+ */
+constexpr float kBenchFrameSeconds = 1.f / 60.f;
+constexpr std::size_t kBenchHoldFrames = 8;
+
+struct BenchCamera
+{
+	float phi, theta;
+	float radius;
+};
+
+BenchCamera bench_camera( std::size_t aFrame, std::size_t aFrameCount ) noexcept;
+
+struct BenchResults
+{
+	std::string renderer;
+	GLsizei width, height;
+
+	std::size_t warmupFrames;
+	std::vector<float> frameMs; // Measured frames only
+
+	std::vector<Profiler::ScopeStats> scopes;
+	std::uint64_t checksum;
+};
+
+std::uint64_t image_checksum( std::vector<std::uint8_t> const& aPixels ) noexcept;
+
+bool write_bench_json( std::FILE*, BenchResults const& );
+
+#endif // BENCH_HPP_2F86D0A4_97B1_4C3E_A7D5_1E4C08F6B92D
@@ -0,0 +1,256 @@
+#include "bvh.hpp"
+
+#include <cassert>
+
+DynamicBvh::ProxyId DynamicBvh::insert( AABB const& aBox, std::uint32_t aUserData )
+{
+	auto const leaf = allocate_node_();
+
+	auto& node = mNodes[leaf];
+	node.box = aBox;
+	node.userData = aUserData;
+
+	insert_leaf_( leaf );
+	++mLeafCount;
+
+	return leaf;
+}
+
+void DynamicBvh::remove( ProxyId aProxy )
+{
+	assert( aProxy < mNodes.size() && kNull_ == mNodes[aProxy].left );
+
+	remove_leaf_( aProxy );
+	free_node_( aProxy );
+	--mLeafCount;
+}
+
+void DynamicBvh::update( ProxyId aProxy, AABB const& aBox )
+{
+	assert( aProxy < mNodes.size() && kNull_ == mNodes[aProxy].left );
+
+	mNodes[aProxy].box = aBox;
+	refit_( mNodes[aProxy].parent );
+}
+
+AABB const& DynamicBvh::bounds( ProxyId aProxy ) const noexcept
+{
+	assert( aProxy < mNodes.size() );
+	return mNodes[aProxy].box;
+}
+std::uint32_t DynamicBvh::user_data( ProxyId aProxy ) const noexcept
+{
+	assert( aProxy < mNodes.size() );
+	return mNodes[aProxy].userData;
+}
+
+DynamicBvh::CullStats DynamicBvh::cull( Frustum const& aFrustum, std::vector<std::uint32_t>& aVisible ) const
+{
+	CullStats stats{ 0, 0, 0 };
+	if( kNull_ == mRoot )
+		return stats;
+
+	mStack.clear();
+	mStack.emplace_back( mRoot );
+
+	while( !mStack.empty() )
+	{
+		auto const id = mStack.back();
+		mStack.pop_back();
+
+		auto const& node = mNodes[id];
+		++stats.nodesTested;
+
+		auto const result = test( aFrustum, node.box );
+		if( FrustumTest::outside == result )
+			continue;
+
+		if( FrustumTest::inside == result || kNull_ == node.left )
+		{
+			collect_( id, aVisible, stats );
+			continue;
+		}
+
+		mStack.emplace_back( node.left );
+		mStack.emplace_back( node.right );
+	}
+
+	stats.culled = mLeafCount - stats.visible;
+	return stats;
+}
+
+std::size_t DynamicBvh::size() const noexcept
+{
+	return mLeafCount;
+}
+
+DynamicBvh::NodeId_ DynamicBvh::allocate_node_()
+{
+	NodeId_ id;
+	if( kNull_ != mFreeList )
+	{
+		id = mFreeList;
+		mFreeList = mNodes[id].parent;
+	}
+	else
+	{
+		id = NodeId_(mNodes.size());
+		mNodes.emplace_back();
+	}
+
+	mNodes[id] = Node_{ kEmptyAABB, kNull_, kNull_, kNull_, 0 };
+	return id;
+}
+void DynamicBvh::free_node_( NodeId_ aNode )
+{
+	mNodes[aNode].parent = mFreeList;
+	mFreeList = aNode;
+}
+
+void DynamicBvh::insert_leaf_( NodeId_ aLeaf )
+{
+	if( kNull_ == mRoot )
+	{
+		mRoot = aLeaf;
+		mNodes[aLeaf].parent = kNull_;
+		return;
+	}
+
+	// Find the best sibling. At each step, the cost of pairing the leaf with
+	// the current node is compared against the (lower bound of the) cost of
+	// descending into either child. Costs are surface areas.
+	auto const leafBox = mNodes[aLeaf].box;
+
+	NodeId_ index = mRoot;
+	while( kNull_ != mNodes[index].left )
+	{
+		auto const& node = mNodes[index];
+
+		float const area = surface_area( node.box );
+		float const combinedArea = surface_area( merge( node.box, leafBox ) );
+
+		// Cost of creating a new parent for this node and the new leaf
+		float const cost = 2.f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down the tree
+		float const inheritanceCost = 2.f * (combinedArea - area);
+
+		auto const child_cost = [&]( NodeId_ aChild )
+		{
+			auto const& child = mNodes[aChild];
+			float const merged = surface_area( merge( child.box, leafBox ) );
+
+			if( kNull_ == child.left )
+				return merged + inheritanceCost;
+
+			return (merged - surface_area( child.box )) + inheritanceCost;
+		};
+
+		float const costLeft = child_cost( node.left );
+		float const costRight = child_cost( node.right );
+
+		if( cost < costLeft && cost < costRight )
+			break;
+
+		index = costLeft < costRight ? node.left : node.right;
+	}
+
+	// Create a new parent for the sibling and the leaf. Note: allocating may
+	// reallocate mNodes, so no references are held across this call.
+	auto const sibling = index;
+	auto const oldParent = mNodes[sibling].parent;
+	auto const newParent = allocate_node_();
+
+	mNodes[newParent].parent = oldParent;
+	mNodes[newParent].box = merge( leafBox, mNodes[sibling].box );
+	mNodes[newParent].left = sibling;
+	mNodes[newParent].right = aLeaf;
+
+	mNodes[sibling].parent = newParent;
+	mNodes[aLeaf].parent = newParent;
+
+	if( kNull_ == oldParent )
+	{
+		mRoot = newParent;
+	}
+	else
+	{
+		if( mNodes[oldParent].left == sibling )
+			mNodes[oldParent].left = newParent;
+		else
+			mNodes[oldParent].right = newParent;
+
+		refit_( oldParent );
+	}
+}
+
+void DynamicBvh::remove_leaf_( NodeId_ aLeaf )
+{
+	if( aLeaf == mRoot )
+	{
+		mRoot = kNull_;
+		return;
+	}
+
+	auto const parent = mNodes[aLeaf].parent;
+	auto const grandParent = mNodes[parent].parent;
+	auto const sibling = mNodes[parent].left == aLeaf ? mNodes[parent].right : mNodes[parent].left;
+
+	// The sibling replaces the parent.
+	if( kNull_ == grandParent )
+	{
+		mRoot = sibling;
+		mNodes[sibling].parent = kNull_;
+	}
+	else
+	{
+		if( mNodes[grandParent].left == parent )
+			mNodes[grandParent].left = sibling;
+		else
+			mNodes[grandParent].right = sibling;
+
+		mNodes[sibling].parent = grandParent;
+		refit_( grandParent );
+	}
+
+	free_node_( parent );
+}
+
+void DynamicBvh::refit_( NodeId_ aFrom )
+{
+	for( auto index = aFrom; kNull_ != index; index = mNodes[index].parent )
+	{
+		auto& node = mNodes[index];
+		auto const box = merge( mNodes[node.left].box, mNodes[node.right].box );
+
+		// Ancestors are unaffected if this node's bounds did not change.
+		if( box.min.x == node.box.min.x && box.min.y == node.box.min.y && box.min.z == node.box.min.z
+			&& box.max.x == node.box.max.x && box.max.y == node.box.max.y && box.max.z == node.box.max.z )
+			break;
+
+		node.box = box;
+	}
+}
+
+void DynamicBvh::collect_( NodeId_ aNode, std::vector<std::uint32_t>& aVisible, CullStats& aStats ) const
+{
+	// Uses its own stack, as cull() may still have nodes on mStack.
+	mCollectStack.clear();
+	mCollectStack.emplace_back( aNode );
+
+	while( !mCollectStack.empty() )
+	{
+		auto const& node = mNodes[mCollectStack.back()];
+		mCollectStack.pop_back();
+
+		if( kNull_ == node.left )
+		{
+			aVisible.emplace_back( node.userData );
+			++aStats.visible;
+			continue;
+		}
+
+		mCollectStack.emplace_back( node.left );
+		mCollectStack.emplace_back( node.right );
+	}
+}
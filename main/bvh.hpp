@@ -0,0 +1,90 @@
+#ifndef BVH_HPP_6A0F2B93_1E7C_4D58_A3B9_C82D45E1F706
+#define BVH_HPP_6A0F2B93_1E7C_4D58_A3B9_C82D45E1F706
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/aabb.hpp"
+
+/* Dynamic bounding volume hierarchy over object bounds
+ *
+ * A binary tree of AABBs, with one leaf per object ("proxy"). Leaves are
+ * inserted incrementally next to the sibling that increases the total surface
+ * area the least (the branch-and-bound heuristic from Box2D's
+ * b2DynamicTree), so the tree does not need to be rebuilt as objects are
+ * added or removed.
+ *
+ * update() refits a moved leaf: the bounds of its ancestors are recomputed
+ * bottom-up until one of them does not change. The tree topology is kept,
+ * which is cheap and works well for objects that stay in the same area
+ * (e.g., the animated ship). Objects that move far should be removed and
+ * re-inserted instead.
+ *
+ * cull() traverses the tree against a frustum. Subtrees that are entirely
+ * outside are skipped, and subtrees that are entirely inside are accepted
+ * without testing their children.
+ */
+class DynamicBvh final
+{
+	public:
+		using ProxyId = std::uint32_t;
+
+		static constexpr ProxyId kNullProxy = ~ProxyId(0);
+
+		struct CullStats
+		{
+			std::size_t visible;
+			std::size_t culled;
+			std::size_t nodesTested;
+		};
+
+	public:
+		ProxyId insert( AABB const&, std::uint32_t aUserData );
+		void remove( ProxyId );
+
+		void update( ProxyId, AABB const& );
+
+		AABB const& bounds( ProxyId ) const noexcept;
+		std::uint32_t user_data( ProxyId ) const noexcept;
+
+		// Appends the user data of all visible leaves to aVisible.
+		CullStats cull( Frustum const&, std::vector<std::uint32_t>& aVisible ) const;
+
+		std::size_t size() const noexcept;
+
+	private:
+		using NodeId_ = std::uint32_t;
+
+		static constexpr NodeId_ kNull_ = ~NodeId_(0);
+
+		struct Node_
+		{
+			AABB box;
+			NodeId_ parent; // Next free node if the node is unused
+			NodeId_ left, right; // Both kNull_ for leaves
+			std::uint32_t userData;
+		};
+
+		NodeId_ allocate_node_();
+		void free_node_( NodeId_ );
+
+		void insert_leaf_( NodeId_ );
+		void remove_leaf_( NodeId_ );
+		void refit_( NodeId_ aFrom );
+
+		void collect_( NodeId_, std::vector<std::uint32_t>&, CullStats& ) const;
+
+	private:
+		std::vector<Node_> mNodes;
+		NodeId_ mRoot = kNull_;
+		NodeId_ mFreeList = kNull_;
+		std::size_t mLeafCount = 0;
+
+		// Traversal scratch space
+		mutable std::vector<NodeId_> mStack;
+		mutable std::vector<NodeId_> mCollectStack;
+};
+
+#endif // BVH_HPP_6A0F2B93_1E7C_4D58_A3B9_C82D45E1F706
@@ -0,0 +1,251 @@
+#include "clustered_lights.hpp"
+
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+	constexpr std::uint32_t kClusterCount_ = kClusterGridX * kClusterGridY * kClusterGridZ;
+
+	std::uint32_t cluster_index_( std::uint32_t aX, std::uint32_t aY, std::uint32_t aZ ) noexcept
+	{
+		return aX + kClusterGridX * (aY + kClusterGridY * aZ);
+	}
+
+	// Depth slices are spaced exponentially: slice k covers view depths
+	// near * (far/near)^(k/Z) to near * (far/near)^((k+1)/Z).
+	void slice_params_( float aNear, float aFar, float& aScale, float& aBias ) noexcept
+	{
+		float const logRatio = std::log( aFar / aNear );
+		aScale = float(kClusterGridZ) / logRatio;
+		aBias = -float(kClusterGridZ) * std::log( aNear ) / logRatio;
+	}
+
+	std::uint32_t clamp_cell_( float aValue, std::uint32_t aCount ) noexcept
+	{
+		auto const cell = std::floor( aValue );
+		if( cell < 0.f )
+			return 0;
+		if( cell >= float(aCount) )
+			return aCount - 1;
+		return std::uint32_t(cell);
+	}
+}
+
+ClusteredLights::ClusteredLights()
+	: mProjection( kIdentity44f )
+	, mNear( 0.f )
+	, mFar( 0.f )
+	, mWidth( 0.f )
+	, mHeight( 0.f )
+	, mClusterBounds( kClusterCount_, kEmptyAABB )
+	, mClusters( 2 * kClusterCount_, 0 )
+{}
+
+void ClusteredLights::set_projection( Mat44f const& aProjection, float aNear, float aFar, float aWidth, float aHeight )
+{
+	assert( aNear > 0.f && aFar > aNear );
+
+	if( 0 == std::memcmp( &aProjection, &mProjection, sizeof(Mat44f) ) && aNear == mNear && aFar == mFar && aWidth == mWidth && aHeight == mHeight )
+		return;
+
+	mProjection = aProjection;
+	mNear = aNear;
+	mFar = aFar;
+	mWidth = aWidth;
+	mHeight = aHeight;
+
+	// For a symmetric perspective projection, the view-space point at depth
+	// d that projects to (ndcX, ndcY) is (ndcX d / P00, ndcY d / P11, -d).
+	float const sx = 1.f / aProjection(0,0);
+	float const sy = 1.f / aProjection(1,1);
+
+	for( std::uint32_t z = 0; z < kClusterGridZ; ++z )
+	{
+		float const d0 = aNear * std::pow( aFar / aNear, float(z) / kClusterGridZ );
+		float const d1 = aNear * std::pow( aFar / aNear, float(z+1) / kClusterGridZ );
+
+		for( std::uint32_t y = 0; y < kClusterGridY; ++y )
+		{
+			float const ny0 = -1.f + 2.f * float(y) / kClusterGridY;
+			float const ny1 = -1.f + 2.f * float(y+1) / kClusterGridY;
+
+			for( std::uint32_t x = 0; x < kClusterGridX; ++x )
+			{
+				float const nx0 = -1.f + 2.f * float(x) / kClusterGridX;
+				float const nx1 = -1.f + 2.f * float(x+1) / kClusterGridX;
+
+				AABB bounds = kEmptyAABB;
+				for( float const d : { d0, d1 } )
+				{
+					for( float const nx : { nx0, nx1 } )
+					{
+						for( float const ny : { ny0, ny1 } )
+							bounds = expand( bounds, Vec3f{ nx * d * sx, ny * d * sy, -d } );
+					}
+				}
+
+				mClusterBounds[cluster_index_( x, y, z )] = bounds;
+			}
+		}
+	}
+}
+
+void ClusteredLights::clear() noexcept
+{
+	mLights.clear();
+}
+
+void ClusteredLights::add( Vec3f aPosition, float aRadius, Vec3f aColor )
+{
+	assert( aRadius > 0.f );
+	mLights.emplace_back( PointLightData{
+		{ aPosition.x, aPosition.y, aPosition.z, aRadius },
+		{ aColor.x, aColor.y, aColor.z, 0.f }
+	} );
+}
+
+ClusteredLights::Stats ClusteredLights::assign( Mat44f const& aWorldToCamera )
+{
+	assert( mFar > 0.f ); // set_projection() first
+
+	Stats stats{ 0, 0, 0 };
+
+	float sliceScale, sliceBias;
+	slice_params_( mNear, mFar, sliceScale, sliceBias );
+
+	std::fill( mClusters.begin(), mClusters.end(), 0 );
+	mPairs.clear();
+
+	for( std::size_t i = 0; i < mLights.size(); ++i )
+	{
+		auto const& light = mLights[i];
+		float const radius = light.positionRadius.w;
+
+		auto const v = aWorldToCamera * Vec4f{ light.positionRadius.x, light.positionRadius.y, light.positionRadius.z, 1.f };
+		Vec3f const center{ v.x, v.y, v.z };
+
+		// Depth range (the camera looks down -z)
+		float const depthMin = -center.z - radius;
+		float const depthMax = -center.z + radius;
+		if( depthMax < mNear || depthMin > mFar )
+			continue;
+
+		auto const z0 = clamp_cell_( std::log( std::max( depthMin, mNear ) ) * sliceScale + sliceBias, kClusterGridZ );
+		auto const z1 = clamp_cell_( std::log( std::min( depthMax, mFar ) ) * sliceScale + sliceBias, kClusterGridZ );
+
+		// Screen-space bounds of the sphere's view-space box, clipped to the
+		// near plane. The box is convex, so the projection of its corners
+		// bounds its projection.
+		float const zNear = std::min( center.z + radius, -mNear );
+		float const zFar = center.z - radius;
+
+		float ndcMinX = 1.f, ndcMaxX = -1.f, ndcMinY = 1.f, ndcMaxY = -1.f;
+		for( float const z : { zNear, zFar } )
+		{
+			for( float const x : { center.x - radius, center.x + radius } )
+			{
+				for( float const y : { center.y - radius, center.y + radius } )
+				{
+					auto const clip = mProjection * Vec4f{ x, y, z, 1.f };
+					float const nx = clip.x / clip.w, ny = clip.y / clip.w;
+
+					ndcMinX = std::min( ndcMinX, nx );
+					ndcMaxX = std::max( ndcMaxX, nx );
+					ndcMinY = std::min( ndcMinY, ny );
+					ndcMaxY = std::max( ndcMaxY, ny );
+				}
+			}
+		}
+
+		if( ndcMaxX < -1.f || ndcMinX > 1.f || ndcMaxY < -1.f || ndcMinY > 1.f )
+			continue;
+
+		auto const x0 = clamp_cell_( (ndcMinX * .5f + .5f) * kClusterGridX, kClusterGridX );
+		auto const x1 = clamp_cell_( (ndcMaxX * .5f + .5f) * kClusterGridX, kClusterGridX );
+		auto const y0 = clamp_cell_( (ndcMinY * .5f + .5f) * kClusterGridY, kClusterGridY );
+		auto const y1 = clamp_cell_( (ndcMaxY * .5f + .5f) * kClusterGridY, kClusterGridY );
+
+		auto const before = mPairs.size();
+		for( auto z = z0; z <= z1; ++z )
+		{
+			for( auto y = y0; y <= y1; ++y )
+			{
+				for( auto x = x0; x <= x1; ++x )
+				{
+					auto const cluster = cluster_index_( x, y, z );
+					if( distance( mClusterBounds[cluster], center ) > radius )
+						continue;
+
+					mPairs.emplace_back( cluster );
+					mPairs.emplace_back( std::uint32_t(i) );
+					++mClusters[2*cluster+1];
+				}
+			}
+		}
+
+		if( mPairs.size() != before )
+			++stats.lights;
+	}
+
+	// Counting sort of the (cluster, light) pairs by cluster. Lights were
+	// visited in order, so each cluster's list stays sorted by light index.
+	std::uint32_t offset = 0;
+	for( std::uint32_t c = 0; c < kClusterCount_; ++c )
+	{
+		auto const count = mClusters[2*c+1];
+		stats.maxClusterLights = std::max<std::size_t>( stats.maxClusterLights, count );
+
+		mClusters[2*c+0] = offset;
+		mClusters[2*c+1] = 0;
+		offset += count;
+	}
+
+	mIndices.resize( offset );
+	for( std::size_t i = 0; i < mPairs.size(); i += 2 )
+	{
+		auto const cluster = mPairs[i];
+		mIndices[mClusters[2*cluster] + mClusters[2*cluster+1]++] = mPairs[i+1];
+	}
+
+	stats.assignments = mIndices.size();
+	return stats;
+}
+
+void ClusteredLights::upload( RingBuffer& aRing ) const
+{
+	ClusterUniforms params{};
+	params.gridSize[0] = kClusterGridX;
+	params.gridSize[1] = kClusterGridY;
+	params.gridSize[2] = kClusterGridZ;
+	params.lightCount = std::uint32_t(mLights.size());
+	params.tileSize[0] = mWidth / kClusterGridX;
+	params.tileSize[1] = mHeight / kClusterGridY;
+	slice_params_( mNear, mFar, params.sliceScale, params.sliceBias );
+
+	GLintptr paramsOffset = 0;
+	*aRing.allocate_as<ClusterUniforms>( aRing.uniform_alignment(), paramsOffset ) = params;
+	glBindBufferRange( GL_UNIFORM_BUFFER, kClusterBlockBinding, aRing.bufferId(), paramsOffset, sizeof(ClusterUniforms) );
+
+	// Empty ranges cannot be bound, so the storage blocks always hold at
+	// least one element.
+	auto const bind_storage = [&aRing] (GLuint aBinding, void const* aData, std::size_t aBytes, std::size_t aMinBytes) {
+		auto const alloc = aRing.allocate( GLsizeiptr(std::max( aBytes, aMinBytes )), aRing.storage_alignment() );
+		if( aBytes )
+			std::memcpy( alloc.data, aData, aBytes );
+
+		glBindBufferRange( GL_SHADER_STORAGE_BUFFER, aBinding, aRing.bufferId(), alloc.offset, alloc.size );
+	};
+
+	bind_storage( kLightBufferBinding, mLights.data(), mLights.size() * sizeof(PointLightData), sizeof(PointLightData) );
+	bind_storage( kClusterBufferBinding, mClusters.data(), mClusters.size() * sizeof(std::uint32_t), sizeof(std::uint32_t) );
+	bind_storage( kLightIndexBufferBinding, mIndices.data(), mIndices.size() * sizeof(std::uint32_t), sizeof(std::uint32_t) );
+}
+
+std::size_t ClusteredLights::size() const noexcept
+{
+	return mLights.size();
+}
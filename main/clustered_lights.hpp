@@ -0,0 +1,85 @@
+#ifndef CLUSTERED_LIGHTS_HPP_CF7596D7_39AA_47D1_941D_7699F45C4F2E
+#define CLUSTERED_LIGHTS_HPP_CF7596D7_39AA_47D1_941D_7699F45C4F2E
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/aabb.hpp"
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+#include "../support/ring_buffer.hpp"
+
+#include "uniform_blocks.hpp"
+
+/* Clustered forward lighting
+ *
+ * The view frustum is divided into a grid of clusters ("froxels"):
+ * kClusterGridX x kClusterGridY screen tiles, and kClusterGridZ depth slices
+ * that are spaced exponentially between the near and far planes (so that
+ * clusters are roughly cubical). Each frame, assign() finds the clusters
+ * that each light's sphere of influence overlaps, and builds a compact list
+ * of light indices per cluster.
+ *
+ * upload() writes the lights, the per-cluster ranges and the light indices
+ * into the ring buffer and binds them (see ClusterUniforms and
+ * default.frag). A fragment only loops over the lights of its own cluster, so
+ * its cost depends on the local light density rather than on the total
+ * number of lights.
+ *
+ * Assignment is conservative: a light is assigned to each cluster whose
+ * view-space bounds intersect the light's sphere. The candidate clusters are
+ * found from the screen-space bounds of the sphere and its depth range.
+ */
+constexpr std::uint32_t kClusterGridX = 16;
+constexpr std::uint32_t kClusterGridY = 9;
+constexpr std::uint32_t kClusterGridZ = 24;
+
+class ClusteredLights final
+{
+	public:
+		struct Stats
+		{
+			std::size_t lights;          // Lights assigned to at least one cluster
+			std::size_t assignments;     // (cluster, light) pairs
+			std::size_t maxClusterLights;
+		};
+
+	public:
+		ClusteredLights();
+
+	public:
+		// Rebuilds the cluster bounds if the projection or viewport changed.
+		// aProjection must be a symmetric perspective projection
+		// (make_perspective_projection()).
+		void set_projection( Mat44f const& aProjection, float aNear, float aFar, float aWidth, float aHeight );
+
+		void clear() noexcept;
+		void add( Vec3f aPosition, float aRadius, Vec3f aColor );
+
+		Stats assign( Mat44f const& aWorldToCamera );
+
+		void upload( RingBuffer& ) const;
+
+		std::size_t size() const noexcept;
+
+	private:
+		Mat44f mProjection;
+		float mNear, mFar;
+		float mWidth, mHeight;
+
+		std::vector<AABB> mClusterBounds; // View space
+
+		std::vector<PointLightData> mLights;
+
+		// Light assignment, compact per cluster: the lights of cluster c are
+		// mIndices[mClusters[2c] .. mClusters[2c] + mClusters[2c+1]]
+		std::vector<std::uint32_t> mClusters;
+		std::vector<std::uint32_t> mIndices;
+
+		std::vector<std::uint32_t> mPairs; // Scratch space for assign()
+};
+
+#endif // CLUSTERED_LIGHTS_HPP_CF7596D7_39AA_47D1_941D_7699F45C4F2E
@@ -0,0 +1,132 @@
+#include "gbuffer.hpp"
+
+#include <utility>
+
+#include <cassert>
+
+#include "../support/error.hpp"
+#include "../support/checkpoint.hpp"
+
+namespace
+{
+	GLuint make_target_( GLenum aFormat, GLsizei aWidth, GLsizei aHeight )
+	{
+		GLuint tex = 0;
+		glGenTextures( 1, &tex );
+		glBindTexture( GL_TEXTURE_2D, tex );
+		glTexStorage2D( GL_TEXTURE_2D, 1, aFormat, aWidth, aHeight );
+
+		// The lighting pass reads exactly one texel per pixel.
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+		glBindTexture( GL_TEXTURE_2D, 0 );
+		return tex;
+	}
+}
+
+GBuffer::GBuffer() noexcept
+	: mFramebuffer( 0 )
+	, mAlbedo( 0 )
+	, mNormal( 0 )
+	, mDepth( 0 )
+	, mWidth( 0 )
+	, mHeight( 0 )
+{}
+
+GBuffer::~GBuffer()
+{
+	release_();
+}
+
+GBuffer::GBuffer( GBuffer&& aOther ) noexcept
+	: mFramebuffer( std::exchange( aOther.mFramebuffer, 0 ) )
+	, mAlbedo( std::exchange( aOther.mAlbedo, 0 ) )
+	, mNormal( std::exchange( aOther.mNormal, 0 ) )
+	, mDepth( std::exchange( aOther.mDepth, 0 ) )
+	, mWidth( std::exchange( aOther.mWidth, 0 ) )
+	, mHeight( std::exchange( aOther.mHeight, 0 ) )
+{}
+GBuffer& GBuffer::operator= (GBuffer&& aOther) noexcept
+{
+	std::swap( mFramebuffer, aOther.mFramebuffer );
+	std::swap( mAlbedo, aOther.mAlbedo );
+	std::swap( mNormal, aOther.mNormal );
+	std::swap( mDepth, aOther.mDepth );
+	std::swap( mWidth, aOther.mWidth );
+	std::swap( mHeight, aOther.mHeight );
+	return *this;
+}
+
+void GBuffer::resize( GLsizei aWidth, GLsizei aHeight )
+{
+	assert( aWidth > 0 && aHeight > 0 );
+
+	if( aWidth == mWidth && aHeight == mHeight )
+		return;
+
+	// Immutable textures cannot be resized; start over.
+	release_();
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	mAlbedo = make_target_( GL_SRGB8_ALPHA8, aWidth, aHeight );
+	mNormal = make_target_( GL_RG16F, aWidth, aHeight );
+	mDepth = make_target_( GL_DEPTH_COMPONENT32F, aWidth, aHeight );
+
+	glGenFramebuffers( 1, &mFramebuffer );
+	glBindFramebuffer( GL_FRAMEBUFFER, mFramebuffer );
+
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mAlbedo, 0 );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, mNormal, 0 );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mDepth, 0 );
+
+	GLenum const buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers( 2, buffers );
+
+	auto const status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	if( GL_FRAMEBUFFER_COMPLETE != status )
+	{
+		release_();
+		throw Error( "GBuffer: framebuffer incomplete (status 0x%x) at %dx%d", unsigned(status), int(aWidth), int(aHeight) );
+	}
+
+	mWidth = aWidth;
+	mHeight = aHeight;
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+GLuint GBuffer::framebuffer() const noexcept
+{
+	return mFramebuffer;
+}
+
+GLuint GBuffer::albedo() const noexcept
+{
+	return mAlbedo;
+}
+GLuint GBuffer::normal() const noexcept
+{
+	return mNormal;
+}
+GLuint GBuffer::depth() const noexcept
+{
+	return mDepth;
+}
+
+void GBuffer::release_() noexcept
+{
+	if( 0 != mFramebuffer )
+		glDeleteFramebuffers( 1, &mFramebuffer );
+
+	GLuint const textures[] = { mAlbedo, mNormal, mDepth };
+	glDeleteTextures( 3, textures ); // Zeros are silently ignored
+
+	mFramebuffer = mAlbedo = mNormal = mDepth = 0;
+	mWidth = mHeight = 0;
+}
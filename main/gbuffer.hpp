@@ -0,0 +1,58 @@
+#ifndef GBUFFER_HPP_CF7AF0C3_C5C6_4637_BCFA_10397E449E81
+#define GBUFFER_HPP_CF7AF0C3_C5C6_4637_BCFA_10397E449E81
+
+#include <glad.h>
+
+/* G-buffer for deferred shading
+ *
+ * A framebuffer with three attachments, 12 bytes per pixel in total:
+ *   0  albedo: GL_SRGB8_ALPHA8. rgb = surface color (texture times vertex
+ *      color), a = 1 if the surface receives point lights
+ *   1  normal: GL_RG16F, octahedral-encoded world-space normal
+ *   -  depth:  GL_DEPTH_COMPONENT32F. Positions are reconstructed from it
+ *
+ * The geometry pass (gbuffer.frag) writes the attachments, and the lighting
+ * pass (deferred.frag) reads them back from texture units
+ * kGBufferAlbedoUnit, kGBufferNormalUnit and kGBufferDepthUnit.
+ *
+ * resize() (re-)creates the textures when the size changes.
+ */
+constexpr GLuint kGBufferAlbedoUnit = 0;
+constexpr GLuint kGBufferNormalUnit = 1;
+constexpr GLuint kGBufferDepthUnit = 2;
+
+class GBuffer final
+{
+	public:
+		GBuffer() noexcept;
+		~GBuffer();
+
+		GBuffer( GBuffer const& ) = delete;
+		GBuffer& operator= (GBuffer const&) = delete;
+
+		GBuffer( GBuffer&& ) noexcept;
+		GBuffer& operator= (GBuffer&&) noexcept;
+
+	public:
+		void resize( GLsizei aWidth, GLsizei aHeight );
+
+		GLuint framebuffer() const noexcept;
+
+		GLuint albedo() const noexcept;
+		GLuint normal() const noexcept;
+		GLuint depth() const noexcept;
+
+	private:
+		void release_() noexcept;
+
+	private:
+		GLuint mFramebuffer;
+		GLuint mAlbedo;
+		GLuint mNormal;
+		GLuint mDepth;
+
+		GLsizei mWidth;
+		GLsizei mHeight;
+};
+
+#endif // GBUFFER_HPP_CF7AF0C3_C5C6_4637_BCFA_10397E449E81
@@ -0,0 +1,213 @@
+#include "gpu_culler.hpp"
+
+#include <utility>
+
+#include <cassert>
+#include <cstring>
+
+#include "../support/checkpoint.hpp"
+
+#include "multi_draw.hpp"
+
+namespace
+{
+	// Work group size of cull.comp
+	constexpr GLuint kGroupSize_ = 64;
+
+	// Texture unit of the Hi-Z pyramid in cull.comp
+	constexpr GLuint kHiZUnit_ = 0;
+
+	GLuint make_buffer_( GLsizeiptr aSize )
+	{
+		GLuint buffer = 0;
+		glGenBuffers( 1, &buffer );
+		glBindBuffer( GL_COPY_WRITE_BUFFER, buffer );
+
+		// Only written by the GPU (compute shader and buffer clears)
+		if( GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage )
+			glBufferStorage( GL_COPY_WRITE_BUFFER, aSize, nullptr, 0 );
+		else
+			glBufferData( GL_COPY_WRITE_BUFFER, aSize, nullptr, GL_DYNAMIC_COPY );
+
+		glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+		return buffer;
+	}
+
+	void clear_buffer_( GLuint aBuffer, GLsizeiptr aSize )
+	{
+		GLuint const zero = 0;
+		glBindBuffer( GL_COPY_WRITE_BUFFER, aBuffer );
+		glClearBufferSubData( GL_COPY_WRITE_BUFFER, GL_R32UI, 0, aSize, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero );
+		glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+	}
+}
+
+GpuCuller::GpuCuller( ShaderProgram& aCullProgram )
+	: mProgram( &aCullProgram )
+	, mObjectCountUniform( aCullProgram.uniform<int>( "objectCount" ) )
+	, mHiZLevelsUniform( aCullProgram.uniform<int>( "hizLevels" ) )
+	, mHiZSizeUniform( aCullProgram.uniform<Vec2f>( "hizSize" ) )
+	, mHiZProjViewUniform( aCullProgram.uniform<Mat44f>( "hizProjView" ) )
+	, mCommandBuffer( 0 )
+	, mDrawBuffer( 0 )
+	, mCounterBuffer( 0 )
+	, mCapacity( 0 )
+{
+	mCounterBuffer = make_buffer_( sizeof(GLuint) );
+	ensure_capacity_( 64 );
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+GpuCuller::~GpuCuller()
+{
+	GLuint const buffers[] = { mCommandBuffer, mDrawBuffer, mCounterBuffer };
+	glDeleteBuffers( 3, buffers ); // Zeros are silently ignored
+}
+
+GpuCuller::GpuCuller( GpuCuller&& aOther ) noexcept
+	: mProgram( aOther.mProgram )
+	, mObjectCountUniform( aOther.mObjectCountUniform )
+	, mHiZLevelsUniform( aOther.mHiZLevelsUniform )
+	, mHiZSizeUniform( aOther.mHiZSizeUniform )
+	, mHiZProjViewUniform( aOther.mHiZProjViewUniform )
+	, mCommandBuffer( std::exchange( aOther.mCommandBuffer, 0 ) )
+	, mDrawBuffer( std::exchange( aOther.mDrawBuffer, 0 ) )
+	, mCounterBuffer( std::exchange( aOther.mCounterBuffer, 0 ) )
+	, mCapacity( std::exchange( aOther.mCapacity, 0 ) )
+	, mObjects( std::move(aOther.mObjects) )
+{}
+GpuCuller& GpuCuller::operator= (GpuCuller&& aOther) noexcept
+{
+	std::swap( mProgram, aOther.mProgram );
+	std::swap( mObjectCountUniform, aOther.mObjectCountUniform );
+	std::swap( mHiZLevelsUniform, aOther.mHiZLevelsUniform );
+	std::swap( mHiZSizeUniform, aOther.mHiZSizeUniform );
+	std::swap( mHiZProjViewUniform, aOther.mHiZProjViewUniform );
+	std::swap( mCommandBuffer, aOther.mCommandBuffer );
+	std::swap( mDrawBuffer, aOther.mDrawBuffer );
+	std::swap( mCounterBuffer, aOther.mCounterBuffer );
+	std::swap( mCapacity, aOther.mCapacity );
+	std::swap( mObjects, aOther.mObjects );
+	return *this;
+}
+
+void GpuCuller::clear() noexcept
+{
+	mObjects.clear();
+}
+
+void GpuCuller::add( GLuint aIndexCount, GLuint aFirstIndex, GLint aBaseVertex, AABB const& aBounds, Mat44f const& aModel, std::uint32_t aFlags )
+{
+	CullObjectData object{};
+	object.model = aModel;
+	object.boundsMin = Vec4f{ aBounds.min.x, aBounds.min.y, aBounds.min.z, 1.f };
+	object.boundsMax = Vec4f{ aBounds.max.x, aBounds.max.y, aBounds.max.z, 1.f };
+	object.indexCount = aIndexCount;
+	object.firstIndex = aFirstIndex;
+	object.baseVertex = aBaseVertex;
+	object.flags = aFlags;
+
+	mObjects.emplace_back( object );
+}
+
+void GpuCuller::cull( RingBuffer& aRing, HiZBuffer const* aOcclusion )
+{
+	if( mObjects.empty() )
+		return;
+
+	ensure_capacity_( mObjects.size() );
+
+	auto const objectBytes = GLsizeiptr(mObjects.size() * sizeof(CullObjectData));
+	auto const objects = aRing.allocate( objectBytes, aRing.storage_alignment() );
+	std::memcpy( objects.data, mObjects.data(), std::size_t(objectBytes) );
+
+	// Reset the append counter. Without a GPU-side draw count, the unused
+	// commands must draw nothing.
+	clear_buffer_( mCounterBuffer, sizeof(GLuint) );
+	if( !GLAD_GL_ARB_indirect_parameters )
+		clear_buffer_( mCommandBuffer, GLsizeiptr(mObjects.size() * sizeof(DrawElementsIndirectCommand)) );
+
+	glBindBufferRange( GL_SHADER_STORAGE_BUFFER, kCullObjectBufferBinding, aRing.bufferId(), objects.offset, objects.size );
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, kCullCommandBufferBinding, mCommandBuffer );
+	glBindBufferBase( GL_SHADER_STORAGE_BUFFER, kCullDrawBufferBinding, mDrawBuffer );
+	glBindBufferBase( GL_ATOMIC_COUNTER_BUFFER, kCullCounterBinding, mCounterBuffer );
+
+	mProgram->set( mObjectCountUniform, int(mObjects.size()) );
+
+	if( aOcclusion && aOcclusion->has_pyramid() )
+	{
+		mProgram->set( mHiZLevelsUniform, int(aOcclusion->pyramid_levels()) );
+		mProgram->set( mHiZSizeUniform, Vec2f{ float(aOcclusion->width()), float(aOcclusion->height()) } );
+		mProgram->set( mHiZProjViewUniform, aOcclusion->pyramid_proj_view() );
+
+		glActiveTexture( GL_TEXTURE0 + kHiZUnit_ );
+		glBindTexture( GL_TEXTURE_2D, aOcclusion->pyramid() );
+	}
+	else
+	{
+		mProgram->set( mHiZLevelsUniform, 0 );
+	}
+
+	glUseProgram( mProgram->programId() );
+	glDispatchCompute( (GLuint(mObjects.size()) + kGroupSize_ - 1) / kGroupSize_, 1, 1 );
+
+	// The commands and the draw count are read by the indirect draw, and the
+	// DrawData by batched.vert.
+	glMemoryBarrier( GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT );
+
+	OGL_CHECKPOINT_DEBUG();
+}
+
+RenderPacket GpuCuller::make_packet( GLuint aProgram, GLuint aVertexArray, GLuint aTexture ) const noexcept
+{
+	assert( !mObjects.empty() );
+
+	RenderPacket packet{};
+	packet.kind = GLAD_GL_ARB_indirect_parameters
+		? RenderPacket::Kind::ElementsIndirectMultiCount
+		: RenderPacket::Kind::ElementsIndirectMulti
+	;
+	packet.mode = GL_TRIANGLES;
+	packet.program = aProgram;
+	packet.vertexArray = aVertexArray;
+	packet.texture = aTexture;
+	packet.dataTarget = GL_SHADER_STORAGE_BUFFER;
+	packet.dataBinding = kDrawBufferBinding;
+	packet.dataBuffer = mDrawBuffer;
+	packet.dataOffset = 0;
+	packet.dataSize = GLsizeiptr(mObjects.size() * sizeof(DrawData));
+	packet.indexType = GL_UNSIGNED_INT;
+	packet.indirectBuffer = mCommandBuffer;
+	packet.indirectOffset = 0;
+	packet.drawCount = GLsizei(mObjects.size());
+	packet.parameterBuffer = mCounterBuffer;
+	packet.parameterOffset = 0;
+	return packet;
+}
+
+std::size_t GpuCuller::size() const noexcept
+{
+	return mObjects.size();
+}
+
+void GpuCuller::ensure_capacity_( std::size_t aCount )
+{
+	if( aCount <= mCapacity )
+		return;
+
+	auto capacity = mCapacity ? mCapacity : 64;
+	while( capacity < aCount )
+		capacity *= 2;
+
+	// Immutable storage cannot be resized; replace the buffers instead. The
+	// old contents are rewritten by the next cull().
+	GLuint const buffers[] = { mCommandBuffer, mDrawBuffer };
+	glDeleteBuffers( 2, buffers ); // Zeros are silently ignored
+
+	mCommandBuffer = make_buffer_( GLsizeiptr(capacity * sizeof(DrawElementsIndirectCommand)) );
+	mDrawBuffer = make_buffer_( GLsizeiptr(capacity * sizeof(DrawData)) );
+	mCapacity = capacity;
+
+	OGL_CHECKPOINT_DEBUG();
+}
@@ -0,0 +1,85 @@
+#ifndef GPU_CULLER_HPP_9D3A6E27_41B8_4C5F_A2E0_6B1F8C47D935
+#define GPU_CULLER_HPP_9D3A6E27_41B8_4C5F_A2E0_6B1F8C47D935
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/aabb.hpp"
+#include "../vmlib/mat44.hpp"
+
+#include "../support/program.hpp"
+#include "../support/ring_buffer.hpp"
+
+#include "hiz.hpp"
+#include "render_queue.hpp"
+#include "uniform_blocks.hpp"
+
+/* GPU-driven culling of multi-draw commands
+ *
+ * Each frame, add() the objects to consider: the draw (an index range, as in
+ * MultiDrawList), the object-space bounds, the model matrix and flags. cull()
+ * uploads them and runs a compute shader (cull.comp) with one invocation per
+ * object. Objects that pass the frustum test (against Frame::projView) and,
+ * given a HiZBuffer, the occlusion test against its pyramid are appended to
+ * a command buffer and a DrawData buffer through an atomic counter. The
+ * results are never read back.
+ *
+ * make_packet() draws the surviving commands with a single
+ * glMultiDrawElementsIndirectCountARB(), which reads the number of draws
+ * from the counter. Without ARB_indirect_parameters, cull() clears the
+ * command buffer first, and all size() commands are drawn with
+ * glMultiDrawElementsIndirect(); the cleared commands draw nothing.
+ *
+ * Commands follow the MultiDrawList conventions (one instance each, and
+ * baseInstance = draw index), so batched.vert and the VAOs attached to a
+ * MultiDrawList can be used as-is, provided that their draw index buffer
+ * holds at least size() entries (see MultiDrawList::reserve()).
+ *
+ * The Frame uniform block must be bound when calling cull(). The cull
+ * program must outlive the GpuCuller.
+ */
+class GpuCuller final
+{
+	public:
+		explicit GpuCuller( ShaderProgram& aCullProgram );
+		~GpuCuller();
+
+		GpuCuller( GpuCuller const& ) = delete;
+		GpuCuller& operator= (GpuCuller const&) = delete;
+
+		GpuCuller( GpuCuller&& ) noexcept;
+		GpuCuller& operator= (GpuCuller&&) noexcept;
+
+	public:
+		void clear() noexcept;
+		void add( GLuint aIndexCount, GLuint aFirstIndex, GLint aBaseVertex, AABB const& aBounds, Mat44f const& aModel, std::uint32_t aFlags );
+
+		void cull( RingBuffer&, HiZBuffer const* aOcclusion = nullptr );
+
+		RenderPacket make_packet( GLuint aProgram, GLuint aVertexArray, GLuint aTexture ) const noexcept;
+
+		std::size_t size() const noexcept;
+
+	private:
+		void ensure_capacity_( std::size_t );
+
+	private:
+		ShaderProgram* mProgram;
+		ShaderProgram::Uniform<int> mObjectCountUniform;
+		ShaderProgram::Uniform<int> mHiZLevelsUniform;
+		ShaderProgram::Uniform<Vec2f> mHiZSizeUniform;
+		ShaderProgram::Uniform<Mat44f> mHiZProjViewUniform;
+
+		GLuint mCommandBuffer; // DrawElementsIndirectCommand[mCapacity]
+		GLuint mDrawBuffer;    // DrawData[mCapacity]
+		GLuint mCounterBuffer; // Number of commands emitted
+		std::size_t mCapacity;
+
+		std::vector<CullObjectData> mObjects;
+};
+
+#endif // GPU_CULLER_HPP_9D3A6E27_41B8_4C5F_A2E0_6B1F8C47D935
@@ -0,0 +1,126 @@
+#include "gpu_frame_stats.hpp"
+
+#include <utility>
+
+#include <cassert>
+
+#include "../support/error.hpp"
+#include "../support/checkpoint.hpp"
+
+// From ARB_pipeline_statistics_query, in case the GL loader was generated
+// without the extension's enums.
+#if !defined(GL_FRAGMENT_SHADER_INVOCATIONS_ARB)
+#	define GL_FRAGMENT_SHADER_INVOCATIONS_ARB 0x82F4
+#endif
+
+GpuFrameStats::GpuFrameStats( std::size_t aMaxFrames )
+	: mTimeQueries( aMaxFrames, 0 )
+	, mFrames( 0 )
+	, mActive( false )
+{
+	assert( aMaxFrames > 0 );
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	glGenQueries( GLsizei(aMaxFrames), mTimeQueries.data() );
+
+	if( GLAD_GL_ARB_pipeline_statistics_query )
+	{
+		mInvocationQueries.resize( aMaxFrames, 0 );
+		glGenQueries( GLsizei(aMaxFrames), mInvocationQueries.data() );
+	}
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+GpuFrameStats::~GpuFrameStats()
+{
+	if( !mTimeQueries.empty() )
+		glDeleteQueries( GLsizei(mTimeQueries.size()), mTimeQueries.data() );
+	if( !mInvocationQueries.empty() )
+		glDeleteQueries( GLsizei(mInvocationQueries.size()), mInvocationQueries.data() );
+}
+
+GpuFrameStats::GpuFrameStats( GpuFrameStats&& aOther ) noexcept
+	: mTimeQueries( std::move(aOther.mTimeQueries) )
+	, mInvocationQueries( std::move(aOther.mInvocationQueries) )
+	, mFrames( std::exchange( aOther.mFrames, 0 ) )
+	, mActive( std::exchange( aOther.mActive, false ) )
+{
+	aOther.mTimeQueries.clear();
+	aOther.mInvocationQueries.clear();
+}
+GpuFrameStats& GpuFrameStats::operator= (GpuFrameStats&& aOther) noexcept
+{
+	std::swap( mTimeQueries, aOther.mTimeQueries );
+	std::swap( mInvocationQueries, aOther.mInvocationQueries );
+	std::swap( mFrames, aOther.mFrames );
+	std::swap( mActive, aOther.mActive );
+	return *this;
+}
+
+void GpuFrameStats::begin_frame()
+{
+	assert( !mActive );
+
+	if( full() )
+		throw Error( "GpuFrameStats: all %zu frames used; reset() first", mTimeQueries.size() );
+
+	glBeginQuery( GL_TIME_ELAPSED, mTimeQueries[mFrames] );
+	if( !mInvocationQueries.empty() )
+		glBeginQuery( GL_FRAGMENT_SHADER_INVOCATIONS_ARB, mInvocationQueries[mFrames] );
+
+	mActive = true;
+}
+
+void GpuFrameStats::end_frame()
+{
+	assert( mActive );
+
+	if( !mInvocationQueries.empty() )
+		glEndQuery( GL_FRAGMENT_SHADER_INVOCATIONS_ARB );
+	glEndQuery( GL_TIME_ELAPSED );
+
+	mActive = false;
+	++mFrames;
+}
+
+GpuFrameStats::Totals GpuFrameStats::totals() const
+{
+	assert( !mActive );
+
+	Totals ret{ mFrames, 0, 0, !mInvocationQueries.empty() };
+
+	// GL_QUERY_RESULT waits until the result is available.
+	for( std::size_t i = 0; i < mFrames; ++i )
+	{
+		GLuint64 value = 0;
+		glGetQueryObjectui64v( mTimeQueries[i], GL_QUERY_RESULT, &value );
+		ret.gpuTimeNs += value;
+
+		if( !mInvocationQueries.empty() )
+		{
+			glGetQueryObjectui64v( mInvocationQueries[i], GL_QUERY_RESULT, &value );
+			ret.fragmentInvocations += value;
+		}
+	}
+
+	OGL_CHECKPOINT_DEBUG();
+
+	return ret;
+}
+
+void GpuFrameStats::reset() noexcept
+{
+	assert( !mActive );
+	mFrames = 0;
+}
+
+std::size_t GpuFrameStats::frames() const noexcept
+{
+	return mFrames;
+}
+bool GpuFrameStats::full() const noexcept
+{
+	return mFrames >= mTimeQueries.size();
+}
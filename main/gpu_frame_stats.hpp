@@ -0,0 +1,61 @@
+#ifndef GPU_FRAME_STATS_HPP_2C572A6F_4737_4992_9624_0E7FB32423AA
+#define GPU_FRAME_STATS_HPP_2C572A6F_4737_4992_9624_0E7FB32423AA
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/* GPU statistics over a series of frames
+ *
+ * Measures the GPU time (GL_TIME_ELAPSED) and, where
+ * ARB_pipeline_statistics_query is available, the number of fragment shader
+ * invocations of the commands between begin_frame() and end_frame().
+ *
+ * Each frame uses its own query objects, so that no results have to be read
+ * back while frames are being measured. totals() reads all results (waiting
+ * for the GPU if necessary) and is meant to be called once at the end of a
+ * measurement, e.g., by a benchmark. reset() starts a new measurement.
+ */
+class GpuFrameStats final
+{
+	public:
+		struct Totals
+		{
+			std::size_t frames;
+			std::uint64_t gpuTimeNs;
+			std::uint64_t fragmentInvocations;
+			bool hasFragmentInvocations; // False without ARB_pipeline_statistics_query
+		};
+
+	public:
+		explicit GpuFrameStats( std::size_t aMaxFrames );
+		~GpuFrameStats();
+
+		GpuFrameStats( GpuFrameStats const& ) = delete;
+		GpuFrameStats& operator= (GpuFrameStats const&) = delete;
+
+		GpuFrameStats( GpuFrameStats&& ) noexcept;
+		GpuFrameStats& operator= (GpuFrameStats&&) noexcept;
+
+	public:
+		void begin_frame();
+		void end_frame();
+
+		Totals totals() const;
+		void reset() noexcept;
+
+		std::size_t frames() const noexcept;
+		bool full() const noexcept;
+
+	private:
+		std::vector<GLuint> mTimeQueries;
+		std::vector<GLuint> mInvocationQueries; // Empty if not supported
+
+		std::size_t mFrames;
+		bool mActive;
+};
+
+#endif // GPU_FRAME_STATS_HPP_2C572A6F_4737_4992_9624_0E7FB32423AA
@@ -0,0 +1,239 @@
+#include "gpu_mesh.hpp"
+
+#include <vector>
+#include <utility>
+
+#include "../support/checkpoint.hpp"
+
+namespace
+{
+	template< typename tType >
+	tType attrib_or_( std::vector<tType> const& aValues, std::size_t aIndex, tType aDefault ) noexcept
+	{
+		return aIndex < aValues.size() ? aValues[aIndex] : aDefault;
+	}
+
+	void upload_( GLuint aBuffer, std::size_t aSize, void const* aData )
+	{
+		// Immutable storage lets the driver place the data optimally, as it
+		// knows that the buffer will never be resized or written by the CPU.
+		glBindBuffer( GL_COPY_WRITE_BUFFER, aBuffer );
+
+		if( GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage )
+			glBufferStorage( GL_COPY_WRITE_BUFFER, GLsizeiptr(aSize), aData, 0 );
+		else
+			glBufferData( GL_COPY_WRITE_BUFFER, GLsizeiptr(aSize), aData, GL_STATIC_DRAW );
+
+		glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+	}
+}
+
+InterleavedVertex interleaved_vertex( SimpleMeshData const& aMeshData, std::size_t aIndex ) noexcept
+{
+	Vec3f const defaultColor{ 1.f, 1.f, 1.f };
+	Vec3f const defaultNormal{ 0.f, 0.f, 0.f };
+	Vec2f const defaultTexCoord{ 0.f, 0.f };
+
+	return InterleavedVertex{
+		aMeshData.positions[aIndex],
+		attrib_or_( aMeshData.colors, aIndex, defaultColor ),
+		attrib_or_( aMeshData.normals, aIndex, defaultNormal ),
+		attrib_or_( aMeshData.texCoords, aIndex, defaultTexCoord )
+	};
+}
+
+void set_interleaved_vertex_format( GLuint aBinding ) noexcept
+{
+	glVertexAttribFormat( kAttribPosition, 3, GL_FLOAT, GL_FALSE, offsetof(InterleavedVertex, position) );
+	glVertexAttribFormat( kAttribColor, 3, GL_FLOAT, GL_FALSE, offsetof(InterleavedVertex, color) );
+	glVertexAttribFormat( kAttribNormal, 3, GL_FLOAT, GL_FALSE, offsetof(InterleavedVertex, normal) );
+	glVertexAttribFormat( kAttribTexCoord, 2, GL_FLOAT, GL_FALSE, offsetof(InterleavedVertex, texCoord) );
+
+	for( GLuint attrib : { kAttribPosition, kAttribColor, kAttribNormal, kAttribTexCoord } )
+	{
+		glVertexAttribBinding( attrib, aBinding );
+		glEnableVertexAttribArray( attrib );
+	}
+}
+
+void set_interleaved_position_format( GLuint aBinding ) noexcept
+{
+	glVertexAttribFormat( kAttribPosition, 3, GL_FLOAT, GL_FALSE, offsetof(InterleavedVertex, position) );
+	glVertexAttribBinding( kAttribPosition, aBinding );
+	glEnableVertexAttribArray( kAttribPosition );
+}
+
+GpuMesh::GpuMesh() noexcept
+	: mVao( 0 )
+	, mBuffer( 0 )
+	, mIndexBuffer( 0 )
+	, mVertexCount( 0 )
+	, mIndexCount( 0 )
+	, mSizeBytes( 0 )
+	, mLayout( VertexLayout::Interleaved )
+{}
+
+GpuMesh::GpuMesh( SimpleMeshData const& aMeshData, VertexLayout aLayout )
+	: GpuMesh()
+{
+	auto const count = aMeshData.positions.size();
+
+	mVertexCount = GLsizei(count);
+	mLayout = aLayout;
+
+	Vec3f const defaultColor{ 1.f, 1.f, 1.f };
+	Vec3f const defaultNormal{ 0.f, 0.f, 0.f };
+	Vec2f const defaultTexCoord{ 0.f, 0.f };
+
+	glGenVertexArrays( 1, &mVao );
+	glGenBuffers( 1, &mBuffer );
+
+	glBindVertexArray( mVao );
+
+	if( VertexLayout::Interleaved == aLayout )
+	{
+		std::vector<InterleavedVertex> vertices( count );
+		for( std::size_t i = 0; i < count; ++i )
+			vertices[i] = interleaved_vertex( aMeshData, i );
+
+		mSizeBytes = vertices.size() * sizeof(InterleavedVertex);
+		upload_( mBuffer, mSizeBytes, vertices.data() );
+
+		// All attributes are sourced from binding point 0.
+		set_interleaved_vertex_format( 0 );
+		glBindVertexBuffer( 0, mBuffer, 0, sizeof(InterleavedVertex) );
+	}
+	else
+	{
+		// One block per attribute, back to back in the same buffer.
+		std::size_t const positionOffset = 0;
+		std::size_t const colorOffset = positionOffset + count * sizeof(Vec3f);
+		std::size_t const normalOffset = colorOffset + count * sizeof(Vec3f);
+		std::size_t const texCoordOffset = normalOffset + count * sizeof(Vec3f);
+		mSizeBytes = texCoordOffset + count * sizeof(Vec2f);
+
+		std::vector<std::byte> data( mSizeBytes );
+		auto* positions = reinterpret_cast<Vec3f*>(data.data() + positionOffset);
+		auto* colors = reinterpret_cast<Vec3f*>(data.data() + colorOffset);
+		auto* normals = reinterpret_cast<Vec3f*>(data.data() + normalOffset);
+		auto* texCoords = reinterpret_cast<Vec2f*>(data.data() + texCoordOffset);
+
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			positions[i] = aMeshData.positions[i];
+			colors[i] = attrib_or_( aMeshData.colors, i, defaultColor );
+			normals[i] = attrib_or_( aMeshData.normals, i, defaultNormal );
+			texCoords[i] = attrib_or_( aMeshData.texCoords, i, defaultTexCoord );
+		}
+
+		upload_( mBuffer, mSizeBytes, data.data() );
+
+		// One binding point per attribute (binding == attribute location)
+		struct { GLuint attrib; GLint size; std::size_t offset; GLsizei stride; } const attribs[] = {
+			{ kAttribPosition, 3, positionOffset, sizeof(Vec3f) },
+			{ kAttribColor, 3, colorOffset, sizeof(Vec3f) },
+			{ kAttribNormal, 3, normalOffset, sizeof(Vec3f) },
+			{ kAttribTexCoord, 2, texCoordOffset, sizeof(Vec2f) }
+		};
+
+		for( auto const& attrib : attribs )
+		{
+			glVertexAttribFormat( attrib.attrib, attrib.size, GL_FLOAT, GL_FALSE, 0 );
+			glVertexAttribBinding( attrib.attrib, attrib.attrib );
+			glEnableVertexAttribArray( attrib.attrib );
+			glBindVertexBuffer( attrib.attrib, mBuffer, GLintptr(attrib.offset), attrib.stride );
+		}
+	}
+
+	glBindVertexArray( 0 );
+
+	OGL_CHECKPOINT_DEBUG();
+}
+
+GpuMesh::GpuMesh( std::vector<InterleavedVertex> const& aVertices, std::vector<GLuint> const& aIndices )
+	: GpuMesh()
+{
+	mVertexCount = GLsizei(aVertices.size());
+	mIndexCount = GLsizei(aIndices.size());
+	mSizeBytes = aVertices.size() * sizeof(InterleavedVertex);
+
+	glGenVertexArrays( 1, &mVao );
+	glGenBuffers( 1, &mBuffer );
+	glGenBuffers( 1, &mIndexBuffer );
+
+	upload_( mBuffer, mSizeBytes, aVertices.data() );
+	upload_( mIndexBuffer, aIndices.size() * sizeof(GLuint), aIndices.data() );
+
+	glBindVertexArray( mVao );
+
+	// The GL_ELEMENT_ARRAY_BUFFER binding is part of the VAO state.
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer );
+
+	set_interleaved_vertex_format( 0 );
+	glBindVertexBuffer( 0, mBuffer, 0, sizeof(InterleavedVertex) );
+
+	glBindVertexArray( 0 );
+
+	OGL_CHECKPOINT_DEBUG();
+}
+
+GpuMesh::~GpuMesh()
+{
+	if( 0 != mVao )
+		glDeleteVertexArrays( 1, &mVao );
+
+	GLuint const buffers[] = { mBuffer, mIndexBuffer };
+	glDeleteBuffers( 2, buffers ); // Zeros are silently ignored
+}
+
+GpuMesh::GpuMesh( GpuMesh&& aOther ) noexcept
+	: mVao( std::exchange( aOther.mVao, 0 ) )
+	, mBuffer( std::exchange( aOther.mBuffer, 0 ) )
+	, mIndexBuffer( std::exchange( aOther.mIndexBuffer, 0 ) )
+	, mVertexCount( std::exchange( aOther.mVertexCount, 0 ) )
+	, mIndexCount( std::exchange( aOther.mIndexCount, 0 ) )
+	, mSizeBytes( std::exchange( aOther.mSizeBytes, 0 ) )
+	, mLayout( aOther.mLayout )
+{}
+GpuMesh& GpuMesh::operator= (GpuMesh&& aOther) noexcept
+{
+	std::swap( mVao, aOther.mVao );
+	std::swap( mBuffer, aOther.mBuffer );
+	std::swap( mIndexBuffer, aOther.mIndexBuffer );
+	std::swap( mVertexCount, aOther.mVertexCount );
+	std::swap( mIndexCount, aOther.mIndexCount );
+	std::swap( mSizeBytes, aOther.mSizeBytes );
+	std::swap( mLayout, aOther.mLayout );
+	return *this;
+}
+
+GLuint GpuMesh::vao() const noexcept
+{
+	return mVao;
+}
+GLuint GpuMesh::buffer() const noexcept
+{
+	return mBuffer;
+}
+GLuint GpuMesh::index_buffer() const noexcept
+{
+	return mIndexBuffer;
+}
+
+GLsizei GpuMesh::vertex_count() const noexcept
+{
+	return mVertexCount;
+}
+GLsizei GpuMesh::index_count() const noexcept
+{
+	return mIndexCount;
+}
+std::size_t GpuMesh::size_bytes() const noexcept
+{
+	return mSizeBytes;
+}
+
+VertexLayout GpuMesh::layout() const noexcept
+{
+	return mLayout;
+}
@@ -0,0 +1,114 @@
+#ifndef GPU_MESH_HPP_8C1D4E7F_2A35_4B96_9E0D_71F3A6C85B24
+#define GPU_MESH_HPP_8C1D4E7F_2A35_4B96_9E0D_71F3A6C85B24
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+
+#include "simple_mesh.hpp"
+
+// Vertex attribute locations used by all mesh shaders
+constexpr GLuint kAttribPosition = 0;
+constexpr GLuint kAttribColor = 1;
+constexpr GLuint kAttribNormal = 2;
+constexpr GLuint kAttribTexCoord = 3;
+
+// One vertex in the interleaved layout (see VertexLayout)
+struct InterleavedVertex
+{
+	Vec3f position;
+	Vec3f color;
+	Vec3f normal;
+	Vec2f texCoord;
+};
+
+static_assert( sizeof(InterleavedVertex) == 44 );
+
+// Returns vertex aIndex of the mesh data. Missing attributes are replaced by
+// defaults (white, zero normal, zero texture coordinates).
+InterleavedVertex interleaved_vertex( SimpleMeshData const&, std::size_t aIndex ) noexcept;
+
+// Specifies the InterleavedVertex attribute formats for the currently bound
+// VAO, all sourced from vertex buffer binding point aBinding.
+void set_interleaved_vertex_format( GLuint aBinding ) noexcept;
+
+// Like set_interleaved_vertex_format(), but only enables the position
+// attribute. Used for depth-only passes, which do not need the other
+// attributes to be fetched.
+void set_interleaved_position_format( GLuint aBinding ) noexcept;
+
+/* Memory layout of the vertex data inside the mesh's single buffer
+ *
+ * Interleaved: one struct per vertex (position, color, normal, texcoord).
+ *   All attributes of a vertex share a cache line, which is usually what the
+ *   vertex fetch wants. This is the default.
+ * Planar: each attribute in its own contiguous block ("SoA"). Useful for
+ *   passes that only read some of the attributes (e.g., position-only).
+ */
+enum class VertexLayout
+{
+	Interleaved,
+	Planar
+};
+
+/* GPU-side mesh with RAII ownership
+ *
+ * Uploads a SimpleMeshData into one immutable buffer (glBufferStorage where
+ * available) and sets up a VAO with separate attribute formats
+ * (glVertexAttribFormat/glBindVertexBuffer). The VAO and the buffer are
+ * deleted when the GpuMesh is destroyed.
+ *
+ * Attributes that are missing from the SimpleMeshData (e.g., texture
+ * coordinates of the procedural shapes) are filled with defaults.
+ *
+ * An indexed mesh is created from vertices that are already interleaved
+ * (e.g., welded ones, see weld_vertices()). Its index buffer is part of the
+ * VAO, and is deleted with the mesh.
+ */
+class GpuMesh final
+{
+	public:
+		GpuMesh() noexcept;
+		explicit GpuMesh(
+			SimpleMeshData const&,
+			VertexLayout = VertexLayout::Interleaved
+		);
+		GpuMesh(
+			std::vector<InterleavedVertex> const&,
+			std::vector<GLuint> const& aIndices
+		);
+
+		~GpuMesh();
+
+		GpuMesh( GpuMesh const& ) = delete;
+		GpuMesh& operator= (GpuMesh const&) = delete;
+
+		GpuMesh( GpuMesh&& ) noexcept;
+		GpuMesh& operator= (GpuMesh&&) noexcept;
+
+	public:
+		GLuint vao() const noexcept;
+		GLuint buffer() const noexcept;
+		GLuint index_buffer() const noexcept; // 0 unless indexed
+
+		GLsizei vertex_count() const noexcept;
+		GLsizei index_count() const noexcept;
+		std::size_t size_bytes() const noexcept; // Of buffer()
+
+		VertexLayout layout() const noexcept;
+
+	private:
+		GLuint mVao;
+		GLuint mBuffer;
+		GLuint mIndexBuffer;
+
+		GLsizei mVertexCount;
+		GLsizei mIndexCount;
+		std::size_t mSizeBytes;
+
+		VertexLayout mLayout;
+};
+
+#endif // GPU_MESH_HPP_8C1D4E7F_2A35_4B96_9E0D_71F3A6C85B24
@@ -0,0 +1,371 @@
+#include "hiz.hpp"
+
+#include <utility>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+#include <cstring>
+
+#include "../support/error.hpp"
+#include "../support/checkpoint.hpp"
+
+namespace
+{
+	// Work group size of hiz.comp
+	constexpr GLuint kGroupSize_ = 8;
+
+	// Image units used by hiz.comp
+	constexpr GLuint kSrcImageUnit_ = 0;
+	constexpr GLuint kDstImageUnit_ = 1;
+
+	GLsizei level_size_( GLsizei aSize, GLint aLevel ) noexcept
+	{
+		return std::max<GLsizei>( 1, aSize >> aLevel );
+	}
+}
+
+HiZBuffer::HiZBuffer( ShaderProgram& aBuildProgram )
+	: mProgram( &aBuildProgram )
+	, mLevelUniform( aBuildProgram.uniform<int>( "level" ) )
+	, mPyramid( 0 )
+	, mDepthCopy( 0 )
+	, mReadback( 0 )
+	, mFence( nullptr )
+	, mWidth( 0 )
+	, mHeight( 0 )
+	, mCopyWidth( 0 )
+	, mCopyHeight( 0 )
+	, mLevels( 0 )
+	, mReadbackLevel( 0 )
+	, mReadbackWidth( 0 )
+	, mReadbackHeight( 0 )
+	, mPyramidProjView( kIdentity44f )
+	, mPendingProjView( kIdentity44f )
+	, mHasPyramid( false )
+	, mProjView( kIdentity44f )
+	, mDepthWidth( 0 )
+	, mDepthHeight( 0 )
+	, mDepthLevel( 0 )
+	, mValid( false )
+{}
+
+HiZBuffer::~HiZBuffer()
+{
+	release_();
+
+	if( 0 != mDepthCopy )
+		glDeleteTextures( 1, &mDepthCopy );
+}
+
+HiZBuffer::HiZBuffer( HiZBuffer&& aOther ) noexcept
+	: mProgram( aOther.mProgram )
+	, mLevelUniform( aOther.mLevelUniform )
+	, mPyramid( std::exchange( aOther.mPyramid, 0 ) )
+	, mDepthCopy( std::exchange( aOther.mDepthCopy, 0 ) )
+	, mReadback( std::exchange( aOther.mReadback, 0 ) )
+	, mFence( std::exchange( aOther.mFence, nullptr ) )
+	, mWidth( std::exchange( aOther.mWidth, 0 ) )
+	, mHeight( std::exchange( aOther.mHeight, 0 ) )
+	, mCopyWidth( std::exchange( aOther.mCopyWidth, 0 ) )
+	, mCopyHeight( std::exchange( aOther.mCopyHeight, 0 ) )
+	, mLevels( aOther.mLevels )
+	, mReadbackLevel( aOther.mReadbackLevel )
+	, mReadbackWidth( aOther.mReadbackWidth )
+	, mReadbackHeight( aOther.mReadbackHeight )
+	, mPyramidProjView( aOther.mPyramidProjView )
+	, mPendingProjView( aOther.mPendingProjView )
+	, mHasPyramid( std::exchange( aOther.mHasPyramid, false ) )
+	, mDepth( std::move(aOther.mDepth) )
+	, mProjView( aOther.mProjView )
+	, mDepthWidth( aOther.mDepthWidth )
+	, mDepthHeight( aOther.mDepthHeight )
+	, mDepthLevel( aOther.mDepthLevel )
+	, mValid( std::exchange( aOther.mValid, false ) )
+{}
+HiZBuffer& HiZBuffer::operator= (HiZBuffer&& aOther) noexcept
+{
+	std::swap( mProgram, aOther.mProgram );
+	std::swap( mLevelUniform, aOther.mLevelUniform );
+	std::swap( mPyramid, aOther.mPyramid );
+	std::swap( mDepthCopy, aOther.mDepthCopy );
+	std::swap( mReadback, aOther.mReadback );
+	std::swap( mFence, aOther.mFence );
+	std::swap( mWidth, aOther.mWidth );
+	std::swap( mHeight, aOther.mHeight );
+	std::swap( mCopyWidth, aOther.mCopyWidth );
+	std::swap( mCopyHeight, aOther.mCopyHeight );
+	std::swap( mLevels, aOther.mLevels );
+	std::swap( mReadbackLevel, aOther.mReadbackLevel );
+	std::swap( mReadbackWidth, aOther.mReadbackWidth );
+	std::swap( mReadbackHeight, aOther.mReadbackHeight );
+	std::swap( mPyramidProjView, aOther.mPyramidProjView );
+	std::swap( mPendingProjView, aOther.mPendingProjView );
+	std::swap( mHasPyramid, aOther.mHasPyramid );
+	std::swap( mDepth, aOther.mDepth );
+	std::swap( mProjView, aOther.mProjView );
+	std::swap( mDepthWidth, aOther.mDepthWidth );
+	std::swap( mDepthHeight, aOther.mDepthHeight );
+	std::swap( mDepthLevel, aOther.mDepthLevel );
+	std::swap( mValid, aOther.mValid );
+	return *this;
+}
+
+GLuint HiZBuffer::copy_framebuffer_depth( GLsizei aWidth, GLsizei aHeight )
+{
+	if( aWidth != mCopyWidth || aHeight != mCopyHeight )
+	{
+		if( 0 != mDepthCopy )
+			glDeleteTextures( 1, &mDepthCopy );
+
+		glGenTextures( 1, &mDepthCopy );
+		glBindTexture( GL_TEXTURE_2D, mDepthCopy );
+		glTexStorage2D( GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, aWidth, aHeight );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+		mCopyWidth = aWidth;
+		mCopyHeight = aHeight;
+	}
+	else
+	{
+		glBindTexture( GL_TEXTURE_2D, mDepthCopy );
+	}
+
+	// Reads from the read framebuffer's depth buffer, as the texture has a
+	// depth format.
+	glCopyTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, 0, 0, aWidth, aHeight );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	OGL_CHECKPOINT_DEBUG();
+
+	return mDepthCopy;
+}
+
+void HiZBuffer::build( GLuint aDepthTexture, GLsizei aWidth, GLsizei aHeight, Mat44f const& aProjView )
+{
+	assert( 0 != aDepthTexture );
+
+	// A resize drops the pyramid and any readback in flight.
+	if( aWidth != mWidth || aHeight != mHeight )
+		allocate_( aWidth, aHeight );
+
+	glUseProgram( mProgram->programId() );
+
+	glActiveTexture( GL_TEXTURE0 );
+	glBindTexture( GL_TEXTURE_2D, aDepthTexture );
+
+	for( GLint level = 0; level < mLevels; ++level )
+	{
+		// Level 0 samples the depth texture; the others reduce the previous
+		// level.
+		if( level > 0 )
+			glBindImageTexture( kSrcImageUnit_, mPyramid, level-1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F );
+		glBindImageTexture( kDstImageUnit_, mPyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F );
+
+		mProgram->set( mLevelUniform, level );
+
+		auto const w = GLuint(level_size_( mWidth, level ));
+		auto const h = GLuint(level_size_( mHeight, level ));
+		glDispatchCompute( (w + kGroupSize_ - 1) / kGroupSize_, (h + kGroupSize_ - 1) / kGroupSize_, 1 );
+
+		glMemoryBarrier( GL_SHADER_IMAGE_ACCESS_BARRIER_BIT );
+	}
+
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	mPyramidProjView = aProjView;
+	mHasPyramid = true;
+
+	if( mFence )
+		return; // Previous readback still in flight
+
+	// Asynchronous readback of the coarse level
+	glMemoryBarrier( GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT );
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, mReadback );
+	glBindTexture( GL_TEXTURE_2D, mPyramid );
+	glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+	glGetTexImage( GL_TEXTURE_2D, mReadbackLevel, GL_RED, GL_FLOAT, nullptr );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	mFence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	mPendingProjView = aProjView;
+
+	OGL_CHECKPOINT_DEBUG();
+}
+
+void HiZBuffer::update()
+{
+	if( !mFence )
+		return;
+
+	auto const ret = glClientWaitSync( mFence, 0, 0 );
+	if( GL_TIMEOUT_EXPIRED == ret )
+		return;
+
+	if( GL_WAIT_FAILED == ret )
+		throw Error( "HiZBuffer: glClientWaitSync() failed" );
+
+	glDeleteSync( mFence );
+	mFence = nullptr;
+
+	auto const count = std::size_t(mReadbackWidth) * std::size_t(mReadbackHeight);
+	mDepth.resize( count );
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, mReadback );
+	if( auto const* data = glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(count * sizeof(float)), GL_MAP_READ_BIT ) )
+	{
+		std::memcpy( mDepth.data(), data, count * sizeof(float) );
+		glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+
+		mProjView = mPendingProjView;
+		mDepthWidth = mReadbackWidth;
+		mDepthHeight = mReadbackHeight;
+		mDepthLevel = mReadbackLevel;
+		mValid = true;
+	}
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+}
+
+void HiZBuffer::invalidate() noexcept
+{
+	mValid = false;
+	mHasPyramid = false;
+}
+
+bool HiZBuffer::valid() const noexcept
+{
+	return mValid;
+}
+
+bool HiZBuffer::occluded( AABB const& aBox ) const noexcept
+{
+	if( !mValid )
+		return false;
+
+	float minX = 1.f, maxX = -1.f, minY = 1.f, maxY = -1.f;
+	float nearest = 1.f;
+
+	for( int i = 0; i < 8; ++i )
+	{
+		Vec4f const corner{
+			(i & 1) ? aBox.max.x : aBox.min.x,
+			(i & 2) ? aBox.max.y : aBox.min.y,
+			(i & 4) ? aBox.max.z : aBox.min.z,
+			1.f
+		};
+
+		auto const clip = mProjView * corner;
+
+		// Boxes that reach the near plane are never occluded.
+		if( clip.w <= 0.f || clip.z < -clip.w )
+			return false;
+
+		float const invW = 1.f / clip.w;
+		minX = std::min( minX, clip.x * invW );
+		maxX = std::max( maxX, clip.x * invW );
+		minY = std::min( minY, clip.y * invW );
+		maxY = std::max( maxY, clip.y * invW );
+		nearest = std::min( nearest, clip.z * invW * .5f + .5f );
+	}
+
+	if( maxX < -1.f || minX > 1.f || maxY < -1.f || minY > 1.f )
+		return false; // Outside of the view; left to frustum culling
+
+	// Pixel rectangle at full resolution, then texels of the read-back level
+	auto const texel = [this] (float aNdc, GLsizei aFullSize, GLsizei aLevelSize) {
+		float const pixel = std::clamp( (aNdc * .5f + .5f) * float(aFullSize), 0.f, float(aFullSize - 1) );
+		return std::min( GLsizei(pixel) >> mDepthLevel, aLevelSize - 1 );
+	};
+
+	auto const x0 = texel( minX, mWidth, mDepthWidth ), x1 = texel( maxX, mWidth, mDepthWidth );
+	auto const y0 = texel( minY, mHeight, mDepthHeight ), y1 = texel( maxY, mHeight, mDepthHeight );
+
+	for( GLsizei y = y0; y <= y1; ++y )
+	{
+		for( GLsizei x = x0; x <= x1; ++x )
+		{
+			if( nearest <= mDepth[std::size_t(y) * std::size_t(mDepthWidth) + std::size_t(x)] )
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool HiZBuffer::has_pyramid() const noexcept
+{
+	return mHasPyramid;
+}
+GLuint HiZBuffer::pyramid() const noexcept
+{
+	return mPyramid;
+}
+GLint HiZBuffer::pyramid_levels() const noexcept
+{
+	return mLevels;
+}
+Mat44f const& HiZBuffer::pyramid_proj_view() const noexcept
+{
+	return mPyramidProjView;
+}
+
+GLsizei HiZBuffer::width() const noexcept
+{
+	return mWidth;
+}
+GLsizei HiZBuffer::height() const noexcept
+{
+	return mHeight;
+}
+
+void HiZBuffer::allocate_( GLsizei aWidth, GLsizei aHeight )
+{
+	release_();
+
+	mWidth = aWidth;
+	mHeight = aHeight;
+	mLevels = 1 + GLint(std::floor( std::log2( float(std::max( aWidth, aHeight )) ) ));
+
+	mReadbackLevel = 0;
+	while( mReadbackLevel + 1 < mLevels && level_size_( aWidth, mReadbackLevel ) > kHiZReadbackWidth )
+		++mReadbackLevel;
+
+	mReadbackWidth = level_size_( aWidth, mReadbackLevel );
+	mReadbackHeight = level_size_( aHeight, mReadbackLevel );
+
+	glGenTextures( 1, &mPyramid );
+	glBindTexture( GL_TEXTURE_2D, mPyramid );
+	glTexStorage2D( GL_TEXTURE_2D, mLevels, GL_R32F, aWidth, aHeight );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	glGenBuffers( 1, &mReadback );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, mReadback );
+	glBufferData( GL_PIXEL_PACK_BUFFER, GLsizeiptr(std::size_t(mReadbackWidth) * std::size_t(mReadbackHeight) * sizeof(float)), nullptr, GL_STREAM_READ );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+void HiZBuffer::release_() noexcept
+{
+	if( mFence )
+	{
+		glDeleteSync( mFence );
+		mFence = nullptr;
+	}
+
+	if( 0 != mPyramid )
+		glDeleteTextures( 1, &mPyramid );
+	if( 0 != mReadback )
+		glDeleteBuffers( 1, &mReadback );
+
+	mPyramid = mReadback = 0;
+	mWidth = mHeight = 0;
+	mValid = false;
+	mHasPyramid = false;
+}
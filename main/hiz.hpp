@@ -0,0 +1,113 @@
+#ifndef HIZ_HPP_0165904B_2BA1_4D00_80A7_4FD6E5FAF01E
+#define HIZ_HPP_0165904B_2BA1_4D00_80A7_4FD6E5FAF01E
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+
+#include "../vmlib/aabb.hpp"
+#include "../vmlib/mat44.hpp"
+
+#include "../support/program.hpp"
+
+/* Hierarchical-Z occlusion culling
+ *
+ * build() reduces a frame's depth buffer into a depth pyramid (Hi-Z) with a
+ * compute shader (hiz.comp): level 0 is a copy of the depth buffer, and each
+ * texel of level n holds the farthest depth of the texels of level n-1 that
+ * it covers. A coarse level (at most kHiZReadbackWidth texels wide) is then
+ * read back asynchronously through a pixel buffer object.
+ *
+ * The readback is used one frame later: update() picks it up once the GPU
+ * is done, and occluded() tests bounds against it on the CPU. A box is
+ * occluded if its nearest point is behind the farthest depth in all of the
+ * texels that it covers. The test uses the view-projection matrix of the
+ * frame that produced the depth, so it stays conservative while the camera
+ * moves; objects may pop in one frame late.
+ *
+ * The pyramid itself can also be sampled on the GPU (see GpuCuller), with
+ * the view-projection matrix returned by pyramid_proj_view(). It is rebuilt
+ * on every build(), even while a readback is in flight.
+ *
+ * The build program (hiz.comp) must outlive the HiZBuffer.
+ */
+constexpr GLsizei kHiZReadbackWidth = 160;
+
+class HiZBuffer final
+{
+	public:
+		explicit HiZBuffer( ShaderProgram& aBuildProgram );
+		~HiZBuffer();
+
+		HiZBuffer( HiZBuffer const& ) = delete;
+		HiZBuffer& operator= (HiZBuffer const&) = delete;
+
+		HiZBuffer( HiZBuffer&& ) noexcept;
+		HiZBuffer& operator= (HiZBuffer&&) noexcept;
+
+	public:
+		// Copies the depth buffer of the current read framebuffer into an
+		// internal depth texture, and returns that texture. For framebuffers
+		// whose depth cannot be sampled (e.g., the default framebuffer).
+		GLuint copy_framebuffer_depth( GLsizei aWidth, GLsizei aHeight );
+
+		// Builds the pyramid from aDepthTexture, which was rendered with
+		// aProjView, and starts reading it back. The readback is skipped
+		// while the previous one is still in flight.
+		void build( GLuint aDepthTexture, GLsizei aWidth, GLsizei aHeight, Mat44f const& aProjView );
+
+		// Picks up a finished readback. Does not wait for the GPU.
+		void update();
+
+		// Drops the current data (e.g., when the occlusion test is disabled);
+		// occluded() returns false until the next readback, and
+		// has_pyramid() until the next build().
+		void invalidate() noexcept;
+
+		bool valid() const noexcept;
+		bool occluded( AABB const& ) const noexcept;
+
+		// GPU access to the pyramid (GL_R32F, pyramid_levels() levels, level 0
+		// is width() x height())
+		bool has_pyramid() const noexcept;
+		GLuint pyramid() const noexcept;
+		GLint pyramid_levels() const noexcept;
+		Mat44f const& pyramid_proj_view() const noexcept;
+
+		GLsizei width() const noexcept;
+		GLsizei height() const noexcept;
+
+	private:
+		void allocate_( GLsizei aWidth, GLsizei aHeight );
+		void release_() noexcept;
+
+	private:
+		ShaderProgram* mProgram;
+		ShaderProgram::Uniform<int> mLevelUniform;
+
+		GLuint mPyramid;     // GL_R32F, full mip chain
+		GLuint mDepthCopy;   // See copy_framebuffer_depth()
+		GLuint mReadback;    // GL_PIXEL_PACK_BUFFER
+		GLsync mFence;       // Readback in flight, if non-null
+
+		GLsizei mWidth, mHeight;
+		GLsizei mCopyWidth, mCopyHeight;
+		GLint mLevels;
+		GLint mReadbackLevel;
+		GLsizei mReadbackWidth, mReadbackHeight;
+
+		Mat44f mPyramidProjView;
+		Mat44f mPendingProjView;
+		bool mHasPyramid;
+
+		// CPU copy of the read-back level
+		std::vector<float> mDepth;
+		Mat44f mProjView;
+		GLsizei mDepthWidth, mDepthHeight;
+		GLint mDepthLevel;
+		bool mValid;
+};
+
+#endif // HIZ_HPP_0165904B_2BA1_4D00_80A7_4FD6E5FAF01E
@@ -0,0 +1,264 @@
+#include "hud.hpp"
+
+#include <algorithm>
+
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#	include <psapi.h>
+#elif defined(__linux__)
+#	include <unistd.h>
+#endif
+
+#include "../support/checkpoint.hpp"
+
+namespace
+{
+	// Layout, in pixels
+	constexpr float kFontSize_ = 15.f;
+	constexpr float kLineHeight_ = 18.f;
+	constexpr float kMargin_ = 8.f;
+	constexpr float kPanelWidth_ = 400.f;
+	constexpr float kGraphHeight_ = 60.f;
+	constexpr float kCpuColumn_ = 250.f;
+	constexpr float kGpuColumn_ = 320.f;
+
+	// The graph spans 0 to kGraphMaxMs_; frames at 60 Hz reach the line.
+	constexpr float kGraphMaxMs_ = 1000.f / 30.f;
+	constexpr float kGraphLineMs_ = 1000.f / 60.f;
+
+	constexpr std::uint32_t kBackground_ = rgba( 0, 0, 0, 170 );
+	constexpr std::uint32_t kText_ = rgba( 230, 230, 230 );
+	constexpr std::uint32_t kHeading_ = rgba( 140, 200, 255 );
+	constexpr std::uint32_t kFast_ = rgba( 90, 220, 90 );
+	constexpr std::uint32_t kSlow_ = rgba( 240, 200, 60 );
+	constexpr std::uint32_t kVerySlow_ = rgba( 240, 70, 60 );
+	constexpr std::uint32_t kGraphLine_ = rgba( 255, 255, 255, 90 );
+
+	// The same literal may have different addresses in different translation
+	// units.
+	bool same_name_( Profiler::ScopeStats const& aA, Profiler::ScopeStats const& aB ) noexcept
+	{
+		return aA.name == aB.name || 0 == std::strcmp( aA.name, aB.name );
+	}
+
+	// Resident set size (working set on Windows), or 0 if unknown
+	std::size_t resident_bytes_()
+	{
+#		if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters{};
+		if( GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof(counters) ) )
+			return std::size_t(counters.WorkingSetSize);
+		return 0;
+#		elif defined(__linux__)
+		std::size_t pages = 0, resident = 0;
+		if( std::FILE* fin = std::fopen( "/proc/self/statm", "r" ) )
+		{
+			if( 2 != std::fscanf( fin, "%zu %zu", &pages, &resident ) )
+				resident = 0;
+			std::fclose( fin );
+		}
+		return resident * std::size_t(sysconf( _SC_PAGESIZE ));
+#		else
+		return 0;
+#		endif
+	}
+}
+
+Hud::Hud( TextRenderer& aText )
+	: mText( &aText )
+	, mQueryPending{}
+	, mQuery( 0 )
+	, mSceneActive( false )
+	, mFrameMs{}
+	, mFrameIndex( 0 )
+	, mFrameCount( 0 )
+	, mLastRefresh{}
+	, mAvgFrameMs( 0.f )
+	, mMaxFrameMs( 0.f )
+	, mPrimitives( 0 )
+	, mDrawCalls( 0 )
+	, mAllocs{}
+	, mResidentBytes( 0 )
+{
+	OGL_CHECKPOINT_ALWAYS();
+
+	glGenQueries( GLsizei(kQueries_), mPrimitiveQueries.data() );
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+Hud::~Hud()
+{
+	glDeleteQueries( GLsizei(kQueries_), mPrimitiveQueries.data() );
+}
+
+void Hud::begin_scene()
+{
+	assert( !mSceneActive );
+
+	// The oldest query is reused. Its result is read if it is available,
+	// and is dropped otherwise.
+	mQuery = (mQuery + 1) % kQueries_;
+	auto const query = mPrimitiveQueries[mQuery];
+
+	if( mQueryPending[mQuery] )
+	{
+		GLint available = 0;
+		glGetQueryObjectiv( query, GL_QUERY_RESULT_AVAILABLE, &available );
+		if( available )
+		{
+			GLuint64 primitives = 0;
+			glGetQueryObjectui64v( query, GL_QUERY_RESULT, &primitives );
+			mPrimitives = primitives;
+		}
+	}
+
+	glBeginQuery( GL_PRIMITIVES_GENERATED, query );
+	mQueryPending[mQuery] = true;
+	mSceneActive = true;
+}
+
+void Hud::end_scene()
+{
+	assert( mSceneActive );
+
+	glEndQuery( GL_PRIMITIVES_GENERATED );
+	mSceneActive = false;
+}
+
+void Hud::draw( float aFrameSeconds, FrameCounters const& aCounters, Profiler const* aProfiler, float aWidth, float aHeight )
+{
+	mFrameMs[mFrameIndex] = aFrameSeconds * 1e3f;
+	mFrameIndex = (mFrameIndex + 1) % kFrameHistory;
+	mFrameCount = std::min( mFrameCount + 1, kFrameHistory );
+
+	auto const now = Clock::now();
+	if( now - mLastRefresh >= kRefreshInterval )
+	{
+		refresh_( aCounters, aProfiler );
+		mLastRefresh = now;
+	}
+
+	// Panel: summary lines, graph, scope table
+	std::size_t const tableLines = mRows.empty() ? 0 : mRows.size() + 1;
+	float const panelHeight = kMargin_ * (mRows.empty() ? 3.f : 4.f) + kLineHeight_ * float(4 + tableLines) + kGraphHeight_;
+
+	mText->rect( kMargin_, kMargin_, kMargin_ + kPanelWidth_, kMargin_ + panelHeight, kBackground_ );
+
+	float const x = 2.f * kMargin_;
+	float y = 2.f * kMargin_;
+
+	char line[128];
+	float const fps = mAvgFrameMs > 0.f ? 1e3f / mAvgFrameMs : 0.f;
+	std::snprintf( line, sizeof(line), "%.1f FPS  %.2f ms (max %.2f ms)", double(fps), double(mAvgFrameMs), double(mMaxFrameMs) );
+	mText->text( x, y + kFontSize_, line, kText_, kFontSize_ );
+	y += kLineHeight_;
+
+	draw_graph_( x, y, kPanelWidth_ - 2.f * kMargin_, kGraphHeight_ );
+	y += kGraphHeight_ + kMargin_;
+
+	std::snprintf( line, sizeof(line), "%zu draw calls, %llu primitives", mDrawCalls, (unsigned long long)mPrimitives );
+	mText->text( x, y + kFontSize_, line, kText_, kFontSize_ );
+	y += kLineHeight_;
+
+	std::snprintf( line, sizeof(line), "%llu allocations, %.1f KiB per frame", (unsigned long long)mAllocs.allocations, double(mAllocs.bytes) / 1024.0 );
+	mText->text( x, y + kFontSize_, line, kText_, kFontSize_ );
+	y += kLineHeight_;
+
+	if( mResidentBytes > 0 )
+		std::snprintf( line, sizeof(line), "%.1f MiB resident", double(mResidentBytes) / (1024.0 * 1024.0) );
+	else
+		std::snprintf( line, sizeof(line), "memory use unavailable" );
+	mText->text( x, y + kFontSize_, line, kText_, kFontSize_ );
+	y += kLineHeight_;
+
+	if( !mRows.empty() )
+	{
+		y += kMargin_;
+		mText->text( x, y + kFontSize_, "scope", kHeading_, kFontSize_ );
+		mText->text( x + kCpuColumn_, y + kFontSize_, "CPU ms", kHeading_, kFontSize_ );
+		mText->text( x + kGpuColumn_, y + kFontSize_, "GPU ms", kHeading_, kFontSize_ );
+		y += kLineHeight_;
+
+		for( auto const* row : mRows )
+		{
+			std::snprintf( line, sizeof(line), "%*s%s", int(2 * row->depth), "", row->name );
+			mText->text( x, y + kFontSize_, line, kText_, kFontSize_ );
+
+			for( auto const& other : mScopes )
+			{
+				if( !same_name_( other, *row ) )
+					continue;
+
+				std::snprintf( line, sizeof(line), "%6.2f", double(other.avgMs) );
+				mText->text( x + (Profiler::Track::Cpu == other.track ? kCpuColumn_ : kGpuColumn_), y + kFontSize_, line, kText_, kFontSize_ );
+			}
+
+			y += kLineHeight_;
+		}
+	}
+
+	mText->draw( aWidth, aHeight );
+}
+
+void Hud::refresh_( FrameCounters const& aCounters, Profiler const* aProfiler )
+{
+	float sum = 0.f, max = 0.f;
+	for( std::size_t i = 0; i < mFrameCount; ++i )
+	{
+		sum += mFrameMs[i];
+		max = std::max( max, mFrameMs[i] );
+	}
+
+	mAvgFrameMs = mFrameCount > 0 ? sum / float(mFrameCount) : 0.f;
+	mMaxFrameMs = max;
+
+	mDrawCalls = aCounters.drawCalls;
+	mAllocs = aCounters.allocs;
+	mResidentBytes = resident_bytes_();
+
+	if( aProfiler )
+		aProfiler->statistics( mScopes, kStatsSamples );
+	else
+		mScopes.clear();
+
+	// One row per scope name, with the CPU and GPU scopes of that name side
+	// by side
+	mRows.clear();
+	for( auto const& scope : mScopes )
+	{
+		bool const shown = std::any_of( mRows.begin(), mRows.end(), [&scope] (Profiler::ScopeStats const* aRow) {
+			return same_name_( *aRow, scope );
+		} );
+
+		if( !shown )
+			mRows.emplace_back( &scope );
+	}
+}
+
+void Hud::draw_graph_( float aX, float aY, float aWidth, float aHeight )
+{
+	// Oldest frame on the left; one bar per frame
+	float const barWidth = aWidth / float(kFrameHistory);
+
+	for( std::size_t i = 0; i < mFrameCount; ++i )
+	{
+		auto const index = (mFrameIndex + kFrameHistory - mFrameCount + i) % kFrameHistory;
+		float const ms = mFrameMs[index];
+
+		float const height = std::min( ms / kGraphMaxMs_, 1.f ) * aHeight;
+		float const x = aX + float(kFrameHistory - mFrameCount + i) * barWidth;
+
+		std::uint32_t const color = ms <= kGraphLineMs_ * 1.05f ? kFast_ : (ms <= kGraphMaxMs_ ? kSlow_ : kVerySlow_);
+		mText->rect( x, aY + aHeight - height, x + barWidth, aY + aHeight, color );
+	}
+
+	float const lineY = aY + aHeight - kGraphLineMs_ / kGraphMaxMs_ * aHeight;
+	mText->rect( aX, lineY, aX + aWidth, lineY + 1.f, kGraphLine_ );
+}
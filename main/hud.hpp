@@ -0,0 +1,87 @@
+#ifndef HUD_HPP_E4A0C7B3_1F62_4D8E_A95B_70D3E8F21C46
+#define HUD_HPP_E4A0C7B3_1F62_4D8E_A95B_70D3E8F21C46
+
+#include <glad.h>
+
+#include <array>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../support/profiler.hpp"
+#include "../support/alloc_tracker.hpp"
+
+#include "defaults.hpp"
+#include "text_renderer.hpp"
+
+/* On-screen performance display
+ *
+ * Shows the frame rate, a graph of the last kFrameHistory frame times, the
+ * CPU and GPU time of each Profiler scope (averaged over the last
+ * kStatsSamples frames), the draw calls and primitives of the frame, the
+ * heap allocations of the previous frame, and the memory used by the
+ * process. The numbers are refreshed every kRefreshInterval, so that they
+ * can be read; the graph moves every frame.
+ *
+ * Primitives are counted by a GL_PRIMITIVES_GENERATED query between
+ * begin_scene() and end_scene(), whose result is picked up a few frames
+ * later, without waiting for the GPU.
+ */
+class Hud final
+{
+	public:
+		static constexpr std::size_t kFrameHistory = 240;
+		static constexpr std::size_t kStatsSamples = 60;
+		static constexpr auto kRefreshInterval = std::chrono::milliseconds( 250 );
+
+		struct FrameCounters
+		{
+			std::size_t drawCalls;
+			AllocCounters allocs;
+		};
+
+	public:
+		explicit Hud( TextRenderer& );
+		~Hud();
+
+		Hud( Hud const& ) = delete;
+		Hud& operator= (Hud const&) = delete;
+
+	public:
+		void begin_scene();
+		void end_scene();
+
+		// Draws the HUD over the current framebuffer. Without a Profiler,
+		// no per-scope times are shown.
+		void draw( float aFrameSeconds, FrameCounters const&, Profiler const*, float aWidth, float aHeight );
+
+	private:
+		static constexpr std::size_t kQueries_ = 4;
+
+		void refresh_( FrameCounters const&, Profiler const* );
+		void draw_graph_( float aX, float aY, float aWidth, float aHeight );
+
+	private:
+		TextRenderer* mText;
+
+		std::array<GLuint,kQueries_> mPrimitiveQueries;
+		std::array<bool,kQueries_> mQueryPending;
+		std::size_t mQuery;
+		bool mSceneActive;
+
+		std::array<float,kFrameHistory> mFrameMs;
+		std::size_t mFrameIndex;
+		std::size_t mFrameCount;
+
+		Clock::time_point mLastRefresh;
+		float mAvgFrameMs, mMaxFrameMs;
+		std::uint64_t mPrimitives;
+		std::size_t mDrawCalls;
+		AllocCounters mAllocs;
+		std::size_t mResidentBytes;
+		std::vector<Profiler::ScopeStats> mScopes;
+		std::vector<Profiler::ScopeStats const*> mRows; // First scope of each name
+};
+
+#endif // HUD_HPP_E4A0C7B3_1F62_4D8E_A95B_70D3E8F21C46
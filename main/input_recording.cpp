@@ -0,0 +1,253 @@
+#include "input_recording.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+#include <cstring>
+
+#include "../support/error.hpp"
+
+namespace
+{
+	constexpr char kMagic_[4] = { 'I', 'N', 'P', 'R' };
+	constexpr std::uint32_t kFileVersion_ = 1;
+
+	struct FileHeader_
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::int32_t width, height;
+	};
+
+	// Reads a value of type T at aOffset and advances aOffset; returns false
+	// if the data ends first.
+	template< typename T >
+	bool read_( std::vector<std::uint8_t> const& aData, std::size_t& aOffset, T& aValue ) noexcept
+	{
+		if( aData.size() - aOffset < sizeof(T) )
+			return false;
+
+		std::memcpy( &aValue, aData.data() + aOffset, sizeof(T) );
+		aOffset += sizeof(T);
+		return true;
+	}
+}
+
+InputRecorder::InputRecorder( char const* aPath, int aFramebufferWidth, int aFramebufferHeight )
+	: mFile( nullptr )
+	, mPath( aPath )
+	, mFrames( 0 )
+	, mFailed( false )
+{
+	assert( aPath );
+
+	mFile = std::fopen( aPath, "wb" );
+	if( !mFile )
+		throw Error( "InputRecorder: unable to open '%s' for writing", aPath );
+
+	FileHeader_ header{};
+	std::memcpy( header.magic, kMagic_, sizeof(kMagic_) );
+	header.version = kFileVersion_;
+	header.width = aFramebufferWidth;
+	header.height = aFramebufferHeight;
+
+	write_( &header, sizeof(header) );
+}
+
+InputRecorder::~InputRecorder()
+{
+	if( mFile )
+		std::fclose( mFile );
+}
+
+void InputRecorder::key( int aKey, int aAction, int aMods )
+{
+	auto const kind = InputEvent::Kind::Key;
+	auto const key = std::int16_t(aKey);
+	auto const action = std::uint8_t(aAction);
+	auto const mods = std::uint8_t(aMods);
+
+	write_( &kind, sizeof(kind) );
+	write_( &key, sizeof(key) );
+	write_( &action, sizeof(action) );
+	write_( &mods, sizeof(mods) );
+}
+
+void InputRecorder::motion( double aX, double aY )
+{
+	auto const kind = InputEvent::Kind::Motion;
+
+	write_( &kind, sizeof(kind) );
+	write_( &aX, sizeof(aX) );
+	write_( &aY, sizeof(aY) );
+}
+
+void InputRecorder::end_frame( float aDt )
+{
+	auto const kind = InputEvent::Kind::Frame;
+
+	write_( &kind, sizeof(kind) );
+	write_( &aDt, sizeof(aDt) );
+
+	++mFrames;
+}
+
+void InputRecorder::close()
+{
+	if( !mFile )
+		return;
+
+	bool const closed = 0 == std::fclose( mFile );
+	mFile = nullptr;
+
+	if( mFailed || !closed )
+		throw Error( "InputRecorder: unable to write '%s'", mPath );
+}
+
+std::size_t InputRecorder::frames() const noexcept
+{
+	return mFrames;
+}
+
+void InputRecorder::write_( void const* aData, std::size_t aSize )
+{
+	// Errors are reported by close(), so that a full disk does not end the
+	// session that is being recorded.
+	if( mFile && !mFailed )
+		mFailed = 1 != std::fwrite( aData, aSize, 1, mFile );
+}
+
+
+InputReplay::InputReplay( char const* aPath )
+	: mNextEvent( 0 )
+	, mMaxFrameEvents( 0 )
+	, mFrames( 0 )
+	, mFramesReplayed( 0 )
+	, mWidth( 0 )
+	, mHeight( 0 )
+{
+	assert( aPath );
+
+	std::vector<std::uint8_t> data;
+
+	{
+		std::FILE* fin = std::fopen( aPath, "rb" );
+		if( !fin )
+			throw Error( "InputReplay: unable to open '%s'", aPath );
+
+		std::uint8_t buffer[4096];
+		while( auto const count = std::fread( buffer, 1, sizeof(buffer), fin ) )
+			data.insert( data.end(), buffer, buffer + count );
+
+		bool const failed = std::ferror( fin );
+		std::fclose( fin );
+
+		if( failed )
+			throw Error( "InputReplay: unable to read '%s'", aPath );
+	}
+
+	std::size_t offset = 0;
+
+	FileHeader_ header{};
+	if( !read_( data, offset, header ) || 0 != std::memcmp( header.magic, kMagic_, sizeof(kMagic_) ) )
+		throw Error( "InputReplay: '%s' is not an input recording", aPath );
+	if( kFileVersion_ != header.version )
+		throw Error( "InputReplay: '%s' has version %u, expected %u", aPath, unsigned(header.version), unsigned(kFileVersion_) );
+
+	mWidth = header.width;
+	mHeight = header.height;
+
+	// Decode all records up front, so that a damaged file is reported
+	// before the replay starts.
+	std::size_t frameEvents = 0;
+	while( offset < data.size() )
+	{
+		auto const recordOffset = offset;
+
+		InputEvent event{};
+		bool ok = read_( data, offset, event.kind );
+
+		if( ok )
+		{
+			switch( event.kind )
+			{
+				case InputEvent::Kind::Key:
+				{
+					std::int16_t key = 0;
+					std::uint8_t action = 0, mods = 0;
+					ok = read_( data, offset, key ) && read_( data, offset, action ) && read_( data, offset, mods );
+
+					event.key = key;
+					event.action = action;
+					event.mods = mods;
+				} break;
+
+				case InputEvent::Kind::Motion:
+					ok = read_( data, offset, event.x ) && read_( data, offset, event.y );
+					break;
+
+				case InputEvent::Kind::Frame:
+					ok = read_( data, offset, event.dt );
+					mMaxFrameEvents = std::max( mMaxFrameEvents, frameEvents );
+					frameEvents = 0;
+					++mFrames;
+					break;
+
+				default:
+					ok = false;
+			}
+		}
+
+		if( !ok )
+			throw Error( "InputReplay: '%s' is damaged at byte %zu", aPath, recordOffset );
+
+		if( InputEvent::Kind::Frame != event.kind )
+			++frameEvents;
+
+		mEvents.emplace_back( event );
+	}
+}
+
+bool InputReplay::next_frame( Frame& aFrame )
+{
+	aFrame.events.clear();
+	aFrame.events.reserve( mMaxFrameEvents );
+
+	// Events after the last frame record were received while the recording
+	// ended; they are not replayed.
+	for( ; mNextEvent < mEvents.size(); ++mNextEvent )
+	{
+		auto const& event = mEvents[mNextEvent];
+		if( InputEvent::Kind::Frame == event.kind )
+		{
+			aFrame.dt = event.dt;
+
+			++mNextEvent;
+			++mFramesReplayed;
+			return true;
+		}
+
+		aFrame.events.emplace_back( event );
+	}
+
+	aFrame.events.clear();
+	return false;
+}
+
+std::size_t InputReplay::frames() const noexcept
+{
+	return mFrames;
+}
+std::size_t InputReplay::frames_replayed() const noexcept
+{
+	return mFramesReplayed;
+}
+
+int InputReplay::framebuffer_width() const noexcept
+{
+	return mWidth;
+}
+int InputReplay::framebuffer_height() const noexcept
+{
+	return mHeight;
+}
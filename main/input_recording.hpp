@@ -0,0 +1,116 @@
+#ifndef INPUT_RECORDING_HPP_5B07E2C9_D41A_4E86_9F3B_8A6C20D7E514
+#define INPUT_RECORDING_HPP_5B07E2C9_D41A_4E86_9F3B_8A6C20D7E514
+
+#include <vector>
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+/* Recording and replay of an interactive session (--record, --replay)
+ *
+ * InputRecorder logs the key and cursor events that GLFW delivers, and the
+ * time step (dt) of each frame, to a compact binary file. InputReplay reads
+ * such a file back one frame at a time: the events of a frame are handed to
+ * the same handlers as live input, and the frame advances the simulation by
+ * the recorded dt rather than by the wall-clock time. A replay therefore
+ * reproduces the session exactly, however fast (or slowly, e.g., under the
+ * profiler) it runs.
+ *
+ * File layout: a header (magic, version, framebuffer size at the start of
+ * the recording), followed by one record per event. Each record is a one
+ * byte kind and its payload:
+ *
+ *   key:    int16 key, uint8 action, uint8 mods
+ *   motion: float64 x, float64 y (cursor position, unchanged from GLFW)
+ *   frame:  float32 dt; ends the frame, i.e., the events before it were
+ *           received during that frame
+ *
+ * Values are stored in the byte order of the machine that recorded them.
+ */
+struct InputEvent
+{
+	enum class Kind : std::uint8_t
+	{
+		Key = 1,
+		Motion = 2,
+		Frame = 3
+	};
+
+	Kind kind;
+
+	int key, action, mods; // Kind::Key
+	double x, y; // Kind::Motion
+	float dt; // Kind::Frame
+};
+
+class InputRecorder final
+{
+	public:
+		InputRecorder( char const* aPath, int aFramebufferWidth, int aFramebufferHeight );
+		~InputRecorder();
+
+		InputRecorder( InputRecorder const& ) = delete;
+		InputRecorder& operator= (InputRecorder const&) = delete;
+
+	public:
+		void key( int aKey, int aAction, int aMods );
+		void motion( double aX, double aY );
+
+		// Ends the current frame
+		void end_frame( float aDt );
+
+		// Flushes and closes the file; throws if anything could not be
+		// written. Called by the destructor otherwise (without throwing).
+		void close();
+
+		std::size_t frames() const noexcept;
+
+	private:
+		void write_( void const*, std::size_t );
+
+	private:
+		std::FILE* mFile;
+		char const* mPath;
+
+		std::size_t mFrames;
+		bool mFailed;
+};
+
+class InputReplay final
+{
+	public:
+		struct Frame
+		{
+			float dt;
+			std::vector<InputEvent> events; // Key and motion events only
+		};
+
+	public:
+		// Reads and validates the whole file
+		explicit InputReplay( char const* aPath );
+
+	public:
+		// Returns false once all frames have been replayed. Reuses the
+		// storage of aFrame.events, which is sized for the busiest frame on
+		// the first call, so that later calls do not allocate.
+		bool next_frame( Frame& aFrame );
+
+		std::size_t frames() const noexcept;
+		std::size_t frames_replayed() const noexcept;
+
+		int framebuffer_width() const noexcept;
+		int framebuffer_height() const noexcept;
+
+	private:
+		std::vector<InputEvent> mEvents;
+		std::size_t mNextEvent;
+		std::size_t mMaxFrameEvents;
+
+		std::size_t mFrames;
+		std::size_t mFramesReplayed;
+
+		int mWidth, mHeight;
+};
+
+#endif // INPUT_RECORDING_HPP_5B07E2C9_D41A_4E86_9F3B_8A6C20D7E514
@@ -0,0 +1,58 @@
+#include "instancing.hpp"
+
+#include <cassert>
+#include <cstring>
+
+void InstanceList::clear() noexcept
+{
+	mInstances.clear();
+}
+void InstanceList::reserve( std::size_t aCount )
+{
+	mInstances.reserve( aCount );
+}
+
+void InstanceList::add( Mat44f const& aModel, std::uint32_t aFlags )
+{
+	mInstances.emplace_back( InstanceData{ aModel, aFlags, {} } );
+}
+
+std::size_t InstanceList::size() const noexcept
+{
+	return mInstances.size();
+}
+bool InstanceList::empty() const noexcept
+{
+	return mInstances.empty();
+}
+
+RingBuffer::Allocation InstanceList::upload( RingBuffer& aRing ) const
+{
+	auto const bytes = GLsizeiptr(mInstances.size() * sizeof(InstanceData));
+	auto const alloc = aRing.allocate( bytes, aRing.storage_alignment() );
+	std::memcpy( alloc.data, mInstances.data(), std::size_t(bytes) );
+	return alloc;
+}
+
+RenderPacket InstanceList::make_packet( RingBuffer& aRing, GpuMesh const& aMesh, GLuint aProgram, GLuint aTexture ) const
+{
+	assert( !mInstances.empty() );
+
+	auto const alloc = upload( aRing );
+
+	RenderPacket packet{};
+	packet.kind = RenderPacket::Kind::ArraysInstanced;
+	packet.mode = GL_TRIANGLES;
+	packet.program = aProgram;
+	packet.vertexArray = aMesh.vao();
+	packet.texture = aTexture;
+	packet.first = 0;
+	packet.count = aMesh.vertex_count();
+	packet.instanceCount = GLsizei(mInstances.size());
+	packet.dataTarget = GL_SHADER_STORAGE_BUFFER;
+	packet.dataBinding = kInstanceBufferBinding;
+	packet.dataBuffer = aRing.bufferId();
+	packet.dataOffset = alloc.offset;
+	packet.dataSize = alloc.size;
+	return packet;
+}
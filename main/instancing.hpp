@@ -0,0 +1,51 @@
+#ifndef INSTANCING_HPP_3E9B7A14_6D2C_4F85_B1A0_C47E58D2F913
+#define INSTANCING_HPP_3E9B7A14_6D2C_4F85_B1A0_C47E58D2F913
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/mat44.hpp"
+
+#include "../support/ring_buffer.hpp"
+
+#include "gpu_mesh.hpp"
+#include "render_queue.hpp"
+#include "uniform_blocks.hpp"
+
+/* List of instances of a single mesh, drawn with one instanced draw call
+ *
+ * add() the instances to draw, then call make_packet() once per frame. It
+ * writes the instance data (InstanceData, see uniform_blocks.hpp) into the
+ * per-frame ring buffer and returns a RenderPacket that binds it as the
+ * Instances storage block and draws all instances with one
+ * glDrawArraysInstanced(). instanced.vert reads the data with gl_InstanceID.
+ *
+ * upload() only writes the instance data and returns its location in the
+ * ring buffer, for callers that bind and draw it themselves.
+ *
+ * clear() keeps the allocated storage, so a list that is rebuilt every frame
+ * does not allocate in the steady state.
+ */
+class InstanceList final
+{
+	public:
+		void clear() noexcept;
+		void reserve( std::size_t );
+
+		void add( Mat44f const& aModel, std::uint32_t aFlags = 0 );
+
+		std::size_t size() const noexcept;
+		bool empty() const noexcept;
+
+		RingBuffer::Allocation upload( RingBuffer& ) const;
+		RenderPacket make_packet( RingBuffer&, GpuMesh const&, GLuint aProgram, GLuint aTexture ) const;
+
+	private:
+		std::vector<InstanceData> mInstances;
+};
+
+#endif // INSTANCING_HPP_3E9B7A14_6D2C_4F85_B1A0_C47E58D2F913
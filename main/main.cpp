@@ -2,41 +2,227 @@
 #include <GLFW/glfw3.h>
 
 #include <typeinfo>
+#include <algorithm>
 #include <stdexcept>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 #include "../support/error.hpp"
 #include "../support/program.hpp"
+#include "../support/program_cache.hpp"
+#include "../support/profiler.hpp"
+#include "../support/shader_variants.hpp"
+#include "../support/file_watcher.hpp"
 #include "../support/checkpoint.hpp"
+#include "../support/ring_buffer.hpp"
 #include "../support/debug_output.hpp"
+#include "../support/gl_trace.hpp"
+#include "../support/alloc_tracker.hpp"
 
 #include "../vmlib/vec4.hpp"
+#include "../vmlib/aabb.hpp"
 #include "../vmlib/mat44.hpp"
 
 #include "defaults.hpp"
 #include "simple_mesh.hpp"
+#include "gpu_mesh.hpp"
+#include "instancing.hpp"
+#include "render_queue.hpp"
+#include "gpu_frame_stats.hpp"
+#include "gbuffer.hpp"
+#include "hiz.hpp"
+#include "gpu_culler.hpp"
+#include "bvh.hpp"
+#include "clustered_lights.hpp"
+#include "scene_graph.hpp"
+#include "static_batch.hpp"
+#include "terrain_tiles.hpp"
+#include "terrain_streamer.hpp"
+#include "terrain_heightmap.hpp"
+#include "tessellated_terrain.hpp"
+#include "text_renderer.hpp"
+#include "hud.hpp"
+#include "offscreen_target.hpp"
+#include "bench.hpp"
+#include "input_recording.hpp"
 #include "loadobj.hpp"
 #include "stb_image.h"
 #include "cylinder.hpp"
 #include "cone.hpp"
 #include "box.hpp"
+#include "uniform_blocks.hpp"
 
 namespace
 {
 	constexpr char const* kWindowTitle = "COMP3811 - CW2";
 
+	// Linked program binaries (see ProgramBinaryCache)
+	constexpr char const* kProgramCacheDirectory_ = "shader-cache";
+
+	// Shaders are rebuilt in the background when a file in here changes
+	constexpr char const* kShaderDirectory_ = "assets";
+
+	// Font of the performance HUD
+	constexpr char const* kHudFont_ = "assets/DroidSansMonoDotted.ttf";
+
+	// Features of the default.frag variants (see ShaderVariants), in the
+	// order of kShadeFeatureNames_
+	constexpr ShaderVariants::Features kShadeTextured_ = 1u << 0;
+	constexpr ShaderVariants::Features kShadeLit_ = 1u << 1;
+	constexpr ShaderVariants::Features kShadePointLights_ = 1u << 2;
+	constexpr ShaderVariants::Features kShadePerDrawLighting_ = 1u << 3;
+
+	char const* const kShadeFeatureNames_[] = { "SHADE_TEXTURED", "SHADE_LIT", "SHADE_POINT_LIGHTS", "SHADE_PER_DRAW_LIGHTING" };
+
 	constexpr float kPi_ = 3.1415926f;
 
 	constexpr float kMovementPerSecond_ = 5.f; // units per second
 	constexpr float kMouseSensitivity_ = 0.01f; // radians per pixel
 
+	// Space for per-frame and per-object uniform data. Each of the three ring
+	// segments must hold one frame's worth of uniform blocks.
+	constexpr GLsizeiptr kUniformRingBytesPerFrame_ = 1024 * 1024;
+
+	// Terrain is split into kTerrainTiles_ x kTerrainTiles_ tiles. The GPU
+	// pool holds kTerrainSlots_ of them; at most kTerrainUploadsPerFrame_
+	// are streamed in per frame (except in the first frame).
+	constexpr unsigned kTerrainTiles_ = 8;
+	constexpr std::size_t kTerrainSlots_ = 64;
+	constexpr std::size_t kTerrainUploadsPerFrame_ = 4;
+
+	// Tessellated terrain: kTerrainPatches_ x kTerrainPatches_ patches over a
+	// kTerrainHeightmapSize_ x kTerrainHeightmapSize_ heightmap. Patch edges
+	// are split into pieces of about kTessPixelsPerEdge_ pixels.
+	constexpr unsigned kTerrainPatches_ = 32;
+	constexpr unsigned kTerrainHeightmapSize_ = 512;
+	constexpr float kTessPixelsPerEdge_ = 8.f;
+
+	// The terrain receives point lights (runway lights).
+	constexpr std::uint32_t kTerrainFlags_ = kObjectFlagApplyLighting;
+
+	// The static batch mixes objects with and without point lights, so its
+	// variant tests the per-draw flag. The terrain's flags are fixed, so its
+	// variant does not need to.
+	constexpr ShaderVariants::Features kBatchShading_ = kShadeTextured_ | kShadeLit_ | kShadePointLights_ | kShadePerDrawLighting_;
+	constexpr ShaderVariants::Features kTerrainShading_ = kShadeTextured_ | kShadeLit_ | ((kTerrainFlags_ & kObjectFlagApplyLighting) ? kShadePointLights_ : 0u);
+
+	// Runway lights: kPadLightsPerSide_ along each side of a landing pad, and
+	// two rows of lights every kRunwayLightSpacing_ units between the pads
+	constexpr unsigned kPadLightsPerSide_ = 12;
+	constexpr float kRunwayLightSpacing_ = 0.5f;
+	constexpr float kRunwayLightRadius_ = 1.5f;
+
+	// Each runway light sits kRunwayLightHeight_ above the pads, on a small
+	// fixture (kRunwayFixtureSize_ wide, kRunwayFixtureHeight_ high). The
+	// fixtures are instances of one mesh, drawn with a single call.
+	constexpr float kRunwayLightHeight_ = 0.05f;
+	constexpr float kRunwayFixtureSize_ = 0.06f;
+	constexpr float kRunwayFixtureHeight_ = 0.03f;
+
+	// The benchmarks render kBenchmarkFrames_ frames in each of two modes
+	// (after kBenchmarkWarmupFrames_ frames each), and print the frame time
+	// and GPU statistics of both.
+	constexpr std::size_t kBenchmarkFrames_ = 120;
+	constexpr std::size_t kBenchmarkWarmupFrames_ = 10;
+
+	// --bench renders kBenchFrames_ frames (unless given) after the warm-up
+	// frames, offscreen at the size of the window.
+	constexpr std::size_t kBenchFrames_ = 300;
+	constexpr GLsizei kWindowWidth_ = 1280;
+	constexpr GLsizei kWindowHeight_ = 720;
+
+	// With --async-debug, OGL_CHECKPOINT_DEBUG() checks only run every
+	// kAsyncCheckpointInterval_ frames (unless --checkpoint-interval is given)
+	constexpr unsigned kAsyncCheckpointInterval_ = 60;
+
+	// Allocations of the main loop are reported separately for the first
+	// kAllocWarmupFrames_ frames (see FrameAllocations)
+	constexpr std::size_t kAllocWarmupFrames_ = 60;
+
+	// With --trace, the first kTraceEvents_ profiler scopes (about 40 per
+	// frame) are written to the trace file on exit.
+	constexpr std::size_t kTraceEvents_ = 1u << 18;
+
+	struct BenchmarkMode_
+	{
+		char const* label;
+		bool depthPrepass;
+		bool deferred;
+	};
+
+	constexpr BenchmarkMode_ kPrepassBenchmark_[2] = {
+		{ "pre-pass off", false, false },
+		{ "pre-pass on", true, false }
+	};
+	constexpr BenchmarkMode_ kDeferredBenchmark_[2] = {
+		{ "forward", false, false },
+		{ "deferred", false, true }
+	};
+
+	// An instance of a static batch mesh, placed by a scene graph node
+	struct SceneObject_
+	{
+		SceneGraph::NodeId node;
+		StaticBatch::MeshId mesh;
+		std::uint32_t flags;
+		DynamicBvh::ProxyId proxy;
+	};
+
 	struct State_
 	{
 		enum class CameraMode { Default, FixedDistance, GroundFixed };
 		CameraMode currentCameraMode = CameraMode::Default;
-		ShaderProgram* prog;
+		ShaderVariants* shading;
+		ShaderProgram* depthProg;
+
+		// Instanced objects (runway light fixtures), with the same shading
+		ShaderVariants* instancedShading;
+		ShaderProgram* instancedGbufferProg;
+		ShaderProgram* instancedDepthProg;
+
+		// Depth-only pass before the colour pass, so that each pixel is
+		// shaded once (toggled with P)
+		bool depthPrepass;
+
+		// Deferred shading (G-buffer and a full-screen lighting pass) instead
+		// of forward shading (toggled with G)
+		ShaderProgram* gbufferProg;
+		ShaderProgram* deferredProg;
+		bool deferred;
+
+		// Hi-Z occlusion culling against the previous frame's depth buffer
+		// (toggled with O)
+		ShaderProgram* hizProg;
+		bool occlusionCulling;
+
+		// Scene objects are culled by a compute shader instead of the BVH
+		// (toggled with C)
+		ShaderProgram* cullProg;
+		bool gpuCulling;
+
+		// The terrain is tessellated on the GPU from a heightmap instead of
+		// being drawn from the streamed tiles (toggled with T)
+		ShaderVariants* tessShading;
+		ShaderProgram* tessGbufferProg;
+		ShaderProgram* tessDepthProg;
+		bool tessellation;
+
+		// Set by the R key; all programs are rebuilt in the background
+		bool reloadRequested;
+
+		// Performance HUD (toggled with H). Turns on the profiler scopes.
+		bool hud;
+
+		// --record logs the input of the session; during --replay, only
+		// the recorded input is applied (Escape still quits).
+		InputRecorder* recorder;
+		bool replaying;
 
 		struct CamCtrl_
 		{
@@ -58,9 +244,22 @@ namespace
 
 	void glfw_callback_error_(int, char const*);
 
+	void check_uniform_blocks_(ShaderProgram const&);
+
+	void print_benchmark_(char const* aLabel, GpuFrameStats::Totals const&, float aSeconds);
+
+	// View-space depth of the point of aBounds closest to the camera (0 if
+	// the camera is inside, or aBounds is empty). Used for the depth field
+	// of the sort keys.
+	float nearest_view_depth_(Mat44f const& aWorldToCamera, AABB const& aBounds) noexcept;
+
 	void glfw_callback_key_(GLFWwindow*, int, int, int, int);
 	void glfw_callback_motion_(GLFWwindow*, double, double);
 
+	// Live and replayed input (see InputReplay)
+	void handle_key_(GLFWwindow*, int aKey, int aAction);
+	void handle_motion_(GLFWwindow*, double, double);
+
 	struct GLFWCleanupHelper
 	{
 		~GLFWCleanupHelper();
@@ -103,10 +302,94 @@ GLuint loadTexture(const char* aPath) {
 }
 
 
-int main() try
+int main(int aArgc, char* aArgv[]) try
 {
+	BenchmarkMode_ const* benchmark = nullptr;
+	bool profile = false; // Print per-scope timings on exit
+	char const* tracePath = nullptr; // Chrome trace JSON, written on exit
+	bool bench = false; // Scripted headless run (see bench.hpp)
+	std::size_t benchFrames = kBenchFrames_;
+	char const* benchOutput = nullptr; // JSON results; stdout if null
+	char const* recordPath = nullptr; // Input recording, written during the session
+	char const* replayPath = nullptr; // Input recording to replay
+	bool glTrace = false; // Count GL calls and redundant state changes (debug builds)
+	bool asyncDebug = false; // Queued, deduplicated GL debug messages (debug builds)
+	unsigned checkpointInterval = 0; // Frames between OGL_CHECKPOINT_DEBUG() checks; 0 = default
+	bool allocStats = false; // Print heap allocations of the main loop on exit
+	bool assertNoAlloc = false; // Report (and in debug builds, assert on) allocating steady-state frames
+	for (int i = 1; i < aArgc; ++i)
+	{
+		if (0 == std::strcmp(aArgv[i], "--prepass-benchmark"))
+			benchmark = kPrepassBenchmark_;
+		else if (0 == std::strcmp(aArgv[i], "--deferred-benchmark"))
+			benchmark = kDeferredBenchmark_;
+		else if (0 == std::strcmp(aArgv[i], "--profile"))
+			profile = true;
+		else if (0 == std::strcmp(aArgv[i], "--trace") && i + 1 < aArgc)
+			tracePath = aArgv[++i];
+		else if (0 == std::strcmp(aArgv[i], "--bench"))
+			bench = true;
+		else if (0 == std::strcmp(aArgv[i], "--bench-frames") && i + 1 < aArgc)
+		{
+			char* end = nullptr;
+			benchFrames = std::strtoul(aArgv[++i], &end, 10);
+			if (*end || 0 == benchFrames)
+				throw Error("Invalid frame count '%s' for --bench-frames", aArgv[i]);
+		}
+		else if (0 == std::strcmp(aArgv[i], "--bench-output") && i + 1 < aArgc)
+			benchOutput = aArgv[++i];
+		else if (0 == std::strcmp(aArgv[i], "--record") && i + 1 < aArgc)
+			recordPath = aArgv[++i];
+		else if (0 == std::strcmp(aArgv[i], "--replay") && i + 1 < aArgc)
+			replayPath = aArgv[++i];
+		else if (0 == std::strcmp(aArgv[i], "--gl-trace"))
+			glTrace = true;
+		else if (0 == std::strcmp(aArgv[i], "--async-debug"))
+			asyncDebug = true;
+		else if (0 == std::strcmp(aArgv[i], "--alloc-stats"))
+			allocStats = true;
+		else if (0 == std::strcmp(aArgv[i], "--assert-no-alloc"))
+			assertNoAlloc = true;
+		else if (0 == std::strcmp(aArgv[i], "--checkpoint-interval") && i + 1 < aArgc)
+		{
+			char* end = nullptr;
+			auto const interval = std::strtoul(aArgv[++i], &end, 10);
+			if (*end || 0 == interval || interval > 1000000)
+				throw Error("Invalid frame count '%s' for --checkpoint-interval", aArgv[i]);
+			checkpointInterval = unsigned(interval);
+		}
+		else
+			throw Error("Unknown argument '%s'", aArgv[i]);
+	}
+
+	// The scripted modes drive the camera themselves
+	if (replayPath && (recordPath || bench || benchmark))
+		throw Error("--replay cannot be combined with --record, --bench or a benchmark");
+	if (recordPath && (bench || benchmark))
+		throw Error("--record cannot be combined with --bench or a benchmark");
+
+	// Load the recording before opening a window, so that a bad file is
+	// reported right away. The window gets the recorded size.
+	std::unique_ptr<InputReplay> replay;
+	if (replayPath)
+		replay = std::make_unique<InputReplay>(replayPath);
+
 	// Initialize GLFW
-	if (GLFW_TRUE != glfwInit())
+	bool glfwReady = GLFW_TRUE == glfwInit();
+	bool headless = false;
+
+#	if defined(GLFW_PLATFORM_NULL)
+	// Without a display (e.g., on a server that renders with llvmpipe),
+	// --bench falls back to GLFW's null platform, which creates a surfaceless
+	// EGL context.
+	if (!glfwReady && bench)
+	{
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+		glfwReady = headless = GLFW_TRUE == glfwInit();
+	}
+#	endif // ~ GLFW_PLATFORM_NULL
+
+	if (!glfwReady)
 	{
 		char const* msg = nullptr;
 		int ecode = glfwGetError(&msg);
@@ -131,6 +414,13 @@ int main() try
 
 	glfwWindowHint(GLFW_DEPTH_BITS, 24);
 
+	// --bench renders into an OffscreenTarget; the window only provides the
+	// context.
+	if (bench)
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	if (headless)
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+
 #	if !defined(NDEBUG)
 	// When building in debug mode, request an OpenGL debug context. This
 	// enables additional debugging features. However, this can carry extra
@@ -139,8 +429,8 @@ int main() try
 #	endif // ~ !NDEBUG
 
 	GLFWwindow* window = glfwCreateWindow(
-		1280,
-		720,
+		replay ? replay->framebuffer_width() : kWindowWidth_,
+		replay ? replay->framebuffer_height() : kWindowHeight_,
 		kWindowTitle,
 		nullptr, nullptr
 	);
@@ -161,6 +451,30 @@ int main() try
 	state.isAnimating = false;
 	state.animationTime = 0.0f;
 	state.initialPosition = { 0.0f, -0.85f, 16.0f }; // Replace this with your initial position
+	state.occlusionCulling = true;
+	state.gpuCulling = true;
+
+	std::unique_ptr<InputRecorder> recorder;
+	if (recordPath)
+	{
+		int fbwidth, fbheight;
+		glfwGetFramebufferSize(window, &fbwidth, &fbheight);
+
+		recorder = std::make_unique<InputRecorder>(recordPath, fbwidth, fbheight);
+		state.recorder = recorder.get();
+	}
+
+	if (replay)
+	{
+		int fbwidth, fbheight;
+		glfwGetFramebufferSize(window, &fbwidth, &fbheight);
+
+		std::printf("Replaying %zu frames from '%s'\n", replay->frames(), replayPath);
+		if (fbwidth != replay->framebuffer_width() || fbheight != replay->framebuffer_height())
+			std::fprintf(stderr, "Warning: framebuffer is %dx%d, recorded at %dx%d\n", fbwidth, fbheight, replay->framebuffer_width(), replay->framebuffer_height());
+
+		state.replaying = true;
+	}
 
 	glfwSetWindowUserPointer(window, &state);
 
@@ -169,7 +483,7 @@ int main() try
 
 	// Set up drawing stuff
 	glfwMakeContextCurrent(window);
-	glfwSwapInterval(1); // V-Sync is on.
+	glfwSwapInterval(benchmark || bench || replay ? 0 : 1); // V-Sync is on, except when benchmarking or replaying.
 
 	// Initialize GLAD
 	// This will load the OpenGL API. We mustn't make any OpenGL calls before this!
@@ -181,20 +495,32 @@ int main() try
 	std::printf("VERSION %s\n", glGetString(GL_VERSION));
 	std::printf("SHADING_LANGUAGE_VERSION %s\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
+	// All static geometry shares one vertex/index arena and is drawn with a
+	// single multi-draw.
+	StaticBatch staticBatch;
+
+	// The terrain is tiled, so that it can be culled, LOD-selected and
+	// streamed per tile.
 	SimpleMeshData parlahti = load_wavefront_obj("assets/parlahti.obj");
-	std::size_t vertexCountParlahti = parlahti.positions.size();
-	GLuint parlahti_vao = create_vao(parlahti);
+	TerrainTiles const terrainTiles = make_terrain_tiles(parlahti, kTerrainTiles_, kTerrainTiles_);
+
+	// Alternatively, the terrain is resampled into a heightmap, and its
+	// detail is chosen per frame by the tessellator.
+	TerrainHeightmap const terrainHeightmap = make_terrain_heightmap(parlahti, kTerrainHeightmapSize_, kTerrainHeightmapSize_);
 
 	SimpleMeshData landingpad = load_wavefront_obj("assets/landingpad.obj");
-	std::size_t vertexCountLandingpad = landingpad.positions.size();
-	GLuint landingpad_vao = create_vao(landingpad);
+	auto const landingpadMesh = staticBatch.add_mesh(landingpad);
 
 
 	// Ddebug output
 #	if !defined(NDEBUG)
-	setup_gl_debug_output();
+	setup_gl_debug_output(asyncDebug ? DebugOutputMode::Asynchronous : DebugOutputMode::Synchronous);
 #	endif // ~ !NDEBUG
 
+	if (0 == checkpointInterval)
+		checkpointInterval = asyncDebug ? kAsyncCheckpointInterval_ : 1;
+	set_checkpoint_interval(checkpointInterval);
+
 	// Global GL state
 	OGL_CHECKPOINT_ALWAYS();
 
@@ -221,12 +547,151 @@ int main() try
 	// Other initialization & loading
 
 	OGL_CHECKPOINT_ALWAYS();
-	ShaderProgram prog({
-		{ GL_VERTEX_SHADER, "assets/default.vert" },
+
+	// Linked programs are cached on disk, keyed by their sources and the
+	// driver, which skips compilation on later launches.
+	ProgramBinaryCache programCache(kProgramCacheDirectory_);
+	auto const programsStart = Clock::now();
+
+	// All programs are issued before waiting for any of them, so that the
+	// driver can compile them in parallel (if it supports that)
+	if (GLAD_GL_KHR_parallel_shader_compile)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+	else if (GLAD_GL_ARB_parallel_shader_compile)
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+
+	std::vector<std::string> const shadeFeatures(std::begin(kShadeFeatureNames_), std::end(kShadeFeatureNames_));
+
+	// Per-draw transforms and flags are read from a storage buffer, indexed
+	// by the draw ID of the multi-draw (see StaticBatch). The forward pass
+	// uses a specialised variant of default.frag per kind of packet.
+	ShaderVariants shading({
+		{ GL_VERTEX_SHADER, "assets/batched.vert" },
 		{ GL_FRAGMENT_SHADER, "assets/default.frag" }
-		});
+		}, shadeFeatures, &programCache);
+
+	shading.prepare(kBatchShading_);
+	shading.prepare(kTerrainShading_);
 
-	state.prog = &prog;
+	// Same, but transforms and flags are read per instance (see
+	// InstanceList). instanced.vert alone is the depth pre-pass program.
+	ShaderVariants instancedShading({
+		{ GL_VERTEX_SHADER, "assets/instanced.vert" },
+		{ GL_FRAGMENT_SHADER, "assets/default.frag" }
+		}, shadeFeatures, &programCache);
+
+	instancedShading.prepare(kBatchShading_);
+	ShaderProgram instancedGbufferProg({
+		{ GL_VERTEX_SHADER, "assets/instanced.vert" },
+		{ GL_FRAGMENT_SHADER, "assets/gbuffer.frag" }
+		}, &programCache, ShaderProgram::BuildMode::Deferred);
+	ShaderProgram instancedDepthProg({
+		{ GL_VERTEX_SHADER, "assets/instanced.vert" }
+		}, &programCache, ShaderProgram::BuildMode::Deferred);
+
+	// Depth pre-pass: positions only, no fragment shader. Colour writes are
+	// disabled while it runs (DepthMode::Prepass).
+	ShaderProgram depthProg({
+		{ GL_VERTEX_SHADER, "assets/depth.vert" }
+		}, &programCache, ShaderProgram::BuildMode::Deferred);
+
+	// Deferred path: the geometry pass writes the G-buffer, and the lighting
+	// pass shades each pixel once.
+	ShaderProgram gbufferProg({
+		{ GL_VERTEX_SHADER, "assets/batched.vert" },
+		{ GL_FRAGMENT_SHADER, "assets/gbuffer.frag" }
+		}, &programCache, ShaderProgram::BuildMode::Deferred);
+	ShaderProgram deferredProg({
+		{ GL_VERTEX_SHADER, "assets/fullscreen.vert" },
+		{ GL_FRAGMENT_SHADER, "assets/deferred.frag" }
+		}, &programCache, ShaderProgram::BuildMode::Deferred);
+
+	auto const invProjViewUniform = deferredProg.uniform<Mat44f>("invProjView");
+
+	GBuffer gbuffer;
+
+	// Depth pyramid of the last frame, for occlusion culling
+	ShaderProgram hizProg({
+		{ GL_COMPUTE_SHADER, "assets/hiz.comp" }
+		}, &programCache, ShaderProgram::BuildMode::Deferred);
+
+	HiZBuffer hiz(hizProg);
+
+	// GPU-driven culling: the visible objects are compacted into an indirect
+	// draw buffer without a round trip through the CPU.
+	ShaderProgram cullProg({
+		{ GL_COMPUTE_SHADER, "assets/cull.comp" }
+		}, &programCache, ShaderProgram::BuildMode::Deferred);
+
+	GpuCuller gpuCuller(cullProg);
+
+	// Tessellated terrain, with the fragment shaders of the forward and
+	// deferred paths, and depth-only for the pre-pass
+	ShaderVariants tessShading({
+		{ GL_VERTEX_SHADER, "assets/terrain.vert" },
+		{ GL_TESS_CONTROL_SHADER, "assets/terrain.tesc" },
+		{ GL_TESS_EVALUATION_SHADER, "assets/terrain.tese" },
+		{ GL_FRAGMENT_SHADER, "assets/default.frag" }
+		}, shadeFeatures, &programCache);
+
+	tessShading.prepare(kTerrainShading_);
+	ShaderProgram tessGbufferProg({
+		{ GL_VERTEX_SHADER, "assets/terrain.vert" },
+		{ GL_TESS_CONTROL_SHADER, "assets/terrain.tesc" },
+		{ GL_TESS_EVALUATION_SHADER, "assets/terrain.tese" },
+		{ GL_FRAGMENT_SHADER, "assets/gbuffer.frag" }
+		}, &programCache, ShaderProgram::BuildMode::Deferred);
+	ShaderProgram tessDepthProg({
+		{ GL_VERTEX_SHADER, "assets/terrain.vert" },
+		{ GL_TESS_CONTROL_SHADER, "assets/terrain.tesc" },
+		{ GL_TESS_EVALUATION_SHADER, "assets/terrain.tese" }
+		}, &programCache, ShaderProgram::BuildMode::Deferred);
+
+	// Text of the HUD
+	ShaderProgram textProg({
+		{ GL_VERTEX_SHADER, "assets/text.vert" },
+		{ GL_FRAGMENT_SHADER, "assets/text.frag" }
+		}, &programCache, ShaderProgram::BuildMode::Deferred);
+
+	TextRenderer textRenderer(textProg, kHudFont_);
+	Hud hud(textRenderer);
+
+	std::vector<ShaderProgram*> programs = { &depthProg, &instancedGbufferProg, &instancedDepthProg, &gbufferProg, &deferredProg, &hizProg, &cullProg, &tessGbufferProg, &tessDepthProg, &textProg };
+	for (auto* variants : { &shading, &instancedShading, &tessShading })
+	{
+		for (auto* program : variants->programs())
+			programs.emplace_back(program);
+	}
+
+	for (auto* program : programs)
+		program->finish_reload();
+
+	{
+		auto const& cacheStats = programCache.stats();
+		float const ms = std::chrono::duration_cast<Secondsf>(Clock::now() - programsStart).count() * 1e3f;
+		if (programCache.enabled())
+			std::printf("Shader programs: %zu from the binary cache, %zu compiled (%zu binaries rejected), %.1f ms\n", cacheStats.hits, cacheStats.misses + cacheStats.rejected, cacheStats.rejected, double(ms));
+		else
+			std::printf("Shader programs: compiled in %.1f ms (no program binary cache)\n", double(ms));
+	}
+
+	// The full-screen triangle has no vertex attributes, but core profile
+	// requires a VAO.
+	GLuint fullscreenVao = 0;
+	glGenVertexArrays(1, &fullscreenVao);
+
+	state.shading = &shading;
+	state.depthProg = &depthProg;
+	state.instancedShading = &instancedShading;
+	state.instancedGbufferProg = &instancedGbufferProg;
+	state.instancedDepthProg = &instancedDepthProg;
+	state.gbufferProg = &gbufferProg;
+	state.deferredProg = &deferredProg;
+	state.hizProg = &hizProg;
+	state.cullProg = &cullProg;
+	state.tessShading = &tessShading;
+	state.tessGbufferProg = &tessGbufferProg;
+	state.tessDepthProg = &tessDepthProg;
 	state.camControl.radius = 10.f;
 
 	auto last = Clock::now();
@@ -235,8 +700,6 @@ int main() try
 
 	const char* texturePath = "assets/L4343A-4k.jpeg";
 	GLuint texture = loadTexture(texturePath);
-	Vec3f landingPadPosition1{ 0.0f, -0.95f, -16.0f };
-	Vec3f landingPadPosition2{ 0.0f, -0.95f, 16.0f };
 
 	// Create shape
 	auto xcyl = make_cylinder(true, 16, { 1.f, 1.f, 1.f }, make_scaling(0.55f, 0.2f, 0.2f));
@@ -259,37 +722,296 @@ int main() try
 	auto con7 = concatenate(std::move(con6), xcone2);
 	auto xspace = concatenate(std::move(con7), xcone3);
 
-	GLuint vao = create_vao(xspace);
-	std::size_t vertexCount = xspace.positions.size();
+	auto const xspaceMesh = staticBatch.add_mesh(xspace);
+	staticBatch.build();
+
+	std::printf("Static batch: %zu vertices, %zu indices\n", staticBatch.vertex_count(), staticBatch.index_count());
+
+	TerrainStreamer terrainStreamer(terrainTiles, kTerrainSlots_, kTerrainFlags_);
+	TessellatedTerrain tessTerrain(terrainHeightmap, kTerrainPatches_, kTerrainFlags_);
+	bool firstFrame = true;
 	Vec3f cylinderPosition = { 0.0f, -0.85f, 16.0f };
 	Vec3f initialPosition = { 0.0f, -0.85f, 16.0f };
 
-	Vec3f lightPos1 = { 2.0f, 1.0f, 0.0f };
-	Vec3f lightColor1 = { 1.f, 0.0f, 0.0f }; // Red cylinder
+	// Object transforms. World matrices are cached and only recomputed for
+	// nodes that moved (and their descendants).
+	SceneGraph sceneGraph;
+
+	auto const landingPadNode1 = sceneGraph.add_node(SceneGraph::kNoParent, make_translation({ 0.0f, -0.95f, -16.0f }));
+	auto const landingPadNode2 = sceneGraph.add_node(SceneGraph::kNoParent, make_translation({ 0.0f, -0.95f, 16.0f }));
+
+	// The ship moves as a whole; its mesh is modelled along the x axis and is
+	// stood upright by a fixed rotation below the moving node.
+	auto const shipNode = sceneGraph.add_node(SceneGraph::kNoParent, make_translation(cylinderPosition));
+	auto const shipMeshNode = sceneGraph.add_node(shipNode, make_rotation_z(90.0f * (kPi_ / 180.0f)));
+	Vec3f shipNodePosition = cylinderPosition; // Position last given to shipNode
+
+	std::vector<SceneObject_> sceneObjects = {
+		{ shipMeshNode, xspaceMesh, kObjectFlagApplyLighting, DynamicBvh::kNullProxy },
+		{ landingPadNode1, landingpadMesh, 0, DynamicBvh::kNullProxy },
+		{ landingPadNode2, landingpadMesh, kObjectFlagApplyLighting, DynamicBvh::kNullProxy }
+	};
+	constexpr std::size_t shipObject = 0;
+
+	// World-space bounds of all objects, for frustum culling
+	DynamicBvh bvh;
+	sceneGraph.update();
+
+	for (std::size_t i = 0; i < sceneObjects.size(); ++i)
+	{
+		auto& object = sceneObjects[i];
+		object.proxy = bvh.insert(transform(sceneGraph.world(object.node), staticBatch.mesh_bounds(object.mesh)), std::uint32_t(i));
+	}
+
+	std::vector<std::uint32_t> visibleObjects;
+	visibleObjects.reserve(sceneObjects.size());
+
+	// Visible/culled counts currently shown in the window title
+	std::size_t titleVisible = ~std::size_t(0), titleCulled = ~std::size_t(0);
+	std::size_t titleTilesVisible = ~std::size_t(0), titleTilesCulled = ~std::size_t(0);
+	std::size_t titleOccluded = ~std::size_t(0), titleTilesOccluded = ~std::size_t(0);
+	bool titleGpuCulling = false, titleTessellation = false;
+
+	// Point lights are assigned to view-space clusters each frame, so that
+	// fragments only evaluate the lights near them.
+	ClusteredLights clusteredLights;
+	clusteredLights.add({ 2.0f, 1.0f, 0.0f }, 10.f, { 4.f, 0.f, 0.f }); // Red cylinder
+	clusteredLights.add({ 0.0f, 1.5f, 16.0f }, 10.f, { 0.f, 0.f, 4.f }); // Blue cone
+	clusteredLights.add({ 0.0f, 0.0f, 0.0f }, 10.f, { 4.f, 4.f, 0.f }); // Yellow box
+
+	// The fixture mesh's origin is the centre of its base
+	GpuMesh const runwayFixtureMesh(make_box(kRunwayFixtureSize_, kRunwayFixtureHeight_, kRunwayFixtureSize_, { 1.f, 1.f, 1.f }, make_translation({ -0.5f * kRunwayFixtureSize_, 0.f, -0.5f * kRunwayFixtureSize_ })));
+	InstanceList runwayFixtures;
+	AABB runwayFixtureBounds = kEmptyAABB; // World space
+
+	auto const add_runway_light = [&](Vec3f const& aPosition, Vec3f const& aColor)
+	{
+		clusteredLights.add(aPosition, kRunwayLightRadius_, aColor);
+
+		Vec3f const base{ aPosition.x, aPosition.y - kRunwayLightHeight_, aPosition.z };
+		runwayFixtures.add(make_translation(base), kObjectFlagApplyLighting);
+		runwayFixtureBounds = expand(runwayFixtureBounds, base - Vec3f{ 0.5f * kRunwayFixtureSize_, 0.f, 0.5f * kRunwayFixtureSize_ });
+		runwayFixtureBounds = expand(runwayFixtureBounds, base + Vec3f{ 0.5f * kRunwayFixtureSize_, kRunwayFixtureHeight_, 0.5f * kRunwayFixtureSize_ });
+	};
+
+	for (auto const padNode : { landingPadNode1, landingPadNode2 })
+	{
+		AABB const pad = transform(sceneGraph.world(padNode), staticBatch.mesh_bounds(landingpadMesh));
+		float const y = pad.max.y + kRunwayLightHeight_;
+
+		// Walk around the pad's perimeter, one light per side per step
+		for (unsigned i = 0; i < kPadLightsPerSide_; ++i)
+		{
+			float const t = float(i) / kPadLightsPerSide_;
+			float const x = pad.min.x + t * (pad.max.x - pad.min.x);
+			float const z = pad.min.z + t * (pad.max.z - pad.min.z);
+
+			add_runway_light({ x, y, pad.min.z }, { 0.2f, 0.6f, 1.f });
+			add_runway_light({ pad.max.x, y, z }, { 0.2f, 0.6f, 1.f });
+			add_runway_light({ pad.max.x - (x - pad.min.x), y, pad.max.z }, { 0.2f, 0.6f, 1.f });
+			add_runway_light({ pad.min.x, y, pad.max.z - (z - pad.min.z) }, { 0.2f, 0.6f, 1.f });
+		}
+	}
+
+	{
+		AABB const pad1 = transform(sceneGraph.world(landingPadNode1), staticBatch.mesh_bounds(landingpadMesh));
+		AABB const pad2 = transform(sceneGraph.world(landingPadNode2), staticBatch.mesh_bounds(landingpadMesh));
+
+		float const y = pad1.max.y + kRunwayLightHeight_;
+		for (float z = pad1.max.z + kRunwayLightSpacing_; z < pad2.min.z; z += kRunwayLightSpacing_)
+		{
+			Vec3f const color = (int(z / kRunwayLightSpacing_) % 4) ? Vec3f{ 1.f, 0.8f, 0.4f } : Vec3f{ 1.f, 0.1f, 0.1f };
+			add_runway_light({ pad1.min.x, y, z }, color);
+			add_runway_light({ pad1.max.x, y, z }, color);
+		}
+	}
 
-	Vec3f lightPos2 = { 0.0f, 1.5f, 16.0f };
-	Vec3f lightColor2 = { 0.0f, 0.0f, 1.f }; // Blue cone
+	std::printf("Clustered lighting: %zu lights, %ux%ux%u clusters\n", clusteredLights.size(), kClusterGridX, kClusterGridY, kClusterGridZ);
+	std::printf("Runway light fixtures: %zu instances of %d vertices\n", runwayFixtures.size(), int(runwayFixtureMesh.vertex_count()));
 
-	Vec3f lightPos3 = { 0.0f, 0.0f, 0.0f };
-	Vec3f lightColor3 = { 1.0f, 1.0f, 0.f }; // Yellow box
+	// Per-frame and per-object uniform blocks are written into a persistently
+	// mapped ring buffer and selected with glBindBufferRange().
+	RingBuffer uniformRing(kUniformRingBytesPerFrame_);
+	for (auto* program : programs)
+		check_uniform_blocks_(*program);
+
+	FileWatcher shaderWatcher(kShaderDirectory_);
+	bool shadersReloaded = false;
+
+	// All draws go through the render queue, which sorts them by state and
+	// skips redundant binds.
+	RenderQueue renderQueue;
+	RenderStateCache stateCache;
+
+	constexpr float kNearPlane = 0.1f;
+	constexpr float kFarPlane = 100.f;
+
+	// Benchmark phase = index of the current mode in benchmark[]
+	GpuFrameStats frameStats(kBenchmarkFrames_);
+	std::size_t benchmarkPhase = 0, benchmarkFrame = 0;
+	GpuFrameStats::Totals benchmarkTotals[2]{};
+	std::size_t benchmarkOccluded = 0, benchmarkTilesOccluded = 0;
+	auto benchmarkStart = Clock::now();
+
+	// Frames of the --bench run, including the warm-up frames
+	OffscreenTarget offscreen;
+	if (bench)
+	{
+		offscreen.resize(kWindowWidth_, kWindowHeight_);
+		state.isAnimating = true;
+		std::printf("Benchmark: %zu frames (after %zu warm-up frames) at %dx%d\n", benchFrames, kBenchmarkWarmupFrames_, int(kWindowWidth_), int(kWindowHeight_));
+	}
+
+	// Everything is drawn into here instead of the default framebuffer
+	GLuint const targetFramebuffer = offscreen.framebuffer();
+
+	std::size_t benchFrame = 0;
+	BenchResults benchResults{};
+	benchResults.renderer = reinterpret_cast<char const*>(glGetString(GL_RENDERER));
+	benchResults.width = kWindowWidth_;
+	benchResults.height = kWindowHeight_;
+	benchResults.warmupFrames = kBenchmarkWarmupFrames_;
+	std::vector<std::uint8_t> benchPixels;
+
+	// Storage for the measured frames is allocated up front, so that it is
+	// not reallocated while they are being timed.
+	if (bench)
+	{
+		benchResults.frameMs.reserve(benchFrames + 1);
+		benchPixels.reserve(std::size_t(kWindowWidth_) * std::size_t(kWindowHeight_) * 4);
+	}
+
+	if (benchmark)
+		std::printf("Benchmark (%s vs %s): %zu frames per mode\n", benchmark[0].label, benchmark[1].label, kBenchmarkFrames_);
+
+	// CPU and GPU time per section of the frame, and per draw. Unless
+	// --profile, --trace, --bench or the HUD is on, the scopes below do
+	// nothing.
+	bool const profiling = profile || tracePath;
+	Profiler frameProfiler(tracePath ? kTraceEvents_ : 0);
 
 	// TODO: global GL setup goes here
 
 	OGL_CHECKPOINT_ALWAYS();
 
+	// GL calls are traced from the first frame on (see install_gl_trace())
+	if (glTrace && !kGlTraceAvailable)
+		std::fprintf(stderr, "Warning: --gl-trace is only available in debug builds\n");
+	if (glTrace)
+		install_gl_trace();
+
+	// Heap allocations of each frame. After the warm-up, frames are not
+	// expected to allocate; with --assert-no-alloc, the first frame that
+	// does is reported. Switching modes (e.g., the first frame of the
+	// deferred path) and shader reloads may allocate, so this is meant for
+	// --bench, and for --replay of recordings that only move the camera.
+	FrameAllocations frameAllocs(kAllocWarmupFrames_);
+	bool allocReported = false;
+
+	// Recorded input of the current frame; reused between frames
+	InputReplay::Frame replayFrame{};
+
 	// Main loop
 	while (!glfwWindowShouldClose(window))
 	{
+		// The replay ends after its last recorded frame, before anything of
+		// the next frame has started.
+		if (replay && !replay->next_frame(replayFrame))
+			break;
+
+		frameAllocs.begin_frame();
+
+		bool const benchMeasure = bench && benchFrame >= kBenchmarkWarmupFrames_;
+
+		Profiler* const profiler = (profiling || benchMeasure || state.hud) ? &frameProfiler : nullptr;
+		if (profiler)
+			profiler->begin_frame();
+
+		ProfileScope frameScope(profiler, "frame");
+		GpuProfileScope gpuFrameScope(profiler, "frame");
+
+		ProfileScope eventsScope(profiler, "events");
+
+		glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		// Let GLFW process events
 		glfwPollEvents();
 
+		// The recorded input of this frame stands in for the live input
+		if (replay)
+		{
+			for (auto const& event : replayFrame.events)
+			{
+				if (InputEvent::Kind::Key == event.kind)
+					handle_key_(window, event.key, event.action);
+				else
+					handle_motion_(window, event.x, event.y);
+			}
+		}
+
+		// Rebuild programs in the background, either on request or when one
+		// of their files has changed. The old programs are used until the
+		// new ones have linked.
+		if (state.reloadRequested)
+		{
+			state.reloadRequested = false;
+			for (auto* program : programs)
+				program->reload_async();
+		}
+
+		for (auto const& name : shaderWatcher.poll())
+		{
+			auto const path = shaderWatcher.directory() + "/" + name;
+			for (auto* program : programs)
+			{
+				if (program->depends_on(path))
+					program->reload_async();
+			}
+		}
+
+		{
+			bool reloadPending = false;
+			for (auto* program : programs)
+			{
+				switch (program->poll_reload())
+				{
+					case ShaderProgram::ReloadStatus::Idle:
+						break;
+					case ShaderProgram::ReloadStatus::Pending:
+						reloadPending = true;
+						break;
+					case ShaderProgram::ReloadStatus::Done:
+						shadersReloaded = true;
+						break;
+					case ShaderProgram::ReloadStatus::Failed:
+						std::fprintf(stderr, "Error when reloading shader:\n");
+						std::fprintf(stderr, "%s\n", program->reload_error().c_str());
+						std::fprintf(stderr, "Keeping old shader.\n");
+						break;
+				}
+			}
+
+			if (shadersReloaded && !reloadPending)
+			{
+				for (auto* program : programs)
+					check_uniform_blocks_(*program);
+				std::fprintf(stderr, "Shaders reloaded and recompiled.\n");
+				shadersReloaded = false;
+			}
+		}
+
 		// Check if window was resized.
 		float fbwidth, fbheight;
 		{
 			int nwidth, nheight;
 			glfwGetFramebufferSize(window, &nwidth, &nheight);
 
+			if (bench)
+			{
+				nwidth = offscreen.width();
+				nheight = offscreen.height();
+			}
+
 			fbwidth = float(nwidth);
 			fbheight = float(nheight);
 
@@ -308,11 +1030,33 @@ int main() try
 
 		}
 
+		eventsScope.end();
+
 		// Update state
+		ProfileScope updateScope(profiler, "update");
+
 		auto const now = Clock::now();
 		float dt = std::chrono::duration_cast<Secondsf>(now - last).count();
 		last = now;
 
+		// dt is the wall-clock time of the previous frame (the last measured
+		// frame is timed where it ends, below). Afterwards, the simulation
+		// runs on a fixed time step, so that every run renders the same
+		// frames.
+		if (bench)
+		{
+			if (benchFrame > kBenchmarkWarmupFrames_)
+				benchResults.frameMs.emplace_back(dt * 1e3f);
+
+			dt = kBenchFrameSeconds;
+		}
+
+		// Replays advance by the recorded time steps
+		if (replay)
+			dt = replayFrame.dt;
+		if (recorder)
+			recorder->end_frame(dt);
+
 		angle += dt * kPi_ * 0.3f;
 		if (angle >= 2.f * kPi_)
 			angle -= 2.f * kPi_;
@@ -353,8 +1097,19 @@ int main() try
 			cylinderPosition.y = initialPosition.y;
 			cylinderPosition.z = initialPosition.z;
 		}
+
+		if (bench)
+		{
+			auto const camera = bench_camera(benchFrame, kBenchmarkWarmupFrames_ + benchFrames);
+			state.camControl.phi = camera.phi;
+			state.camControl.theta = camera.theta;
+			state.camControl.radius = camera.radius;
+		}
+		updateScope.end();
+
 		// Update: compute matrices
 		//TODO: define and compute projCameraWorld matrix
+		ProfileScope matricesScope(profiler, "matrices");
 
 		Mat44f Rx = make_rotation_x(state.camControl.theta);
 		Mat44f Ry = make_rotation_y(state.camControl.phi);
@@ -365,95 +1120,456 @@ int main() try
 		Mat44f projection = make_perspective_projection(
 			60.0f * (kPi_ / 180.0f), // converting FOV from degrees to radians
 			fbwidth / float(fbheight),
-			0.1f,
-			100.0f
+			kNearPlane,
+			kFarPlane
 		);
 
-		Mat44f projCameraWorld = projection * worldToCamera;
-		Mat44f landingPadTransform1 = make_translation(landingPadPosition1);
-		Mat44f projCameraWorld1 = projection * worldToCamera * landingPadTransform1;
-		Mat44f landingPadTransform2 = make_translation(landingPadPosition2);
-		Mat44f projCameraWorld2 = projection * worldToCamera * landingPadTransform2;
+		// Only the ship moves, and only while it is flying; everything else
+		// keeps its cached world matrix.
+		if (cylinderPosition.x != shipNodePosition.x || cylinderPosition.y != shipNodePosition.y || cylinderPosition.z != shipNodePosition.z)
+		{
+			sceneGraph.set_local(shipNode, make_translation(cylinderPosition));
+			shipNodePosition = cylinderPosition;
+
+			sceneGraph.update();
+
+			auto const& ship = sceneObjects[shipObject];
+			bvh.update(ship.proxy, transform(sceneGraph.world(ship.node), staticBatch.mesh_bounds(ship.mesh)));
+		}
+
+		matricesScope.end();
+
+		// Only objects and terrain tiles that intersect the view frustum are
+		// drawn.
+		ProfileScope cullScope(profiler, "culling");
+
+		Frustum const frustum = make_frustum(projection * worldToCamera);
+
+		// Occlusion culling on the CPU uses the depth pyramid of an earlier
+		// frame, once its readback has arrived.
+		if (state.occlusionCulling)
+			hiz.update();
+		else
+			hiz.invalidate();
+
+		HiZBuffer const* const occlusion = hiz.valid() ? &hiz : nullptr;
+
+		DynamicBvh::CullStats cullStats{};
+		std::size_t occludedObjects = 0;
+
+		staticBatch.clear_draws();
+		gpuCuller.clear();
+
+		AABB drawnObjectBounds = kEmptyAABB; // World space
+
+		if (state.gpuCulling)
+		{
+			// All objects are queued; cull.comp decides which ones are drawn
+			// once the Frame block has been uploaded (see below).
+			for (auto const& object : sceneObjects)
+			{
+				auto const& world = sceneGraph.world(object.node);
+				staticBatch.add_culled_draw(gpuCuller, object.mesh, world, object.flags);
+				drawnObjectBounds = merge(drawnObjectBounds, transform(world, staticBatch.mesh_bounds(object.mesh)));
+			}
+		}
+		else
+		{
+			visibleObjects.clear();
+			cullStats = bvh.cull(frustum, visibleObjects);
+
+			for (auto const index : visibleObjects)
+			{
+				auto const& object = sceneObjects[index];
+				auto const& world = sceneGraph.world(object.node);
+
+				AABB const bounds = transform(world, staticBatch.mesh_bounds(object.mesh));
+				if (occlusion && occlusion->occluded(bounds))
+				{
+					++occludedObjects;
+					continue;
+				}
+
+				staticBatch.add_draw(object.mesh, world, object.flags);
+				drawnObjectBounds = merge(drawnObjectBounds, bounds);
+			}
+		}
+
+		Mat44f const cameraToWorld = invert(worldToCamera);
+		Vec3f const cameraPosition{ cameraToWorld(0, 3), cameraToWorld(1, 3), cameraToWorld(2, 3) };
+
+		// The tessellated terrain is culled per patch by terrain.tesc.
+		TerrainStreamer::Stats tileStats{};
+		if (!state.tessellation)
+		{
+			terrainStreamer.stream(cameraPosition, kFarPlane, firstFrame ? kTerrainSlots_ : kTerrainUploadsPerFrame_);
+			tileStats = terrainStreamer.cull(frustum, cameraPosition, occlusion);
+			firstFrame = false;
+		}
+
+		clusteredLights.set_projection(projection, kNearPlane, kFarPlane, fbwidth, fbheight);
+		clusteredLights.assign(worldToCamera);
+
+		cullScope.end();
+
+		// Objects culled by the frustum or by occlusion. With GPU culling,
+		// the CPU does not know which objects are drawn.
+		std::size_t const visibleCount = cullStats.visible - occludedObjects;
+
+		if (state.gpuCulling != titleGpuCulling || state.tessellation != titleTessellation || visibleCount != titleVisible || cullStats.culled != titleCulled || occludedObjects != titleOccluded || tileStats.visible != titleTilesVisible || tileStats.culled != titleTilesCulled || tileStats.occluded != titleTilesOccluded)
+		{
+			char objects[96], terrain[96];
+			if (state.gpuCulling)
+				std::snprintf(objects, sizeof(objects), "%zu objects, culled on the GPU", sceneObjects.size());
+			else
+				std::snprintf(objects, sizeof(objects), "%zu visible, %zu culled, %zu occluded", visibleCount, cullStats.culled, occludedObjects);
+
+			if (state.tessellation)
+				std::snprintf(terrain, sizeof(terrain), "terrain: %zu patches, tessellated", tessTerrain.patch_count());
+			else
+				std::snprintf(terrain, sizeof(terrain), "tiles: %zu visible, %zu culled, %zu occluded", tileStats.visible, tileStats.culled, tileStats.occluded);
+
+			char title[224];
+			std::snprintf(title, sizeof(title), "%s - %s; %s", kWindowTitle, objects, terrain);
+			glfwSetWindowTitle(window, title);
+
+			titleGpuCulling = state.gpuCulling;
+			titleTessellation = state.tessellation;
+
+			titleVisible = visibleCount;
+			titleCulled = cullStats.culled;
+			titleOccluded = occludedObjects;
+			titleTilesVisible = tileStats.visible;
+			titleTilesCulled = tileStats.culled;
+			titleTilesOccluded = tileStats.occluded;
+		}
+
+		ProfileScope uploadScope(profiler, "upload");
+
+		uniformRing.begin_frame();
+
+		{
+			FrameUniforms frame{};
+			frame.view = worldToCamera;
+			frame.projection = projection;
+			frame.projView = projection * worldToCamera;
+
+			Vec3f dirLightDirection = normalize(Vec3f{ 0.0f, -1.0f, -1.0f });
+			frame.dirLightDirection = Vec4f{ dirLightDirection.x, dirLightDirection.y, dirLightDirection.z, 0.f };
+			frame.dirLightColor = Vec4f{ 1.0f, 1.0f, 1.0f, 0.f };
+			frame.ambientColor = Vec4f{ 0.f, 0.f, 0.f, 0.f };
+
+			GLintptr frameOffset = 0;
+			*uniformRing.allocate_as<FrameUniforms>(uniformRing.uniform_alignment(), frameOffset) = frame;
+			glBindBufferRange(GL_UNIFORM_BUFFER, kFrameBlockBinding, uniformRing.bufferId(), frameOffset, sizeof(FrameUniforms));
+		}
+
+		clusteredLights.upload(uniformRing);
+
+		// The frustum test reads Frame::projView. The occlusion test uses the
+		// latest pyramid directly, without waiting for its readback.
+		uploadScope.end();
+
+		if (state.gpuCulling)
+		{
+			ProfileScope gpuCullScope(profiler, "gpu culling");
+			GpuProfileScope gpuCullGpuScope(profiler, "gpu culling");
+			gpuCuller.cull(uniformRing, state.occlusionCulling ? &hiz : nullptr);
+		}
+
+		if (benchmark)
+		{
+			state.depthPrepass = benchmark[benchmarkPhase].depthPrepass;
+			state.deferred = benchmark[benchmarkPhase].deferred;
+		}
+
+		ProfileScope submitScope(profiler, "submit");
+
+		renderQueue.clear();
+
+		// The deferred path draws the same packets with the G-buffer program.
+		GLuint const progId = state.deferred ? state.gbufferProg->programId() : state.shading->get(kBatchShading_).programId();
+		GLuint const terrainProgId = state.deferred ? state.gbufferProg->programId() : state.shading->get(kTerrainShading_).programId();
+		GLuint const depthProgId = state.depthProg->programId();
+
+		// With the pre-pass, the colour pass only shades fragments whose depth
+		// equals the closest depth (i.e., no overdraw). The pre-pass reuses the
+		// colour packets' draw commands and per-draw data. Each packet draws
+		// many objects (or tiles); it is sorted by its nearest point.
+		auto const submit = [&](RenderPacket aPacket, AABB const& aBounds, GLuint aDepthProgram, GLuint aDepthVao, char const* aLabel, char const* aDepthLabel)
+		{
+			aPacket.label = aLabel;
+
+			float const viewDepth = nearest_view_depth_(worldToCamera, aBounds);
+
+			if (state.depthPrepass)
+			{
+				RenderPacket depthPacket = make_depth_prepass_packet(aPacket, aDepthProgram, aDepthVao);
+				depthPacket.label = aDepthLabel;
+
+				renderQueue.submit(
+					make_sort_key(RenderLayer::DepthPrepass, aDepthProgram, 0, aDepthVao, viewDepth, kFarPlane),
+					depthPacket
+				);
+
+				aPacket.depthMode = DepthMode::Equal;
+			}
+
+			renderQueue.submit(
+				make_sort_key(RenderLayer::Opaque, aPacket.program, aPacket.texture, aPacket.vertexArray, viewDepth, kFarPlane),
+				aPacket
+			);
+		};
+
+		if (gpuCuller.size() > 0)
+			submit(staticBatch.make_packet(gpuCuller, progId, texture), drawnObjectBounds, depthProgId, staticBatch.depth_vao(), "draw objects", "draw objects (depth)");
+		else if (staticBatch.draw_count() > 0)
+			submit(staticBatch.make_packet(uniformRing, progId, texture), drawnObjectBounds, depthProgId, staticBatch.depth_vao(), "draw objects", "draw objects (depth)");
 
-		Mat44f cylinderRotation = make_rotation_z(90.0f * (kPi_ / 180.0f));
-		Mat44f cylinderTransform = make_translation(cylinderPosition) * cylinderRotation;
-		Mat44f projCameraWorldCylinder = projection * worldToCamera * cylinderTransform;
+		// All runway light fixtures with one instanced draw
+		if (FrustumTest::outside != test(frustum, runwayFixtureBounds))
+		{
+			GLuint const fixtureProgId = state.deferred ? state.instancedGbufferProg->programId() : state.instancedShading->get(kBatchShading_).programId();
+			submit(runwayFixtures.make_packet(uniformRing, runwayFixtureMesh, fixtureProgId, texture), runwayFixtureBounds, state.instancedDepthProg->programId(), runwayFixtureMesh.vao(), "draw fixtures", "draw fixtures (depth)");
+		}
 
-		glUseProgram(state.prog->programId());
+		if (state.tessellation)
+		{
+			GLuint const tessProgId = state.deferred ? state.tessGbufferProg->programId() : state.tessShading->get(kTerrainShading_).programId();
+			submit(tessTerrain.make_packet(uniformRing, tessProgId, texture, fbwidth, fbheight, kTessPixelsPerEdge_), terrainHeightmap.bounds, state.tessDepthProg->programId(), tessTerrain.vao(), "draw terrain", "draw terrain (depth)");
+		}
+		else if (terrainStreamer.draw_count() > 0)
+			submit(terrainStreamer.make_packet(uniformRing, terrainProgId, texture), terrainHeightmap.bounds, depthProgId, terrainStreamer.depth_vao(), "draw terrain", "draw terrain (depth)");
 
-		Vec3f dirLightDirection = normalize(Vec3f{ 0.0f, -1.0f, -1.0f });
-		Vec3f dirLightColor = Vec3f{ 1.0f, 1.0f, 1.0f };
+		// Shader reloads and other code may have changed the bindings since
+		// the last frame.
+		stateCache.invalidate();
 
-		GLint dirLightDirectionLoc = glGetUniformLocation(prog.programId(), "dirLightDirection");
-		GLint dirLightColorLoc = glGetUniformLocation(prog.programId(), "dirLightColor");
-		glUniform3fv(dirLightDirectionLoc, 1, &dirLightDirection.x);
-		glUniform3fv(dirLightColorLoc, 1, &dirLightColor.x);
+		renderQueue.sort();
 
-		GLint lightPosLoc1 = glGetUniformLocation(state.prog->programId(), "lightPos1");
-		GLint lightColorLoc1 = glGetUniformLocation(state.prog->programId(), "lightColor1");
-		GLint lightPosLoc2 = glGetUniformLocation(state.prog->programId(), "lightPos2");
-		GLint lightColorLoc2 = glGetUniformLocation(state.prog->programId(), "lightColor2");
-		GLint lightPosLoc3 = glGetUniformLocation(state.prog->programId(), "lightPos3");
-		GLint lightColorLoc3 = glGetUniformLocation(state.prog->programId(), "lightColor3");
+		submitScope.end();
 
+		bool const measure = benchmark && benchmarkFrame >= kBenchmarkWarmupFrames_;
+		if (benchmark && benchmarkFrame == kBenchmarkWarmupFrames_)
+			benchmarkStart = Clock::now();
 
-		glUniform3fv(lightPosLoc1, 1, &lightPos1.x);
-		glUniform3fv(lightColorLoc1, 1, &lightColor1.x);
+		if (measure)
+		{
+			frameStats.begin_frame();
+			benchmarkOccluded += occludedObjects;
+			benchmarkTilesOccluded += tileStats.occluded;
+		}
 
-		glUniform3fv(lightPosLoc2, 1, &lightPos2.x);
-		glUniform3fv(lightColorLoc2, 1, &lightColor2.x);
+		if (state.deferred)
+		{
+			gbuffer.resize(GLsizei(fbwidth), GLsizei(fbheight));
+			glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.framebuffer());
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
 
-		glUniform3fv(lightPosLoc3, 1, &lightPos3.x);
-		glUniform3fv(lightColorLoc3, 1, &lightColor3.x);
+		if (state.hud)
+			hud.begin_scene();
 
-		GLint projCameraLoc = glGetUniformLocation(state.prog->programId(), "projCameraWorld");
-		glUniformMatrix4fv(projCameraLoc, 1, GL_TRUE, &projCameraWorld.v[0]);
-		glBindVertexArray(parlahti_vao);
-		glDrawArrays(GL_TRIANGLES, 0, vertexCountParlahti);
-		glBindVertexArray(0);
+		renderQueue.execute(stateCache, profiler);
 
-		glUniformMatrix4fv(projCameraLoc, 1, GL_TRUE, &projCameraWorld1.v[0]);
-		glBindVertexArray(landingpad_vao);
-		glDrawArrays(GL_TRIANGLES, 0, vertexCountLandingpad);
-		glBindVertexArray(0);
+		// Leave the default depth state for code outside of the render queue
+		stateCache.set_depth_mode(DepthMode::Default);
 
-		GLint applyLightingLoc = glGetUniformLocation(state.prog->programId(), "applyLighting");
-		glUniform1i(applyLightingLoc, 1);
-		glUniformMatrix4fv(projCameraLoc, 1, GL_TRUE, &projCameraWorld2.v[0]);
-		glBindVertexArray(landingpad_vao);
-		glDrawArrays(GL_TRIANGLES, 0, vertexCountLandingpad);
-		glBindVertexArray(0);
+		if (state.deferred)
+		{
+			ProfileScope lightingScope(profiler, "deferred lighting");
+			GpuProfileScope lightingGpuScope(profiler, "deferred lighting");
 
-		
+			glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
 
-		GLint projCameraLocCylinder = glGetUniformLocation(state.prog->programId(), "projCameraWorld");
-		glUniformMatrix4fv(projCameraLocCylinder, 1, GL_TRUE, &projCameraWorldCylinder.v[0]);
-		glBindVertexArray(vao);
-		glDrawArrays(GL_TRIANGLES, 0, vertexCount);
-		glBindVertexArray(0);
+			// Lighting pass: once per pixel, no depth testing
+			state.deferredProg->set(invProjViewUniform, invert(projection * worldToCamera));
 
-		glUniform1i(applyLightingLoc, 0);
+			stateCache.use_program(state.deferredProg->programId());
+			stateCache.bind_texture_2d(kGBufferAlbedoUnit, gbuffer.albedo());
+			stateCache.bind_texture_2d(kGBufferNormalUnit, gbuffer.normal());
+			stateCache.bind_texture_2d(kGBufferDepthUnit, gbuffer.depth());
+			stateCache.bind_vertex_array(fullscreenVao);
+
+			glDisable(GL_DEPTH_TEST);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			glEnable(GL_DEPTH_TEST);
+		}
+
+		if (state.hud)
+			hud.end_scene();
+
+		// Build the depth pyramid for the next frames. The default
+		// framebuffer's depth cannot be sampled, so it is copied first.
+		if (state.occlusionCulling)
+		{
+			ProfileScope hizScope(profiler, "hi-z build");
+			GpuProfileScope hizGpuScope(profiler, "hi-z build");
+
+			GLuint const depthTexture = state.deferred
+				? gbuffer.depth()
+				: hiz.copy_framebuffer_depth(GLsizei(fbwidth), GLsizei(fbheight));
+
+			hiz.build(depthTexture, GLsizei(fbwidth), GLsizei(fbheight), projection * worldToCamera);
+		}
+
+		if (measure)
+			frameStats.end_frame();
+
+		uniformRing.end_frame();
 
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-		OGL_CHECKPOINT_DEBUG();
+		// Drawn last, so that it is not part of the depth pyramid
+		if (state.hud)
+		{
+			ProfileScope hudScope(profiler, "hud");
+			GpuProfileScope hudGpuScope(profiler, "hud");
+			hud.draw(dt, Hud::FrameCounters{ renderQueue.size(), frameAllocs.last_frame() }, profiler, fbwidth, fbheight);
+		}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture);
+		if (benchmark && ++benchmarkFrame == kBenchmarkWarmupFrames_ + kBenchmarkFrames_)
+		{
+			// Wall-clock time includes waiting for the GPU (V-Sync is off, and
+			// the ring buffer limits how far the CPU can run ahead).
+			glFinish();
+			float const seconds = std::chrono::duration_cast<Secondsf>(Clock::now() - benchmarkStart).count();
+
+			benchmarkTotals[benchmarkPhase] = frameStats.totals();
+			print_benchmark_(benchmark[benchmarkPhase].label, benchmarkTotals[benchmarkPhase], seconds);
+			if (state.gpuCulling)
+				std::printf("    occlusion culling: %.1f terrain tiles removed per frame (objects are culled on the GPU)\n", double(benchmarkTilesOccluded) / double(kBenchmarkFrames_));
+			else
+				std::printf("    occlusion culling: %.1f objects, %.1f terrain tiles removed per frame\n", double(benchmarkOccluded) / double(kBenchmarkFrames_), double(benchmarkTilesOccluded) / double(kBenchmarkFrames_));
+
+			frameStats.reset();
+			benchmarkOccluded = benchmarkTilesOccluded = 0;
+			benchmarkFrame = 0;
+
+			if (++benchmarkPhase == 2)
+			{
+				auto const& base = benchmarkTotals[0];
+				auto const& other = benchmarkTotals[1];
+				if (base.gpuTimeNs > 0)
+					std::printf("  %s GPU time: %.1f%% of %s\n", benchmark[1].label, 100.0 * double(other.gpuTimeNs) / double(base.gpuTimeNs), benchmark[0].label);
+				if (base.hasFragmentInvocations && other.hasFragmentInvocations && base.fragmentInvocations > 0)
+					std::printf("  %s fragment shader invocations: %.1f%% of %s\n", benchmark[1].label, 100.0 * double(other.fragmentInvocations) / double(base.fragmentInvocations), benchmark[0].label);
+
+				glfwSetWindowShouldClose(window, GLFW_TRUE);
+			}
+		}
+
+		if (bench && ++benchFrame == kBenchmarkWarmupFrames_ + benchFrames)
+		{
+			benchResults.frameMs.emplace_back(std::chrono::duration_cast<Secondsf>(Clock::now() - last).count() * 1e3f);
+
+			offscreen.read_pixels(benchPixels);
+			benchResults.checksum = image_checksum(benchPixels);
+			glfwSetWindowShouldClose(window, GLFW_TRUE);
+		}
 
 		OGL_CHECKPOINT_DEBUG();
 
-		// Display results
-		glfwSwapBuffers(window);
+		gpuFrameScope.end();
+
+		// Display results. The hidden window of --bench shows nothing.
+		ProfileScope swapScope(profiler, "swap");
+		if (bench)
+			glFlush();
+		else
+			glfwSwapBuffers(window);
+
+		if (glTrace)
+			end_gl_trace_frame();
+
+		end_checkpoint_frame();
+
+		bool const steadyState = frameAllocs.steady_state();
+		auto const allocs = frameAllocs.end_frame();
+		if (assertNoAlloc && steadyState && allocs.allocations > 0 && !allocReported)
+		{
+			std::fprintf(stderr, "Warning: steady-state frame allocated %llu times (%llu bytes); run with --profile for the allocations per scope\n", static_cast<unsigned long long>(allocs.allocations), static_cast<unsigned long long>(allocs.bytes));
+			allocReported = true;
+			assert(!"steady-state frame allocated");
+		}
+	}
+
+	if (allocStats)
+	{
+		frameAllocs.print(stdout, "Main loop");
+		print_alloc_statistics(stdout);
+	}
+
+	if (glTrace)
+		print_gl_trace(stdout);
+
+	if (profiling || bench)
+	{
+		// Pick up the scopes of the last frames
+		glFinish();
+		frameProfiler.begin_frame();
+
+		if (profile)
+			frameProfiler.print_statistics(stdout);
+
+		if (tracePath)
+		{
+			if (frameProfiler.write_chrome_trace(tracePath))
+				std::printf("Profiler trace written to '%s'\n", tracePath);
+			else
+				std::fprintf(stderr, "Warning: unable to write profiler trace to '%s'\n", tracePath);
+		}
+	}
+
+	if (recorder)
+	{
+		recorder->close();
+		std::printf("Recorded %zu frames to '%s'\n", recorder->frames(), recordPath);
+	}
+
+	if (replay && replay->frames_replayed() < replay->frames())
+		std::fprintf(stderr, "Warning: replay stopped after %zu of %zu frames\n", replay->frames_replayed(), replay->frames());
+
+	if (bench)
+	{
+		if (benchFrame < kBenchmarkWarmupFrames_ + benchFrames)
+			throw Error("Benchmark interrupted after %zu frames", benchFrame);
+
+		benchResults.scopes = frameProfiler.statistics();
+
+		std::FILE* fout = benchOutput ? std::fopen(benchOutput, "w") : stdout;
+		if (!fout)
+			throw Error("Unable to open '%s' for writing", benchOutput);
+
+		bool const written = write_bench_json(fout, benchResults);
+		if (benchOutput && 0 != std::fclose(fout))
+			throw Error("Unable to write benchmark results to '%s'", benchOutput);
+		if (!written)
+			throw Error("Unable to write benchmark results");
+
+		if (benchOutput)
+			std::printf("Benchmark results written to '%s'\n", benchOutput);
 	}
 
 	// Cleanup.
 	//TODO: additional cleanup
-	state.prog = nullptr;
+	state.shading = nullptr;
+	state.depthProg = nullptr;
+	state.instancedShading = nullptr;
+	state.instancedGbufferProg = nullptr;
+	state.instancedDepthProg = nullptr;
+	state.gbufferProg = nullptr;
+	state.deferredProg = nullptr;
+	state.hizProg = nullptr;
+	state.cullProg = nullptr;
+	state.tessShading = nullptr;
+	state.tessGbufferProg = nullptr;
+	state.tessDepthProg = nullptr;
+	glDeleteVertexArrays(1, &fullscreenVao);
 	glDeleteTextures(1, &texture);
-	glDeleteVertexArrays(1, &parlahti_vao);
-	glDeleteVertexArrays(1, &vao);
-	glDeleteVertexArrays(1, &landingpad_vao);
+
+	// Messages of the last frames, and repeat counts (--async-debug)
+	shutdown_gl_debug_output();
 	return 0;
 }
 catch (std::exception const& eErr)
@@ -472,7 +1588,106 @@ namespace
 		std::fprintf(stderr, "GLFW error: %s (%d)\n", aErrDesc, aErrNum);
 	}
 
-	void glfw_callback_key_(GLFWwindow* aWindow, int aKey, int, int aAction, int)
+	float nearest_view_depth_(Mat44f const& aWorldToCamera, AABB const& aBounds) noexcept
+	{
+		if (is_empty(aBounds))
+			return 0.f;
+
+		// The camera looks down -z, so the nearest point has the largest z.
+		AABB const viewBounds = transform(aWorldToCamera, aBounds);
+		return std::max(0.f, -viewBounds.max.z);
+	}
+
+	void print_benchmark_(char const* aLabel, GpuFrameStats::Totals const& aTotals, float aSeconds)
+	{
+		if (0 == aTotals.frames)
+			return;
+
+		auto const frames = double(aTotals.frames);
+		std::printf("  %s: %.3f ms frame time, %.3f ms GPU time per frame", aLabel, double(aSeconds) / frames * 1e3, double(aTotals.gpuTimeNs) / frames * 1e-6);
+
+		if (aTotals.hasFragmentInvocations)
+			std::printf(", %.0f fragment shader invocations per frame\n", double(aTotals.fragmentInvocations) / frames);
+		else
+			std::printf(" (fragment shader invocations unavailable: no ARB_pipeline_statistics_query)\n");
+	}
+
+	void check_uniform_blocks_(ShaderProgram const& aProg)
+	{
+#		if !defined(NDEBUG)
+		// Catch mismatches between the C++ mirrors and the GLSL declarations
+		// early. Blocks that are not used by the program are not reported.
+		auto const check = [&aProg](char const* aName, GLint aBinding, std::size_t aSize)
+		{
+			if (auto const* block = aProg.find_block(aName))
+			{
+				if (block->binding != aBinding || std::size_t(block->dataSize) != aSize)
+				{
+					std::fprintf(stderr, "Warning: uniform block \"%s\" has binding %d and size %d, expected binding %d and size %zu\n", aName, block->binding, block->dataSize, aBinding, aSize);
+				}
+			}
+		};
+
+		check("Frame", kFrameBlockBinding, sizeof(FrameUniforms));
+		check("Clusters", kClusterBlockBinding, sizeof(ClusterUniforms));
+		check("Terrain", kTerrainBlockBinding, sizeof(TerrainUniforms));
+
+		// For runtime-sized arrays, GL reports the size of the fixed part
+		// plus one array element.
+		auto const checkStorage = [&aProg](char const* aName, GLint aBinding, std::size_t aElementSize)
+		{
+			if (auto const* block = aProg.find_block(aName, GL_SHADER_STORAGE_BLOCK))
+			{
+				if (block->binding != aBinding || std::size_t(block->dataSize) != aElementSize)
+				{
+					std::fprintf(stderr, "Warning: storage block \"%s\" has binding %d and size %d, expected binding %d and size %zu\n", aName, block->binding, block->dataSize, aBinding, aElementSize);
+				}
+			}
+		};
+
+		checkStorage("Instances", kInstanceBufferBinding, sizeof(InstanceData));
+		checkStorage("Draws", kDrawBufferBinding, sizeof(DrawData));
+		checkStorage("Lights", kLightBufferBinding, sizeof(PointLightData));
+		checkStorage("CullObjects", kCullObjectBufferBinding, sizeof(CullObjectData));
+		checkStorage("CullDraws", kCullDrawBufferBinding, sizeof(DrawData));
+#		else
+		(void)aProg;
+#		endif // ~ !NDEBUG
+	}
+
+	void glfw_callback_key_(GLFWwindow* aWindow, int aKey, int, int aAction, int aMods)
+	{
+		if (auto* state = static_cast<State_*>(glfwGetWindowUserPointer(aWindow)))
+		{
+			if (state->replaying)
+			{
+				if (GLFW_KEY_ESCAPE == aKey && GLFW_PRESS == aAction)
+					glfwSetWindowShouldClose(aWindow, GLFW_TRUE);
+				return;
+			}
+
+			if (state->recorder)
+				state->recorder->key(aKey, aAction, aMods);
+		}
+
+		handle_key_(aWindow, aKey, aAction);
+	}
+
+	void glfw_callback_motion_(GLFWwindow* aWindow, double aX, double aY)
+	{
+		if (auto* state = static_cast<State_*>(glfwGetWindowUserPointer(aWindow)))
+		{
+			if (state->replaying)
+				return;
+
+			if (state->recorder)
+				state->recorder->motion(aX, aY);
+		}
+
+		handle_motion_(aWindow, aX, aY);
+	}
+
+	void handle_key_(GLFWwindow* aWindow, int aKey, int aAction)
 	{
 		if (GLFW_KEY_ESCAPE == aKey && GLFW_PRESS == aAction)
 		{
@@ -482,27 +1697,52 @@ namespace
 
 		if (auto* state = static_cast<State_*>(glfwGetWindowUserPointer(aWindow)))
 		{
-			// R-key reloads shaders.
+			// R-key reloads shaders (in the main loop, without blocking).
 			if (GLFW_KEY_R == aKey && GLFW_PRESS == aAction)
 			{
-				if (state->prog)
-				{
-					try
-					{
-						state->prog->reload();
-						std::fprintf(stderr, "Shaders reloaded and recompiled.\n");
-					}
-					catch (std::exception const& eErr)
-					{
-						std::fprintf(stderr, "Error when reloading shader:\n");
-						std::fprintf(stderr, "%s\n", eErr.what());
-						std::fprintf(stderr, "Keeping old shader.\n");
-					}
-				}
-
+				state->reloadRequested = true;
 				state->isAnimating = false;
 			}
 
+			// P toggles the depth pre-pass
+			if (GLFW_KEY_P == aKey && GLFW_PRESS == aAction)
+			{
+				state->depthPrepass = !state->depthPrepass;
+				std::fprintf(stderr, "Depth pre-pass %s.\n", state->depthPrepass ? "on" : "off");
+			}
+
+			// G toggles deferred shading
+			if (GLFW_KEY_G == aKey && GLFW_PRESS == aAction)
+			{
+				state->deferred = !state->deferred;
+				std::fprintf(stderr, "%s shading.\n", state->deferred ? "Deferred" : "Forward");
+			}
+
+			// O toggles occlusion culling
+			if (GLFW_KEY_O == aKey && GLFW_PRESS == aAction)
+			{
+				state->occlusionCulling = !state->occlusionCulling;
+				std::fprintf(stderr, "Occlusion culling %s.\n", state->occlusionCulling ? "on" : "off");
+			}
+
+			// C toggles between GPU and CPU (BVH) culling of the scene objects
+			if (GLFW_KEY_C == aKey && GLFW_PRESS == aAction)
+			{
+				state->gpuCulling = !state->gpuCulling;
+				std::fprintf(stderr, "%s culling.\n", state->gpuCulling ? "GPU" : "CPU");
+			}
+
+			// T toggles the tessellated terrain
+			if (GLFW_KEY_T == aKey && GLFW_PRESS == aAction)
+			{
+				state->tessellation = !state->tessellation;
+				std::fprintf(stderr, "Terrain %s.\n", state->tessellation ? "tessellated from the heightmap" : "drawn from tiles");
+			}
+
+			// H toggles the performance HUD
+			if (GLFW_KEY_H == aKey && GLFW_PRESS == aAction)
+				state->hud = !state->hud;
+
 			// Space toggles camera
 			if (GLFW_KEY_SPACE == aKey && GLFW_PRESS == aAction)
 			{
@@ -552,7 +1792,7 @@ namespace
 		}
 	}
 
-	void glfw_callback_motion_(GLFWwindow* aWindow, double aX, double aY)
+	void handle_motion_(GLFWwindow* aWindow, double aX, double aY)
 	{
 		if (auto* state = static_cast<State_*>(glfwGetWindowUserPointer(aWindow)))
 		{
@@ -0,0 +1,205 @@
+#include "multi_draw.hpp"
+
+#include <utility>
+#include <unordered_map>
+
+#include <cassert>
+#include <cstring>
+
+#include "../support/checkpoint.hpp"
+#include "../support/hash.hpp"
+
+namespace
+{
+	// Vertex attribute binding point of the draw index buffer
+	constexpr GLuint kDrawIdBinding_ = 1;
+
+	// Vertices are welded if they are bitwise identical. InterleavedVertex
+	// has no padding, so comparing the raw bytes is safe.
+	struct VertexHash_
+	{
+		std::size_t operator()( InterleavedVertex const& aVertex ) const noexcept
+		{
+			return std::size_t(hash_bytes( &aVertex, sizeof(InterleavedVertex) ));
+		}
+	};
+	struct VertexEqual_
+	{
+		bool operator()( InterleavedVertex const& aX, InterleavedVertex const& aY ) const noexcept
+		{
+			return 0 == std::memcmp( &aX, &aY, sizeof(InterleavedVertex) );
+		}
+	};
+}
+
+void weld_vertices( SimpleMeshData const& aMeshData, std::vector<InterleavedVertex>& aVertices, std::vector<GLuint>& aIndices )
+{
+	auto const count = aMeshData.positions.size();
+	auto const baseVertex = aVertices.size();
+
+	std::unordered_map<InterleavedVertex, GLuint, VertexHash_, VertexEqual_> unique;
+	unique.reserve( count );
+
+	for( std::size_t i = 0; i < count; ++i )
+	{
+		auto const vertex = interleaved_vertex( aMeshData, i );
+		auto const [it, inserted] = unique.emplace( vertex, GLuint(aVertices.size() - baseVertex) );
+
+		if( inserted )
+			aVertices.emplace_back( vertex );
+
+		aIndices.emplace_back( it->second );
+	}
+}
+
+
+// MultiDrawList
+MultiDrawList::MultiDrawList() noexcept
+	: mDrawIdBuffer( 0 )
+	, mDrawIdCapacity( 0 )
+{}
+
+MultiDrawList::~MultiDrawList()
+{
+	if( 0 != mDrawIdBuffer )
+		glDeleteBuffers( 1, &mDrawIdBuffer );
+}
+
+MultiDrawList::MultiDrawList( MultiDrawList&& aOther ) noexcept
+	: mVaos( std::move(aOther.mVaos) )
+	, mDrawIdBuffer( std::exchange( aOther.mDrawIdBuffer, 0 ) )
+	, mDrawIdCapacity( std::exchange( aOther.mDrawIdCapacity, 0 ) )
+	, mCommands( std::move(aOther.mCommands) )
+	, mDraws( std::move(aOther.mDraws) )
+{}
+MultiDrawList& MultiDrawList::operator= (MultiDrawList&& aOther) noexcept
+{
+	std::swap( mVaos, aOther.mVaos );
+	std::swap( mDrawIdBuffer, aOther.mDrawIdBuffer );
+	std::swap( mDrawIdCapacity, aOther.mDrawIdCapacity );
+	std::swap( mCommands, aOther.mCommands );
+	std::swap( mDraws, aOther.mDraws );
+	return *this;
+}
+
+void MultiDrawList::attach( GLuint aVao )
+{
+	assert( 0 != aVao );
+	mVaos.emplace_back( aVao );
+
+	// Draw index fallback: advances once per instance, starting at the
+	// command's baseInstance.
+	glBindVertexArray( aVao );
+	glVertexAttribIFormat( kAttribDrawId, 1, GL_UNSIGNED_INT, 0 );
+	glVertexAttribBinding( kAttribDrawId, kDrawIdBinding_ );
+	glVertexBindingDivisor( kDrawIdBinding_, 1 );
+	glEnableVertexAttribArray( kAttribDrawId );
+
+	if( 0 != mDrawIdBuffer )
+		glBindVertexBuffer( kDrawIdBinding_, mDrawIdBuffer, 0, sizeof(GLuint) );
+
+	glBindVertexArray( 0 );
+
+	ensure_draw_ids_( 64 );
+}
+
+void MultiDrawList::clear() noexcept
+{
+	mCommands.clear();
+	mDraws.clear();
+}
+
+void MultiDrawList::add( GLuint aIndexCount, GLuint aFirstIndex, GLint aBaseVertex, Mat44f const& aModel, std::uint32_t aFlags )
+{
+	DrawElementsIndirectCommand cmd{};
+	cmd.count = aIndexCount;
+	cmd.instanceCount = 1;
+	cmd.firstIndex = aFirstIndex;
+	cmd.baseVertex = aBaseVertex;
+	cmd.baseInstance = GLuint(mCommands.size());
+
+	mCommands.emplace_back( cmd );
+	mDraws.emplace_back( DrawData{ aModel, aFlags, {} } );
+}
+
+std::size_t MultiDrawList::size() const noexcept
+{
+	return mCommands.size();
+}
+
+void MultiDrawList::reserve( std::size_t aDraws )
+{
+	assert( !mVaos.empty() ); // attach() first
+	ensure_draw_ids_( aDraws );
+}
+
+RenderPacket MultiDrawList::make_packet( RingBuffer& aRing, GLuint aProgram, GLuint aTexture )
+{
+	assert( !mVaos.empty() ); // attach() first
+
+	ensure_draw_ids_( mCommands.size() );
+
+	auto const commandBytes = GLsizeiptr(mCommands.size() * sizeof(DrawElementsIndirectCommand));
+	auto const commands = aRing.allocate( commandBytes, sizeof(GLuint) );
+	std::memcpy( commands.data, mCommands.data(), std::size_t(commandBytes) );
+
+	auto const drawBytes = GLsizeiptr(mDraws.size() * sizeof(DrawData));
+	auto const draws = aRing.allocate( drawBytes, aRing.storage_alignment() );
+	std::memcpy( draws.data, mDraws.data(), std::size_t(drawBytes) );
+
+	RenderPacket packet{};
+	packet.kind = RenderPacket::Kind::ElementsIndirectMulti;
+	packet.mode = GL_TRIANGLES;
+	packet.program = aProgram;
+	packet.vertexArray = mVaos.front();
+	packet.texture = aTexture;
+	packet.dataTarget = GL_SHADER_STORAGE_BUFFER;
+	packet.dataBinding = kDrawBufferBinding;
+	packet.dataBuffer = aRing.bufferId();
+	packet.dataOffset = draws.offset;
+	packet.dataSize = draws.size;
+	packet.indexType = GL_UNSIGNED_INT;
+	packet.indirectBuffer = aRing.bufferId();
+	packet.indirectOffset = commands.offset;
+	packet.drawCount = GLsizei(mCommands.size());
+	return packet;
+}
+
+void MultiDrawList::ensure_draw_ids_( std::size_t aCount )
+{
+	if( aCount <= mDrawIdCapacity )
+		return;
+
+	auto capacity = mDrawIdCapacity ? mDrawIdCapacity : 64;
+	while( capacity < aCount )
+		capacity *= 2;
+
+	std::vector<GLuint> ids( capacity );
+	for( std::size_t i = 0; i < capacity; ++i )
+		ids[i] = GLuint(i);
+
+	// Immutable storage cannot be resized; replace the buffer instead.
+	if( 0 != mDrawIdBuffer )
+		glDeleteBuffers( 1, &mDrawIdBuffer );
+
+	glGenBuffers( 1, &mDrawIdBuffer );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, mDrawIdBuffer );
+
+	if( GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage )
+		glBufferStorage( GL_COPY_WRITE_BUFFER, GLsizeiptr(capacity * sizeof(GLuint)), ids.data(), 0 );
+	else
+		glBufferData( GL_COPY_WRITE_BUFFER, GLsizeiptr(capacity * sizeof(GLuint)), ids.data(), GL_STATIC_DRAW );
+
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+	for( auto const vao : mVaos )
+	{
+		glBindVertexArray( vao );
+		glBindVertexBuffer( kDrawIdBinding_, mDrawIdBuffer, 0, sizeof(GLuint) );
+	}
+	glBindVertexArray( 0 );
+
+	mDrawIdCapacity = capacity;
+
+	OGL_CHECKPOINT_DEBUG();
+}
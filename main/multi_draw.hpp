@@ -0,0 +1,103 @@
+#ifndef MULTI_DRAW_HPP_E3B4186C_0F27_4A9D_8C51_7A2D96F04E1B
+#define MULTI_DRAW_HPP_E3B4186C_0F27_4A9D_8C51_7A2D96F04E1B
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/mat44.hpp"
+
+#include "../support/ring_buffer.hpp"
+
+#include "gpu_mesh.hpp"
+#include "simple_mesh.hpp"
+#include "render_queue.hpp"
+#include "uniform_blocks.hpp"
+
+// Vertex attribute location of the per-draw index (see batched.vert)
+constexpr GLuint kAttribDrawId = 4;
+
+// Layout of one command in the GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+static_assert( sizeof(DrawElementsIndirectCommand) == 20 );
+
+/* Appends the vertices of aMeshData to aVertices, merging ("welding")
+ * bitwise identical vertices, and appends one index per input vertex to
+ * aIndices. The indices are relative to the first vertex appended by this
+ * call, i.e., they are meant to be used with a baseVertex.
+ */
+void weld_vertices(
+	SimpleMeshData const&,
+	std::vector<InterleavedVertex>& aVertices,
+	std::vector<GLuint>& aIndices
+);
+
+/* Per-frame list of draws for one glMultiDrawElementsIndirect()
+ *
+ * Each draw is one DrawElementsIndirectCommand plus one DrawData (see
+ * uniform_blocks.hpp). make_packet() writes both arrays into the ring buffer
+ * and returns a RenderPacket that draws everything with a single call.
+ *
+ * The shader (batched.vert) finds its DrawData with gl_DrawIDARB where
+ * ARB_shader_draw_parameters is available. Otherwise, it reads the draw
+ * index from the kAttribDrawId attribute, which has a divisor of one and is
+ * offset by each command's baseInstance. Both give the same index, as every
+ * command draws exactly one instance with baseInstance set to the draw index.
+ * attach() sets up that attribute in the VAO used with the list. Further VAOs
+ * that draw the same commands (e.g., a position-only VAO for a depth
+ * pre-pass) can be attached as well; make_packet() uses the first one.
+ *
+ * make_packet() and reserve() may change the VAO binding (when they have to
+ * grow the draw index buffer), so call them before executing the render
+ * queue.
+ */
+class MultiDrawList final
+{
+	public:
+		MultiDrawList() noexcept;
+		~MultiDrawList();
+
+		MultiDrawList( MultiDrawList const& ) = delete;
+		MultiDrawList& operator= (MultiDrawList const&) = delete;
+
+		MultiDrawList( MultiDrawList&& ) noexcept;
+		MultiDrawList& operator= (MultiDrawList&&) noexcept;
+
+	public:
+		void attach( GLuint aVao );
+
+		void clear() noexcept;
+		void add( GLuint aIndexCount, GLuint aFirstIndex, GLint aBaseVertex, Mat44f const& aModel, std::uint32_t aFlags );
+
+		std::size_t size() const noexcept;
+
+		// Grows the draw index buffer of the attached VAOs to aDraws draws,
+		// for commands that are not add()ed (e.g., by GpuCuller).
+		void reserve( std::size_t aDraws );
+
+		RenderPacket make_packet( RingBuffer&, GLuint aProgram, GLuint aTexture );
+
+	private:
+		void ensure_draw_ids_( std::size_t );
+
+	private:
+		std::vector<GLuint> mVaos; // Not owned
+		GLuint mDrawIdBuffer;
+		std::size_t mDrawIdCapacity;
+
+		std::vector<DrawElementsIndirectCommand> mCommands;
+		std::vector<DrawData> mDraws;
+};
+
+#endif // MULTI_DRAW_HPP_E3B4186C_0F27_4A9D_8C51_7A2D96F04E1B
@@ -0,0 +1,128 @@
+#include "offscreen_target.hpp"
+
+#include <utility>
+
+#include <cassert>
+
+#include "../support/error.hpp"
+#include "../support/checkpoint.hpp"
+
+OffscreenTarget::OffscreenTarget() noexcept
+	: mFramebuffer( 0 )
+	, mColor( 0 )
+	, mDepth( 0 )
+	, mWidth( 0 )
+	, mHeight( 0 )
+{}
+
+OffscreenTarget::~OffscreenTarget()
+{
+	release_();
+}
+
+OffscreenTarget::OffscreenTarget( OffscreenTarget&& aOther ) noexcept
+	: mFramebuffer( std::exchange( aOther.mFramebuffer, 0 ) )
+	, mColor( std::exchange( aOther.mColor, 0 ) )
+	, mDepth( std::exchange( aOther.mDepth, 0 ) )
+	, mWidth( std::exchange( aOther.mWidth, 0 ) )
+	, mHeight( std::exchange( aOther.mHeight, 0 ) )
+{}
+OffscreenTarget& OffscreenTarget::operator= (OffscreenTarget&& aOther) noexcept
+{
+	std::swap( mFramebuffer, aOther.mFramebuffer );
+	std::swap( mColor, aOther.mColor );
+	std::swap( mDepth, aOther.mDepth );
+	std::swap( mWidth, aOther.mWidth );
+	std::swap( mHeight, aOther.mHeight );
+	return *this;
+}
+
+void OffscreenTarget::resize( GLsizei aWidth, GLsizei aHeight )
+{
+	assert( aWidth > 0 && aHeight > 0 );
+
+	if( aWidth == mWidth && aHeight == mHeight )
+		return;
+
+	release_();
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	GLuint renderbuffers[2] = {};
+	glGenRenderbuffers( 2, renderbuffers );
+	mColor = renderbuffers[0];
+	mDepth = renderbuffers[1];
+
+	glBindRenderbuffer( GL_RENDERBUFFER, mColor );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_SRGB8_ALPHA8, aWidth, aHeight );
+	glBindRenderbuffer( GL_RENDERBUFFER, mDepth );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, aWidth, aHeight );
+	glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+
+	glGenFramebuffers( 1, &mFramebuffer );
+	glBindFramebuffer( GL_FRAMEBUFFER, mFramebuffer );
+
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mColor );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepth );
+
+	auto const status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	if( GL_FRAMEBUFFER_COMPLETE != status )
+	{
+		release_();
+		throw Error( "OffscreenTarget: framebuffer incomplete (status 0x%x) at %dx%d", unsigned(status), int(aWidth), int(aHeight) );
+	}
+
+	mWidth = aWidth;
+	mHeight = aHeight;
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+GLuint OffscreenTarget::framebuffer() const noexcept
+{
+	return mFramebuffer;
+}
+
+GLsizei OffscreenTarget::width() const noexcept
+{
+	return mWidth;
+}
+GLsizei OffscreenTarget::height() const noexcept
+{
+	return mHeight;
+}
+
+void OffscreenTarget::read_pixels( std::vector<std::uint8_t>& aPixels ) const
+{
+	assert( 0 != mFramebuffer );
+
+	aPixels.resize( std::size_t(mWidth) * std::size_t(mHeight) * 4 );
+
+	// Keep the bindings of the caller
+	GLint readFramebuffer = 0;
+	glGetIntegerv( GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer );
+
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, mFramebuffer );
+	glReadBuffer( GL_COLOR_ATTACHMENT0 );
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+	glReadPixels( 0, 0, mWidth, mHeight, GL_RGBA, GL_UNSIGNED_BYTE, aPixels.data() );
+	glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, GLuint(readFramebuffer) );
+
+	OGL_CHECKPOINT_DEBUG();
+}
+
+void OffscreenTarget::release_() noexcept
+{
+	if( 0 != mFramebuffer )
+		glDeleteFramebuffers( 1, &mFramebuffer );
+
+	GLuint const renderbuffers[] = { mColor, mDepth };
+	glDeleteRenderbuffers( 2, renderbuffers ); // Zeros are silently ignored
+
+	mFramebuffer = mColor = mDepth = 0;
+	mWidth = mHeight = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef OFFSCREEN_TARGET_HPP_71C94E2B_3A58_4F0D_8B6E_D2F5A1093C67
+#define OFFSCREEN_TARGET_HPP_71C94E2B_3A58_4F0D_8B6E_D2F5A1093C67
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstdint>
+
+/* Framebuffer that stands in for the window's default framebuffer
+ *
+ * A GL_SRGB8_ALPHA8 colour and a GL_DEPTH_COMPONENT24 depth renderbuffer,
+ * i.e., the formats of the default framebuffer that main() requests. Used
+ * by --bench, where the window is hidden: pixels of a hidden window fail the
+ * pixel ownership test on some platforms, so rendering into it directly
+ * would not produce an image (or a meaningful workload).
+ *
+ * resize() (re-)creates the renderbuffers when the size changes.
+ */
+class OffscreenTarget final
+{
+	public:
+		OffscreenTarget() noexcept;
+		~OffscreenTarget();
+
+		OffscreenTarget( OffscreenTarget const& ) = delete;
+		OffscreenTarget& operator= (OffscreenTarget const&) = delete;
+
+		OffscreenTarget( OffscreenTarget&& ) noexcept;
+		OffscreenTarget& operator= (OffscreenTarget&&) noexcept;
+
+	public:
+		void resize( GLsizei aWidth, GLsizei aHeight );
+
+		GLuint framebuffer() const noexcept;
+
+		GLsizei width() const noexcept;
+		GLsizei height() const noexcept;
+
+		// Reads back the colour buffer as tightly packed RGBA8 rows, bottom
+		// row first. Waits for the GPU.
+		void read_pixels( std::vector<std::uint8_t>& aPixels ) const;
+
+	private:
+		void release_() noexcept;
+
+	private:
+		GLuint mFramebuffer;
+		GLuint mColor;
+		GLuint mDepth;
+
+		GLsizei mWidth;
+		GLsizei mHeight;
+};
+
+#endif // OFFSCREEN_TARGET_HPP_71C94E2B_3A58_4F0D_8B6E_D2F5A1093C67
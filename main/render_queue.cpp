@@ -0,0 +1,322 @@
+#include "render_queue.hpp"
+
+#include <cassert>
+#include <cstring>
+
+#include "../support/checkpoint.hpp"
+#include "../support/profiler.hpp"
+
+// From ARB_indirect_parameters, in case the GL loader was generated without
+// the extension's enums.
+#if !defined(GL_PARAMETER_BUFFER_ARB)
+#	define GL_PARAMETER_BUFFER_ARB 0x80EE
+#endif
+
+// RenderStateCache
+RenderStateCache::RenderStateCache() noexcept
+{
+	invalidate();
+	reset_stats();
+}
+
+void RenderStateCache::invalidate() noexcept
+{
+	// ~0u is never a valid GL name, so the next bind of any kind is issued.
+	mProgram = ~GLuint(0);
+	mVertexArray = ~GLuint(0);
+
+	for( auto& texture : mTextures )
+		texture = ~GLuint(0);
+
+	mDrawIndirectBuffer = ~GLuint(0);
+	mParameterBuffer = ~GLuint(0);
+	mDepthModeValid = false;
+
+	for( auto& range : mUniformRanges )
+		range = BufferRange_{ ~GLuint(0), 0, 0 };
+	for( auto& range : mStorageRanges )
+		range = BufferRange_{ ~GLuint(0), 0, 0 };
+}
+
+void RenderStateCache::use_program( GLuint aProgram ) noexcept
+{
+	if( aProgram == mProgram )
+	{
+		++mStats.redundant;
+		return;
+	}
+
+	glUseProgram( aProgram );
+	mProgram = aProgram;
+	++mStats.binds;
+}
+
+void RenderStateCache::bind_vertex_array( GLuint aVertexArray ) noexcept
+{
+	if( aVertexArray == mVertexArray )
+	{
+		++mStats.redundant;
+		return;
+	}
+
+	glBindVertexArray( aVertexArray );
+	mVertexArray = aVertexArray;
+	++mStats.binds;
+}
+
+void RenderStateCache::bind_texture_2d( GLuint aUnit, GLuint aTexture ) noexcept
+{
+	assert( aUnit < kMaxTextureUnits );
+	if( aTexture == mTextures[aUnit] )
+	{
+		++mStats.redundant;
+		return;
+	}
+
+	glActiveTexture( GL_TEXTURE0 + aUnit );
+	glBindTexture( GL_TEXTURE_2D, aTexture );
+	mTextures[aUnit] = aTexture;
+	++mStats.binds;
+}
+
+void RenderStateCache::bind_buffer_range( GLenum aTarget, GLuint aIndex, GLuint aBuffer, GLintptr aOffset, GLsizeiptr aSize ) noexcept
+{
+	auto* slot = range_slot_( aTarget, aIndex );
+	if( slot && slot->buffer == aBuffer && slot->offset == aOffset && slot->size == aSize )
+	{
+		++mStats.redundant;
+		return;
+	}
+
+	glBindBufferRange( aTarget, aIndex, aBuffer, aOffset, aSize );
+	++mStats.binds;
+
+	if( slot )
+		*slot = BufferRange_{ aBuffer, aOffset, aSize };
+}
+
+void RenderStateCache::bind_draw_indirect_buffer( GLuint aBuffer ) noexcept
+{
+	if( aBuffer == mDrawIndirectBuffer )
+	{
+		++mStats.redundant;
+		return;
+	}
+
+	glBindBuffer( GL_DRAW_INDIRECT_BUFFER, aBuffer );
+	mDrawIndirectBuffer = aBuffer;
+	++mStats.binds;
+}
+
+void RenderStateCache::bind_parameter_buffer( GLuint aBuffer ) noexcept
+{
+	if( aBuffer == mParameterBuffer )
+	{
+		++mStats.redundant;
+		return;
+	}
+
+	glBindBuffer( GL_PARAMETER_BUFFER_ARB, aBuffer );
+	mParameterBuffer = aBuffer;
+	++mStats.binds;
+}
+
+void RenderStateCache::set_depth_mode( DepthMode aMode ) noexcept
+{
+	if( mDepthModeValid && aMode == mDepthMode )
+	{
+		++mStats.redundant;
+		return;
+	}
+
+	switch( aMode )
+	{
+		case DepthMode::Default:
+			glDepthFunc( GL_LESS );
+			glDepthMask( GL_TRUE );
+			glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+			break;
+		case DepthMode::Prepass:
+			glDepthFunc( GL_LESS );
+			glDepthMask( GL_TRUE );
+			glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+			break;
+		case DepthMode::Equal:
+			glDepthFunc( GL_EQUAL );
+			glDepthMask( GL_FALSE );
+			glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+			break;
+	}
+
+	mDepthMode = aMode;
+	mDepthModeValid = true;
+	++mStats.binds;
+}
+
+RenderStateCache::Stats const& RenderStateCache::stats() const noexcept
+{
+	return mStats;
+}
+void RenderStateCache::reset_stats() noexcept
+{
+	mStats = Stats{ 0, 0 };
+}
+
+RenderStateCache::BufferRange_* RenderStateCache::range_slot_( GLenum aTarget, GLuint aIndex ) noexcept
+{
+	if( aIndex >= kMaxBufferBindings )
+		return nullptr;
+
+	switch( aTarget )
+	{
+		case GL_UNIFORM_BUFFER: return &mUniformRanges[aIndex];
+		case GL_SHADER_STORAGE_BUFFER: return &mStorageRanges[aIndex];
+	}
+
+	return nullptr;
+}
+
+
+// Sort keys
+RenderPacket make_depth_prepass_packet( RenderPacket const& aColorPacket, GLuint aProgram, GLuint aVertexArray ) noexcept
+{
+	RenderPacket packet = aColorPacket;
+	packet.program = aProgram;
+	packet.vertexArray = aVertexArray;
+	packet.texture = 0;
+	packet.depthMode = DepthMode::Prepass;
+	return packet;
+}
+
+std::uint64_t make_sort_key( RenderLayer aLayer, GLuint aProgram, GLuint aTexture, GLuint aVertexArray, float aViewDepth, float aFarPlane ) noexcept
+{
+	constexpr std::uint32_t kDepthMax = (1u << 22) - 1;
+
+	float depth = aFarPlane > 0.f ? aViewDepth / aFarPlane : 0.f;
+	depth = depth < 0.f ? 0.f : (depth > 1.f ? 1.f : depth);
+
+	auto const quantizedDepth = std::uint64_t(depth * float(kDepthMax));
+
+	return (std::uint64_t(std::uint8_t(aLayer) & 0x3u) << 62)
+		| (std::uint64_t(aProgram & 0xffu) << 54)
+		| (std::uint64_t(aTexture & 0xffffu) << 38)
+		| (std::uint64_t(aVertexArray & 0xffffu) << 22)
+		| (quantizedDepth & kDepthMax)
+	;
+}
+
+
+// RenderQueue
+void RenderQueue::clear() noexcept
+{
+	mEntries.clear();
+	mPackets.clear();
+}
+void RenderQueue::reserve( std::size_t aCount )
+{
+	mEntries.reserve( aCount );
+	mScratch.reserve( aCount );
+	mPackets.reserve( aCount );
+}
+
+void RenderQueue::submit( std::uint64_t aKey, RenderPacket const& aPacket )
+{
+	mEntries.emplace_back( Entry_{ aKey, std::uint32_t(mPackets.size()) } );
+	mPackets.emplace_back( aPacket );
+}
+
+void RenderQueue::sort()
+{
+	// LSD radix sort, 8 bits per pass. Passes where all keys fall into the
+	// same bucket (common for the program byte) are skipped entirely.
+	auto const count = mEntries.size();
+	if( count < 2 )
+		return;
+
+	mScratch.resize( count );
+
+	Entry_* src = mEntries.data();
+	Entry_* dst = mScratch.data();
+
+	for( unsigned shift = 0; shift < 64; shift += 8 )
+	{
+		std::size_t histogram[256]{};
+		for( std::size_t i = 0; i < count; ++i )
+			++histogram[(src[i].key >> shift) & 0xff];
+
+		if( histogram[(src[0].key >> shift) & 0xff] == count )
+			continue;
+
+		std::size_t sum = 0;
+		for( auto& bucket : histogram )
+		{
+			auto const n = bucket;
+			bucket = sum;
+			sum += n;
+		}
+
+		for( std::size_t i = 0; i < count; ++i )
+			dst[histogram[(src[i].key >> shift) & 0xff]++] = src[i];
+
+		std::swap( src, dst );
+	}
+
+	if( src != mEntries.data() )
+		std::memcpy( mEntries.data(), src, count * sizeof(Entry_) );
+}
+
+void RenderQueue::execute( RenderStateCache& aCache, Profiler* aProfiler ) const
+{
+	for( auto const& entry : mEntries )
+	{
+		auto const& packet = mPackets[entry.packet];
+
+		Profiler* const profiler = packet.label ? aProfiler : nullptr;
+		ProfileScope cpuScope( profiler, packet.label );
+		GpuProfileScope gpuScope( profiler, packet.label );
+
+		aCache.set_depth_mode( packet.depthMode );
+		aCache.use_program( packet.program );
+		aCache.bind_texture_2d( 0, packet.texture );
+		aCache.bind_vertex_array( packet.vertexArray );
+
+		if( 0 != packet.dataBuffer )
+			aCache.bind_buffer_range( packet.dataTarget, packet.dataBinding, packet.dataBuffer, packet.dataOffset, packet.dataSize );
+
+		switch( packet.kind )
+		{
+			case RenderPacket::Kind::Arrays:
+				glDrawArrays( packet.mode, packet.first, packet.count );
+				break;
+			case RenderPacket::Kind::ArraysInstanced:
+				glDrawArraysInstanced( packet.mode, packet.first, packet.count, packet.instanceCount );
+				break;
+			case RenderPacket::Kind::ElementsIndirectMulti:
+				// ElementsIndirectMultiCount packets leave their count buffer
+				// bound to GL_PARAMETER_BUFFER. ARB_indirect_parameters says
+				// only the *Count draws read it, but Mesa 22.3 (llvmpipe) also
+				// takes the draw count from it here, which drops these draws
+				// from the second frame on. The cache makes this a no-op when
+				// no count draw ran in between.
+				if( GLAD_GL_ARB_indirect_parameters )
+					aCache.bind_parameter_buffer( 0 );
+
+				aCache.bind_draw_indirect_buffer( packet.indirectBuffer );
+				glMultiDrawElementsIndirect( packet.mode, packet.indexType, reinterpret_cast<void const*>(packet.indirectOffset), packet.drawCount, 0 );
+				break;
+			case RenderPacket::Kind::ElementsIndirectMultiCount:
+				assert( GLAD_GL_ARB_indirect_parameters );
+				aCache.bind_draw_indirect_buffer( packet.indirectBuffer );
+				aCache.bind_parameter_buffer( packet.parameterBuffer );
+				glMultiDrawElementsIndirectCountARB( packet.mode, packet.indexType, reinterpret_cast<void const*>(packet.indirectOffset), packet.parameterOffset, packet.drawCount, 0 );
+				break;
+		}
+	}
+
+	OGL_CHECKPOINT_DEBUG();
+}
+
+std::size_t RenderQueue::size() const noexcept
+{
+	return mEntries.size();
+}
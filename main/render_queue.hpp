@@ -0,0 +1,223 @@
+#ifndef RENDER_QUEUE_HPP_5B2F8C61_0E4D_4A97_93C3_8D16E7A2F04B
+#define RENDER_QUEUE_HPP_5B2F8C61_0E4D_4A97_93C3_8D16E7A2F04B
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+class Profiler;
+
+/* Depth and colour write state of a draw
+ *
+ * Default:  GL_LESS, depth writes on, colour writes on
+ * Prepass:  GL_LESS, depth writes on, colour writes off (depth-only pass)
+ * Equal:    GL_EQUAL, depth writes off, colour writes on (after a pre-pass,
+ *           only the visible fragment of each pixel is shaded)
+ */
+enum class DepthMode : std::uint8_t
+{
+	Default,
+	Prepass,
+	Equal
+};
+
+// Render layers, drawn in this order (see make_sort_key())
+enum class RenderLayer : std::uint8_t
+{
+	DepthPrepass = 0,
+	Opaque = 1
+};
+
+/* Caches the GL binding state touched by the render queue
+ *
+ * Every bind (and DepthMode change) goes through the cache, which skips the
+ * GL call if the same object is already bound. Call invalidate() whenever
+ * code outside of the cache may have changed the bindings (e.g., at the
+ * start of each frame).
+ */
+class RenderStateCache final
+{
+	public:
+		struct Stats
+		{
+			std::size_t binds;     // GL bind calls issued
+			std::size_t redundant; // bind calls skipped by the cache
+		};
+
+	public:
+		RenderStateCache() noexcept;
+
+	public:
+		void invalidate() noexcept;
+
+		void use_program( GLuint ) noexcept;
+		void bind_vertex_array( GLuint ) noexcept;
+		void bind_texture_2d( GLuint aUnit, GLuint aTexture ) noexcept;
+		void bind_buffer_range( GLenum aTarget, GLuint aIndex, GLuint aBuffer, GLintptr aOffset, GLsizeiptr aSize ) noexcept;
+		void bind_draw_indirect_buffer( GLuint ) noexcept;
+		void bind_parameter_buffer( GLuint ) noexcept;
+
+		void set_depth_mode( DepthMode ) noexcept;
+
+		Stats const& stats() const noexcept;
+		void reset_stats() noexcept;
+
+	private:
+		static constexpr std::size_t kMaxTextureUnits = 8;
+		static constexpr std::size_t kMaxBufferBindings = 8;
+
+		struct BufferRange_
+		{
+			GLuint buffer;
+			GLintptr offset;
+			GLsizeiptr size;
+		};
+
+		BufferRange_* range_slot_( GLenum, GLuint ) noexcept;
+
+	private:
+		GLuint mProgram;
+		GLuint mVertexArray;
+		GLuint mTextures[kMaxTextureUnits];
+		GLuint mDrawIndirectBuffer;
+		GLuint mParameterBuffer;
+
+		DepthMode mDepthMode;
+		bool mDepthModeValid;
+
+		BufferRange_ mUniformRanges[kMaxBufferBindings];
+		BufferRange_ mStorageRanges[kMaxBufferBindings];
+
+		Stats mStats;
+};
+
+
+/* Draw packet submitted to the RenderQueue
+ *
+ * Describes one draw call together with the state it needs. Packets only
+ * reference GL objects; they do not own anything.
+ */
+struct RenderPacket
+{
+	enum class Kind : std::uint8_t
+	{
+		Arrays,                    // glDrawArrays
+		ArraysInstanced,           // glDrawArraysInstanced
+		ElementsIndirectMulti,     // glMultiDrawElementsIndirect
+		ElementsIndirectMultiCount // glMultiDrawElementsIndirectCountARB
+	};
+
+	Kind kind;
+	GLenum mode;
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint texture; // Bound to texture unit 0
+
+	DepthMode depthMode;
+
+	GLint first;
+	GLsizei count;
+	GLsizei instanceCount;
+
+	// ElementsIndirectMulti only: drawCount DrawElementsIndirectCommands at
+	// indirectOffset in indirectBuffer. The index buffer is part of the VAO.
+	GLenum indexType;
+	GLuint indirectBuffer;
+	GLintptr indirectOffset;
+	GLsizei drawCount;
+
+	// ElementsIndirectMultiCount only: the number of commands is read from
+	// a GLuint at parameterOffset in parameterBuffer; drawCount is the
+	// maximum.
+	GLuint parameterBuffer;
+	GLintptr parameterOffset;
+
+	// Optional buffer range with per-draw data (e.g., the Draws storage
+	// block). Ignored if buffer is 0.
+	GLenum dataTarget;
+	GLuint dataBinding;
+	GLuint dataBuffer;
+	GLintptr dataOffset;
+	GLsizeiptr dataSize;
+
+	// Name of the CPU and GPU profiler scopes of the draw (see
+	// RenderQueue::execute()). Must be a string literal, or null.
+	char const* label;
+};
+
+/* 64-bit sort key
+ *
+ * From most to least significant bits:
+ *   63..62  layer
+ *   61..54  program
+ *   53..38  material / texture
+ *   37..22  vertex array
+ *   21..0   depth (front to back)
+ *
+ * Sorting by key therefore draws the layers in order (e.g., the depth
+ * pre-pass before the opaque geometry). Within a layer, draws are grouped by
+ * the most expensive state change first, and draws with identical state are
+ * ordered front-to-back, which helps early depth rejection. The object IDs
+ * are truncated to their field width; this only affects how well draws are
+ * grouped, not correctness.
+ */
+std::uint64_t make_sort_key(
+	RenderLayer aLayer,
+	GLuint aProgram,
+	GLuint aTexture,
+	GLuint aVertexArray,
+	float aViewDepth,
+	float aFarPlane
+) noexcept;
+
+/* Returns a copy of aColorPacket for the depth pre-pass
+ *
+ * The copy draws the same geometry with aProgram (a depth-only program, e.g.,
+ * depth.vert) and aVertexArray (typically a position-only VAO that shares the
+ * index and vertex buffers of the original), without textures, and with
+ * DepthMode::Prepass.
+ */
+RenderPacket make_depth_prepass_packet( RenderPacket const& aColorPacket, GLuint aProgram, GLuint aVertexArray ) noexcept;
+
+
+/* Per-frame render queue
+ *
+ * Objects submit packets with a sort key. Once per frame, the queue is sorted
+ * (LSD radix sort over the keys) and executed through a RenderStateCache,
+ * which drops redundant binds between consecutive packets.
+ *
+ * clear() keeps the allocated storage, so that the queue does not allocate
+ * in the steady state.
+ */
+class RenderQueue final
+{
+	public:
+		void clear() noexcept;
+		void reserve( std::size_t );
+
+		void submit( std::uint64_t aKey, RenderPacket const& );
+
+		void sort();
+
+		// With a Profiler, packets that have a label are timed individually
+		void execute( RenderStateCache&, Profiler* = nullptr ) const;
+
+		std::size_t size() const noexcept;
+
+	private:
+		struct Entry_
+		{
+			std::uint64_t key;
+			std::uint32_t packet;
+		};
+
+		std::vector<Entry_> mEntries;
+		std::vector<Entry_> mScratch;
+		std::vector<RenderPacket> mPackets;
+};
+
+#endif // RENDER_QUEUE_HPP_5B2F8C61_0E4D_4A97_93C3_8D16E7A2F04B
@@ -0,0 +1,132 @@
+#include "scene_graph.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	define SCENE_GRAPH_SSE_ 1
+#	include <xmmintrin.h>
+#endif
+
+namespace
+{
+	// aOut = aLeft * aRight (row-major). aOut may not alias aLeft or aRight.
+	void mul_( Mat44f& aOut, Mat44f const& aLeft, Mat44f const& aRight ) noexcept
+	{
+#		if defined(SCENE_GRAPH_SSE_)
+		// Each row of the result is a linear combination of the rows of
+		// aRight, weighted by the elements of the corresponding row of aLeft.
+		__m128 const r0 = _mm_loadu_ps( aRight.v + 0 );
+		__m128 const r1 = _mm_loadu_ps( aRight.v + 4 );
+		__m128 const r2 = _mm_loadu_ps( aRight.v + 8 );
+		__m128 const r3 = _mm_loadu_ps( aRight.v + 12 );
+
+		for( std::size_t i = 0; i < 4; ++i )
+		{
+			float const* row = aLeft.v + i*4;
+
+			__m128 res = _mm_mul_ps( _mm_set1_ps( row[0] ), r0 );
+			res = _mm_add_ps( res, _mm_mul_ps( _mm_set1_ps( row[1] ), r1 ) );
+			res = _mm_add_ps( res, _mm_mul_ps( _mm_set1_ps( row[2] ), r2 ) );
+			res = _mm_add_ps( res, _mm_mul_ps( _mm_set1_ps( row[3] ), r3 ) );
+
+			_mm_storeu_ps( aOut.v + i*4, res );
+		}
+#		else
+		aOut = aLeft * aRight;
+#		endif // ~ SCENE_GRAPH_SSE_
+	}
+}
+
+void SceneGraph::reserve( std::size_t aCount )
+{
+	mLocal.reserve( aCount );
+	mWorld.reserve( aCount );
+	mParent.reserve( aCount );
+	mDirty.reserve( aCount );
+}
+
+SceneGraph::NodeId SceneGraph::add_node( NodeId aParent, Mat44f const& aLocal )
+{
+	auto const id = NodeId(mLocal.size());
+	assert( kNoParent == aParent || aParent < id );
+
+	mLocal.emplace_back( aLocal );
+	mWorld.emplace_back( aLocal );
+	mParent.emplace_back( aParent );
+	mDirty.emplace_back( 1 );
+
+	mFirstDirty = std::min( mFirstDirty, std::size_t(id) );
+	return id;
+}
+
+void SceneGraph::set_local( NodeId aNode, Mat44f const& aLocal )
+{
+	assert( aNode < mLocal.size() );
+
+	mLocal[aNode] = aLocal;
+	mDirty[aNode] = 1;
+
+	mFirstDirty = std::min( mFirstDirty, std::size_t(aNode) );
+}
+
+Mat44f const& SceneGraph::local( NodeId aNode ) const noexcept
+{
+	assert( aNode < mLocal.size() );
+	return mLocal[aNode];
+}
+Mat44f const& SceneGraph::world( NodeId aNode ) const noexcept
+{
+	assert( aNode < mWorld.size() );
+	return mWorld[aNode];
+}
+SceneGraph::NodeId SceneGraph::parent( NodeId aNode ) const noexcept
+{
+	assert( aNode < mParent.size() );
+	return mParent[aNode];
+}
+
+std::size_t SceneGraph::update() noexcept
+{
+	auto const count = mLocal.size();
+	if( mFirstDirty >= count )
+		return 0;
+
+	// Raw pointers keep the loop free of bounds checks in debug builds.
+	Mat44f const* local = mLocal.data();
+	Mat44f* world = mWorld.data();
+	NodeId const* parent = mParent.data();
+	std::uint8_t* dirty = mDirty.data();
+
+	std::size_t updated = 0;
+	for( std::size_t i = mFirstDirty; i < count; ++i )
+	{
+		auto const p = parent[i];
+
+		// Parents precede their children, so the parent's flag (and world
+		// matrix) is final by the time we get here.
+		if( kNoParent != p )
+			dirty[i] |= dirty[p];
+
+		if( !dirty[i] )
+			continue;
+
+		if( kNoParent == p )
+			world[i] = local[i];
+		else
+			mul_( world[i], world[p], local[i] );
+
+		++updated;
+	}
+
+	std::fill( mDirty.begin() + std::ptrdiff_t(mFirstDirty), mDirty.end(), std::uint8_t(0) );
+	mFirstDirty = count;
+
+	return updated;
+}
+
+std::size_t SceneGraph::size() const noexcept
+{
+	return mLocal.size();
+}
@@ -0,0 +1,56 @@
+#ifndef SCENE_GRAPH_HPP_2D8E6A40_B7F3_4C15_9A6C_E04B1F83D579
+#define SCENE_GRAPH_HPP_2D8E6A40_B7F3_4C15_9A6C_E04B1F83D579
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/mat44.hpp"
+
+/* Transform hierarchy with cached world matrices
+ *
+ * Nodes are stored as flat arrays (structure of arrays): local transforms,
+ * world transforms, parent indices and dirty flags. A node's parent must
+ * already exist when the node is added, so the arrays are always in
+ * topological order (parents before children). update() can therefore
+ * compute all world matrices in a single forward pass.
+ *
+ * set_local() marks a node dirty. update() propagates the flag to the node's
+ * descendants and recomputes only the dirty world matrices. Nodes before the
+ * first dirty node cannot be affected and are skipped entirely, so a graph
+ * where nothing moved costs nothing.
+ */
+class SceneGraph final
+{
+	public:
+		using NodeId = std::uint32_t;
+
+		static constexpr NodeId kNoParent = ~NodeId(0);
+
+	public:
+		void reserve( std::size_t );
+
+		NodeId add_node( NodeId aParent = kNoParent, Mat44f const& aLocal = kIdentity44f );
+
+		void set_local( NodeId, Mat44f const& );
+
+		Mat44f const& local( NodeId ) const noexcept;
+		Mat44f const& world( NodeId ) const noexcept;
+		NodeId parent( NodeId ) const noexcept;
+
+		// Returns the number of world matrices that were recomputed.
+		std::size_t update() noexcept;
+
+		std::size_t size() const noexcept;
+
+	private:
+		std::vector<Mat44f> mLocal;
+		std::vector<Mat44f> mWorld;
+		std::vector<NodeId> mParent;
+		std::vector<std::uint8_t> mDirty;
+
+		std::size_t mFirstDirty = 0;
+};
+
+#endif // SCENE_GRAPH_HPP_2D8E6A40_B7F3_4C15_9A6C_E04B1F83D579
@@ -1,8 +1,6 @@
 #ifndef SIMPLE_MESH_HPP_C6B749D6_C83B_434C_9E58_F05FC27FEFC9
 #define SIMPLE_MESH_HPP_C6B749D6_C83B_434C_9E58_F05FC27FEFC9
 
-#include <glad.h>
-
 #include <vector>
 
 #include "../vmlib/vec3.hpp"
@@ -18,6 +16,4 @@ struct SimpleMeshData
 
 SimpleMeshData concatenate(SimpleMeshData, SimpleMeshData const&);
 
-GLuint create_vao(SimpleMeshData const&);
-
 #endif // SIMPLE_MESH_HPP_C6B749D6_C83B_434C_9E58_F05FC27FEFC9
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "static_batch.hpp"
+
+#include <utility>
+
+#include <cassert>
+
+#include "../support/checkpoint.hpp"
+
+StaticBatch::StaticBatch() noexcept
+	: mDepthVao( 0 )
+{}
+
+StaticBatch::~StaticBatch()
+{
+	if( 0 != mDepthVao )
+		glDeleteVertexArrays( 1, &mDepthVao );
+}
+
+StaticBatch::StaticBatch( StaticBatch&& aOther ) noexcept
+	: mMesh( std::move(aOther.mMesh) )
+	, mDepthVao( std::exchange( aOther.mDepthVao, 0 ) )
+	, mVertices( std::move(aOther.mVertices) )
+	, mIndices( std::move(aOther.mIndices) )
+	, mMeshes( std::move(aOther.mMeshes) )
+	, mDraws( std::move(aOther.mDraws) )
+{}
+StaticBatch& StaticBatch::operator= (StaticBatch&& aOther) noexcept
+{
+	std::swap( mMesh, aOther.mMesh );
+	std::swap( mDepthVao, aOther.mDepthVao );
+	std::swap( mVertices, aOther.mVertices );
+	std::swap( mIndices, aOther.mIndices );
+	std::swap( mMeshes, aOther.mMeshes );
+	std::swap( mDraws, aOther.mDraws );
+	return *this;
+}
+
+StaticBatch::MeshId StaticBatch::add_mesh( SimpleMeshData const& aMeshData )
+{
+	assert( 0 == mMesh.vao() ); // Must add meshes before build()
+
+	Mesh_ mesh{};
+	mesh.firstIndex = GLuint(mIndices.size());
+	mesh.indexCount = GLuint(aMeshData.positions.size());
+	mesh.baseVertex = GLint(mVertices.size());
+	mesh.bounds = kEmptyAABB;
+
+	for( auto const& position : aMeshData.positions )
+		mesh.bounds = expand( mesh.bounds, position );
+
+	// Indices are relative to the mesh's first vertex (baseVertex), so that
+	// each mesh's vertices are only welded with each other.
+	weld_vertices( aMeshData, mVertices, mIndices );
+
+	mMeshes.emplace_back( mesh );
+	return MeshId(mMeshes.size() - 1);
+}
+
+void StaticBatch::build()
+{
+	assert( 0 == mMesh.vao() );
+
+	mMesh = GpuMesh( mVertices, mIndices );
+
+	// Position-only VAO over the same buffers, for the depth pre-pass
+	glGenVertexArrays( 1, &mDepthVao );
+	glBindVertexArray( mDepthVao );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mMesh.index_buffer() );
+	set_interleaved_position_format( 0 );
+	glBindVertexBuffer( 0, mMesh.buffer(), 0, sizeof(InterleavedVertex) );
+
+	glBindVertexArray( 0 );
+
+	mDraws.attach( mMesh.vao() );
+	mDraws.attach( mDepthVao );
+
+	mVertices = std::vector<InterleavedVertex>();
+	mIndices = std::vector<GLuint>();
+
+	OGL_CHECKPOINT_DEBUG();
+}
+
+void StaticBatch::clear_draws() noexcept
+{
+	mDraws.clear();
+}
+
+void StaticBatch::add_draw( MeshId aMesh, Mat44f const& aModel, std::uint32_t aFlags )
+{
+	assert( aMesh < mMeshes.size() );
+	auto const& mesh = mMeshes[aMesh];
+
+	mDraws.add( mesh.indexCount, mesh.firstIndex, mesh.baseVertex, aModel, aFlags );
+}
+
+RenderPacket StaticBatch::make_packet( RingBuffer& aRing, GLuint aProgram, GLuint aTexture )
+{
+	assert( 0 != mMesh.vao() );
+	return mDraws.make_packet( aRing, aProgram, aTexture );
+}
+
+void StaticBatch::add_culled_draw( GpuCuller& aCuller, MeshId aMesh, Mat44f const& aModel, std::uint32_t aFlags ) const
+{
+	assert( aMesh < mMeshes.size() );
+	auto const& mesh = mMeshes[aMesh];
+
+	aCuller.add( mesh.indexCount, mesh.firstIndex, mesh.baseVertex, mesh.bounds, aModel, aFlags );
+}
+
+RenderPacket StaticBatch::make_packet( GpuCuller const& aCuller, GLuint aProgram, GLuint aTexture )
+{
+	assert( 0 != mMesh.vao() );
+
+	// The culler's commands index the draw index buffer of both VAOs.
+	mDraws.reserve( aCuller.size() );
+	return aCuller.make_packet( aProgram, mMesh.vao(), aTexture );
+}
+
+GLuint StaticBatch::vao() const noexcept
+{
+	return mMesh.vao();
+}
+GLuint StaticBatch::depth_vao() const noexcept
+{
+	return mDepthVao;
+}
+
+AABB const& StaticBatch::mesh_bounds( MeshId aMesh ) const noexcept
+{
+	assert( aMesh < mMeshes.size() );
+	return mMeshes[aMesh].bounds;
+}
+
+std::size_t StaticBatch::vertex_count() const noexcept
+{
+	return std::size_t(mMesh.vertex_count());
+}
+std::size_t StaticBatch::index_count() const noexcept
+{
+	return std::size_t(mMesh.index_count());
+}
+std::size_t StaticBatch::draw_count() const noexcept
+{
+	return mDraws.size();
+}
@@ -0,0 +1,98 @@
+#ifndef STATIC_BATCH_HPP_A47C2E91_5D3B_4F08_8B6E_19D0C3F7E254
+#define STATIC_BATCH_HPP_A47C2E91_5D3B_4F08_8B6E_19D0C3F7E254
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/aabb.hpp"
+#include "../vmlib/mat44.hpp"
+
+#include "../support/ring_buffer.hpp"
+
+#include "gpu_mesh.hpp"
+#include "gpu_culler.hpp"
+#include "multi_draw.hpp"
+#include "simple_mesh.hpp"
+#include "render_queue.hpp"
+
+/* Static geometry batcher
+ *
+ * Meshes are added once with add_mesh(), which welds identical vertices.
+ * build() uploads all meshes into one indexed GpuMesh, i.e., one shared
+ * vertex arena and one index arena, with a single VAO.
+ *
+ * Each frame, add_draw() the meshes to render. make_packet() returns a
+ * RenderPacket that draws all of them with a single
+ * glMultiDrawElementsIndirect() (see MultiDrawList). The CPU cost of the
+ * submission is therefore independent of the number of draws.
+ *
+ * Alternatively, add_culled_draw() queues the draws in a GpuCuller, which
+ * decides on the GPU which of them to draw; make_packet( GpuCuller const&,
+ * ... ) then draws its output.
+ *
+ * depth_vao() is a second VAO over the same buffers that only fetches the
+ * positions, for a depth pre-pass (see make_depth_prepass_packet()).
+ */
+class StaticBatch final
+{
+	public:
+		using MeshId = std::uint32_t;
+
+	public:
+		StaticBatch() noexcept;
+		~StaticBatch();
+
+		StaticBatch( StaticBatch const& ) = delete;
+		StaticBatch& operator= (StaticBatch const&) = delete;
+
+		StaticBatch( StaticBatch&& ) noexcept;
+		StaticBatch& operator= (StaticBatch&&) noexcept;
+
+	public:
+		MeshId add_mesh( SimpleMeshData const& );
+		void build();
+
+		void clear_draws() noexcept;
+		void add_draw( MeshId, Mat44f const& aModel, std::uint32_t aFlags = 0 );
+
+		RenderPacket make_packet( RingBuffer&, GLuint aProgram, GLuint aTexture );
+
+		void add_culled_draw( GpuCuller&, MeshId, Mat44f const& aModel, std::uint32_t aFlags = 0 ) const;
+		RenderPacket make_packet( GpuCuller const&, GLuint aProgram, GLuint aTexture );
+
+		GLuint vao() const noexcept;
+		GLuint depth_vao() const noexcept;
+
+		// Object-space bounds of a mesh
+		AABB const& mesh_bounds( MeshId ) const noexcept;
+
+		std::size_t vertex_count() const noexcept;
+		std::size_t index_count() const noexcept;
+		std::size_t draw_count() const noexcept;
+
+	private:
+		struct Mesh_
+		{
+			GLuint firstIndex;
+			GLuint indexCount;
+			GLint baseVertex;
+			AABB bounds;
+		};
+
+	private:
+		GpuMesh mMesh;
+		GLuint mDepthVao;
+
+		std::vector<InterleavedVertex> mVertices; // Cleared by build()
+		std::vector<GLuint> mIndices;             // Cleared by build()
+
+		std::vector<Mesh_> mMeshes;
+
+		MultiDrawList mDraws;
+};
+
+#endif // STATIC_BATCH_HPP_A47C2E91_5D3B_4F08_8B6E_19D0C3F7E254
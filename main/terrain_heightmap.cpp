@@ -0,0 +1,100 @@
+#include "terrain_heightmap.hpp"
+
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+namespace
+{
+	// Tolerance of the point-in-triangle test, in barycentric units. Samples
+	// on a shared edge may be written by both triangles; either is fine.
+	constexpr float kEdgeEpsilon_ = 1e-4f;
+}
+
+TerrainHeightmap make_terrain_heightmap( SimpleMeshData const& aMeshData, unsigned aWidth, unsigned aHeight )
+{
+	assert( aWidth > 1 && aHeight > 1 );
+	assert( aMeshData.positions.size() % 3 == 0 );
+
+	TerrainHeightmap ret{};
+	ret.width = aWidth;
+	ret.height = aHeight;
+	ret.bounds = kEmptyAABB;
+	ret.color = Vec3f{ 0.f, 0.f, 0.f };
+
+	for( auto const& p : aMeshData.positions )
+		ret.bounds = expand( ret.bounds, p );
+
+	if( !aMeshData.colors.empty() )
+	{
+		for( auto const& c : aMeshData.colors )
+			ret.color += c;
+		ret.color /= float(aMeshData.colors.size());
+	}
+
+	ret.samples.assign( std::size_t(aWidth) * aHeight, Vec3f{ ret.bounds.min.y, 0.f, 0.f } );
+
+	if( aMeshData.positions.empty() )
+		return ret;
+
+	float const sizeX = ret.bounds.max.x - ret.bounds.min.x;
+	float const sizeZ = ret.bounds.max.z - ret.bounds.min.z;
+	float const stepX = sizeX / float(aWidth-1);
+	float const stepZ = sizeZ / float(aHeight-1);
+	if( stepX <= 0.f || stepZ <= 0.f )
+		return ret; // Degenerate mesh (a line or a point in XZ)
+
+	bool const hasTexCoords = aMeshData.texCoords.size() == aMeshData.positions.size();
+
+	for( std::size_t t = 0; t < aMeshData.positions.size(); t += 3 )
+	{
+		auto const& p0 = aMeshData.positions[t+0];
+		auto const& p1 = aMeshData.positions[t+1];
+		auto const& p2 = aMeshData.positions[t+2];
+
+		// Barycentric coordinates in the XZ plane; skip triangles that are
+		// seen edge-on from above.
+		float const det = (p1.x - p0.x) * (p2.z - p0.z) - (p2.x - p0.x) * (p1.z - p0.z);
+		if( std::abs( det ) < 1e-12f )
+			continue;
+
+		float const minX = std::min( { p0.x, p1.x, p2.x } ), maxX = std::max( { p0.x, p1.x, p2.x } );
+		float const minZ = std::min( { p0.z, p1.z, p2.z } ), maxZ = std::max( { p0.z, p1.z, p2.z } );
+
+		auto const i0 = unsigned(std::max( 0.f, std::ceil( (minX - ret.bounds.min.x) / stepX - kEdgeEpsilon_ ) ));
+		auto const i1 = unsigned(std::min( float(aWidth-1), std::floor( (maxX - ret.bounds.min.x) / stepX + kEdgeEpsilon_ ) ));
+		auto const j0 = unsigned(std::max( 0.f, std::ceil( (minZ - ret.bounds.min.z) / stepZ - kEdgeEpsilon_ ) ));
+		auto const j1 = unsigned(std::min( float(aHeight-1), std::floor( (maxZ - ret.bounds.min.z) / stepZ + kEdgeEpsilon_ ) ));
+
+		for( unsigned j = j0; j <= j1; ++j )
+		{
+			// The last row and column land exactly on the bounds
+			float const z = ret.bounds.min.z + sizeZ * float(j) / float(aHeight-1);
+			for( unsigned i = i0; i <= i1; ++i )
+			{
+				float const x = ret.bounds.min.x + sizeX * float(i) / float(aWidth-1);
+
+				float const b1 = ((x - p0.x) * (p2.z - p0.z) - (p2.x - p0.x) * (z - p0.z)) / det;
+				float const b2 = ((p1.x - p0.x) * (z - p0.z) - (x - p0.x) * (p1.z - p0.z)) / det;
+				float const b0 = 1.f - b1 - b2;
+				if( b0 < -kEdgeEpsilon_ || b1 < -kEdgeEpsilon_ || b2 < -kEdgeEpsilon_ )
+					continue;
+
+				auto& sample = ret.samples[std::size_t(j) * aWidth + i];
+				sample.x = b0 * p0.y + b1 * p1.y + b2 * p2.y;
+
+				if( hasTexCoords )
+				{
+					auto const& t0 = aMeshData.texCoords[t+0];
+					auto const& t1 = aMeshData.texCoords[t+1];
+					auto const& t2 = aMeshData.texCoords[t+2];
+					sample.y = b0 * t0.x + b1 * t1.x + b2 * t2.x;
+					sample.z = b0 * t0.y + b1 * t1.y + b2 * t2.y;
+				}
+			}
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,36 @@
+#ifndef TERRAIN_HEIGHTMAP_HPP_2E71C5B4_8F09_4D3A_B6E2_93A0D47F1C58
+#define TERRAIN_HEIGHTMAP_HPP_2E71C5B4_8F09_4D3A_B6E2_93A0D47F1C58
+
+#include <vector>
+
+#include "../vmlib/aabb.hpp"
+#include "../vmlib/vec3.hpp"
+
+#include "simple_mesh.hpp"
+
+struct TerrainHeightmap
+{
+	unsigned width, height; // Samples along x and z
+
+	AABB bounds;
+	Vec3f color; // Average vertex color
+
+	// (height, u, v) per sample, row by row along x. Sample (i, j) lies at
+	// x = min.x + i * (max.x - min.x) / (width-1), and likewise for z.
+	std::vector<Vec3f> samples;
+};
+
+/* Resamples a heightfield-like mesh into a regular grid of aWidth by aHeight
+ * samples spanning the mesh's XZ bounds
+ *
+ * Each sample takes the height and texture coordinates of the triangle that
+ * covers it, interpolated linearly. Samples that no triangle covers get the
+ * lowest height of the mesh and the texture coordinates (0, 0).
+ */
+TerrainHeightmap make_terrain_heightmap(
+	SimpleMeshData const&,
+	unsigned aWidth,
+	unsigned aHeight
+);
+
+#endif // TERRAIN_HEIGHTMAP_HPP_2E71C5B4_8F09_4D3A_B6E2_93A0D47F1C58
@@ -0,0 +1,283 @@
+#include "terrain_streamer.hpp"
+
+#include <utility>
+#include <algorithm>
+
+#include <cassert>
+
+#include "../support/error.hpp"
+#include "../support/checkpoint.hpp"
+
+#include "uniform_blocks.hpp"
+
+namespace
+{
+	void allocate_( GLenum aTarget, GLuint aBuffer, std::size_t aSize )
+	{
+		glBindBuffer( aTarget, aBuffer );
+
+		// Slots are rewritten with glBufferSubData() as tiles stream in.
+		if( GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage )
+			glBufferStorage( aTarget, GLsizeiptr(aSize), nullptr, GL_DYNAMIC_STORAGE_BIT );
+		else
+			glBufferData( aTarget, GLsizeiptr(aSize), nullptr, GL_DYNAMIC_DRAW );
+	}
+}
+
+TerrainStreamer::TerrainStreamer( TerrainTiles const& aTiles, std::size_t aSlotCount, std::uint32_t aDrawFlags )
+	: mTiles( &aTiles )
+	, mVao( 0 )
+	, mDepthVao( 0 )
+	, mVertexBuffer( 0 )
+	, mIndexBuffer( 0 )
+	, mSlotVertices( 0 )
+	, mSlotIndices( 0 )
+	, mDrawFlags( aDrawFlags )
+	, mSlotTile( aSlotCount, kNone_ )
+	, mTileSlot( aTiles.tiles.size(), kNone_ )
+{
+	assert( aSlotCount > 0 );
+
+	for( auto const& tile : aTiles.tiles )
+	{
+		std::size_t vertices = 0, indices = 0;
+		for( auto const& lod : tile.lods )
+		{
+			vertices += lod.vertices.size();
+			indices += lod.indices.size();
+		}
+
+		mSlotVertices = std::max( mSlotVertices, vertices );
+		mSlotIndices = std::max( mSlotIndices, indices );
+	}
+
+	if( mSlotVertices * aSlotCount > 0xffffffffu || mSlotIndices * aSlotCount > 0xffffffffu )
+		throw Error( "TerrainStreamer: %zu slots of %zu vertices / %zu indices exceed 32-bit indexing", aSlotCount, mSlotVertices, mSlotIndices );
+
+	glGenVertexArrays( 1, &mVao );
+	glGenBuffers( 1, &mVertexBuffer );
+	glGenBuffers( 1, &mIndexBuffer );
+
+	glBindVertexArray( mVao );
+
+	allocate_( GL_ARRAY_BUFFER, mVertexBuffer, std::max<std::size_t>( 1, mSlotVertices * aSlotCount ) * sizeof(InterleavedVertex) );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	allocate_( GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer, std::max<std::size_t>( 1, mSlotIndices * aSlotCount ) * sizeof(GLuint) );
+
+	set_interleaved_vertex_format( 0 );
+	glBindVertexBuffer( 0, mVertexBuffer, 0, sizeof(InterleavedVertex) );
+
+	// Position-only VAO for the depth pre-pass
+	glGenVertexArrays( 1, &mDepthVao );
+	glBindVertexArray( mDepthVao );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer );
+	set_interleaved_position_format( 0 );
+	glBindVertexBuffer( 0, mVertexBuffer, 0, sizeof(InterleavedVertex) );
+
+	glBindVertexArray( 0 );
+
+	mDraws.attach( mVao );
+	mDraws.attach( mDepthVao );
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+	GLuint const vaos[] = { mVao, mDepthVao };
+	glDeleteVertexArrays( 2, vaos ); // Zeros are silently ignored
+
+	GLuint const buffers[] = { mVertexBuffer, mIndexBuffer };
+	glDeleteBuffers( 2, buffers ); // Zeros are silently ignored
+}
+
+TerrainStreamer::TerrainStreamer( TerrainStreamer&& aOther ) noexcept
+	: mTiles( aOther.mTiles )
+	, mVao( std::exchange( aOther.mVao, 0 ) )
+	, mDepthVao( std::exchange( aOther.mDepthVao, 0 ) )
+	, mVertexBuffer( std::exchange( aOther.mVertexBuffer, 0 ) )
+	, mIndexBuffer( std::exchange( aOther.mIndexBuffer, 0 ) )
+	, mSlotVertices( aOther.mSlotVertices )
+	, mSlotIndices( aOther.mSlotIndices )
+	, mDrawFlags( aOther.mDrawFlags )
+	, mSlotTile( std::move(aOther.mSlotTile) )
+	, mTileSlot( std::move(aOther.mTileSlot) )
+	, mCandidates( std::move(aOther.mCandidates) )
+	, mDraws( std::move(aOther.mDraws) )
+{}
+TerrainStreamer& TerrainStreamer::operator= (TerrainStreamer&& aOther) noexcept
+{
+	std::swap( mTiles, aOther.mTiles );
+	std::swap( mVao, aOther.mVao );
+	std::swap( mDepthVao, aOther.mDepthVao );
+	std::swap( mVertexBuffer, aOther.mVertexBuffer );
+	std::swap( mIndexBuffer, aOther.mIndexBuffer );
+	std::swap( mSlotVertices, aOther.mSlotVertices );
+	std::swap( mSlotIndices, aOther.mSlotIndices );
+	std::swap( mDrawFlags, aOther.mDrawFlags );
+	std::swap( mSlotTile, aOther.mSlotTile );
+	std::swap( mTileSlot, aOther.mTileSlot );
+	std::swap( mCandidates, aOther.mCandidates );
+	std::swap( mDraws, aOther.mDraws );
+	return *this;
+}
+
+std::size_t TerrainStreamer::stream( Vec3f aCameraPosition, float aRadius, std::size_t aMaxUploads )
+{
+	auto const& tiles = mTiles->tiles;
+
+	// Missing tiles within the radius, nearest first
+	mCandidates.clear();
+	for( std::size_t i = 0; i < tiles.size(); ++i )
+	{
+		if( kNone_ != mTileSlot[i] || tiles[i].lods[0].indices.empty() )
+			continue;
+
+		if( distance( tiles[i].bounds, aCameraPosition ) <= aRadius )
+			mCandidates.emplace_back( i );
+	}
+
+	if( mCandidates.empty() )
+		return 0;
+
+	std::sort( mCandidates.begin(), mCandidates.end(), [&] (std::size_t aX, std::size_t aY) {
+		return distance( tiles[aX].bounds, aCameraPosition ) < distance( tiles[aY].bounds, aCameraPosition );
+	} );
+
+	std::size_t uploads = 0;
+	for( auto const tile : mCandidates )
+	{
+		if( uploads >= aMaxUploads )
+			break;
+
+		// Use a free slot if there is one. Otherwise evict the resident tile
+		// furthest from the camera, unless it is needed as well.
+		std::size_t slot = kNone_;
+		float furthest = aRadius;
+
+		for( std::size_t s = 0; s < mSlotTile.size(); ++s )
+		{
+			if( kNone_ == mSlotTile[s] )
+			{
+				slot = s;
+				break;
+			}
+
+			float const d = distance( tiles[mSlotTile[s]].bounds, aCameraPosition );
+			if( d > furthest )
+			{
+				furthest = d;
+				slot = s;
+			}
+		}
+
+		if( kNone_ == slot )
+			break; // Pool is full of tiles that are all needed
+
+		if( kNone_ != mSlotTile[slot] )
+			mTileSlot[mSlotTile[slot]] = kNone_;
+
+		upload_( tile, slot );
+		++uploads;
+	}
+
+	OGL_CHECKPOINT_DEBUG();
+
+	return uploads;
+}
+
+TerrainStreamer::Stats TerrainStreamer::cull( Frustum const& aFrustum, Vec3f aCameraPosition, HiZBuffer const* aOcclusion )
+{
+	auto const& tiles = mTiles->tiles;
+
+	Stats stats{ 0, 0, 0, 0 };
+	mDraws.clear();
+
+	for( std::size_t slot = 0; slot < mSlotTile.size(); ++slot )
+	{
+		auto const index = mSlotTile[slot];
+		if( kNone_ == index )
+			continue;
+
+		++stats.resident;
+
+		auto const& tile = tiles[index];
+		if( FrustumTest::outside == test( aFrustum, tile.bounds ) )
+		{
+			++stats.culled;
+			continue;
+		}
+
+		if( aOcclusion && aOcclusion->occluded( tile.bounds ) )
+		{
+			++stats.occluded;
+			continue;
+		}
+
+		++stats.visible;
+
+		// Detail levels are stored back to back in the slot.
+		auto const level = select_terrain_lod( tile, aCameraPosition );
+
+		std::size_t baseVertex = slot * mSlotVertices;
+		std::size_t firstIndex = slot * mSlotIndices;
+		for( std::size_t i = 0; i < level; ++i )
+		{
+			baseVertex += tile.lods[i].vertices.size();
+			firstIndex += tile.lods[i].indices.size();
+		}
+
+		auto const& lod = tile.lods[level];
+		mDraws.add( GLuint(lod.indices.size()), GLuint(firstIndex), GLint(baseVertex), kIdentity44f, mDrawFlags );
+	}
+
+	return stats;
+}
+
+RenderPacket TerrainStreamer::make_packet( RingBuffer& aRing, GLuint aProgram, GLuint aTexture )
+{
+	return mDraws.make_packet( aRing, aProgram, aTexture );
+}
+
+GLuint TerrainStreamer::vao() const noexcept
+{
+	return mVao;
+}
+GLuint TerrainStreamer::depth_vao() const noexcept
+{
+	return mDepthVao;
+}
+std::size_t TerrainStreamer::draw_count() const noexcept
+{
+	return mDraws.size();
+}
+
+void TerrainStreamer::upload_( std::size_t aTile, std::size_t aSlot )
+{
+	auto const& tile = mTiles->tiles[aTile];
+
+	auto vertexOffset = aSlot * mSlotVertices * sizeof(InterleavedVertex);
+	auto indexOffset = aSlot * mSlotIndices * sizeof(GLuint);
+
+	glBindBuffer( GL_COPY_WRITE_BUFFER, mVertexBuffer );
+	for( auto const& lod : tile.lods )
+	{
+		auto const bytes = lod.vertices.size() * sizeof(InterleavedVertex);
+		glBufferSubData( GL_COPY_WRITE_BUFFER, GLintptr(vertexOffset), GLsizeiptr(bytes), lod.vertices.data() );
+		vertexOffset += bytes;
+	}
+
+	glBindBuffer( GL_COPY_WRITE_BUFFER, mIndexBuffer );
+	for( auto const& lod : tile.lods )
+	{
+		auto const bytes = lod.indices.size() * sizeof(GLuint);
+		glBufferSubData( GL_COPY_WRITE_BUFFER, GLintptr(indexOffset), GLsizeiptr(bytes), lod.indices.data() );
+		indexOffset += bytes;
+	}
+
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+	mSlotTile[aSlot] = aTile;
+	mTileSlot[aTile] = aSlot;
+}
@@ -0,0 +1,98 @@
+#ifndef TERRAIN_STREAMER_HPP_B83E0D15_4C6A_4F92_A7D1_2E95F6C8B047
+#define TERRAIN_STREAMER_HPP_B83E0D15_4C6A_4F92_A7D1_2E95F6C8B047
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/aabb.hpp"
+#include "../vmlib/vec3.hpp"
+
+#include "../support/ring_buffer.hpp"
+
+#include "hiz.hpp"
+#include "multi_draw.hpp"
+#include "render_queue.hpp"
+#include "terrain_tiles.hpp"
+
+/* GPU residency and drawing of terrain tiles
+ *
+ * The GPU holds a fixed pool of slots, each large enough for all detail
+ * levels of the largest tile. stream() makes the tiles within a radius of the
+ * camera resident (nearest first, a limited number per call). When the pool
+ * is full, the resident tile furthest from the camera is evicted, provided it
+ * is outside the radius. Terrains much larger than the pool can therefore be
+ * rendered, as long as the pool covers the visible area.
+ *
+ * cull() tests each resident tile against the view frustum, selects its
+ * detail level and queues one draw per visible tile. make_packet() then draws
+ * all of them with a single glMultiDrawElementsIndirect() (batched.vert).
+ * depth_vao() only fetches the positions, for a depth pre-pass. If given a
+ * HiZBuffer, cull() also drops tiles that it reports as occluded.
+ *
+ * All tile draws use aDrawFlags (DrawData::flags, e.g.,
+ * kObjectFlagApplyLighting). The TerrainTiles must outlive the streamer.
+ */
+class TerrainStreamer final
+{
+	public:
+		struct Stats
+		{
+			std::size_t visible;
+			std::size_t culled;
+			std::size_t occluded;
+			std::size_t resident;
+		};
+
+	public:
+		TerrainStreamer( TerrainTiles const&, std::size_t aSlotCount, std::uint32_t aDrawFlags = 0 );
+		~TerrainStreamer();
+
+		TerrainStreamer( TerrainStreamer const& ) = delete;
+		TerrainStreamer& operator= (TerrainStreamer const&) = delete;
+
+		TerrainStreamer( TerrainStreamer&& ) noexcept;
+		TerrainStreamer& operator= (TerrainStreamer&&) noexcept;
+
+	public:
+		// Returns the number of tiles uploaded.
+		std::size_t stream( Vec3f aCameraPosition, float aRadius, std::size_t aMaxUploads );
+
+		Stats cull( Frustum const&, Vec3f aCameraPosition, HiZBuffer const* aOcclusion = nullptr );
+
+		RenderPacket make_packet( RingBuffer&, GLuint aProgram, GLuint aTexture );
+
+		GLuint vao() const noexcept;
+		GLuint depth_vao() const noexcept;
+		std::size_t draw_count() const noexcept;
+
+	private:
+		static constexpr std::size_t kNone_ = ~std::size_t(0);
+
+		void upload_( std::size_t aTile, std::size_t aSlot );
+
+	private:
+		TerrainTiles const* mTiles;
+
+		GLuint mVao;
+		GLuint mDepthVao;
+		GLuint mVertexBuffer;
+		GLuint mIndexBuffer;
+
+		std::size_t mSlotVertices;
+		std::size_t mSlotIndices;
+
+		std::uint32_t mDrawFlags;
+
+		std::vector<std::size_t> mSlotTile; // Tile in each slot, or kNone_
+		std::vector<std::size_t> mTileSlot; // Slot of each tile, or kNone_
+
+		std::vector<std::size_t> mCandidates; // Scratch space for stream()
+
+		MultiDrawList mDraws;
+};
+
+#endif // TERRAIN_STREAMER_HPP_B83E0D15_4C6A_4F92_A7D1_2E95F6C8B047
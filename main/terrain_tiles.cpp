@@ -0,0 +1,235 @@
+#include "terrain_tiles.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include <cmath>
+#include <cassert>
+#include <cstring>
+
+#include "multi_draw.hpp"
+
+#include "../support/hash.hpp"
+
+namespace
+{
+	// Clustering grid resolution (cells per tile side) for each detail level.
+	// Level 0 is not clustered.
+	constexpr unsigned kClusterCells_[kTerrainLodCount] = { 0, 12, 6 };
+
+	// Distance (in tile sizes) up to which each level is used.
+	constexpr float kLodDistance_[kTerrainLodCount-1] = { 2.f, 5.f };
+
+	// Shared vertices have bitwise identical positions (they come from the
+	// same OBJ vertex), so positions are compared exactly.
+	struct PositionHash_
+	{
+		std::size_t operator()( Vec3f const& aPosition ) const noexcept
+		{
+			return std::size_t(hash_bytes( &aPosition, sizeof(Vec3f) ));
+		}
+	};
+	struct PositionEqual_
+	{
+		bool operator()( Vec3f const& aX, Vec3f const& aY ) const noexcept
+		{
+			return 0 == std::memcmp( &aX, &aY, sizeof(Vec3f) );
+		}
+	};
+
+	// Owner tile of each position, or kShared_ if used by several tiles
+	using OwnerMap_ = std::unordered_map<Vec3f, std::size_t, PositionHash_, PositionEqual_>;
+	constexpr std::size_t kShared_ = ~std::size_t(0);
+
+	void append_triangle_( SimpleMeshData& aTile, SimpleMeshData const& aSource, std::size_t aFirst )
+	{
+		for( std::size_t i = aFirst; i < aFirst+3; ++i )
+		{
+			aTile.positions.emplace_back( aSource.positions[i] );
+
+			if( i < aSource.colors.size() )
+				aTile.colors.emplace_back( aSource.colors[i] );
+			if( i < aSource.normals.size() )
+				aTile.normals.emplace_back( aSource.normals[i] );
+			if( i < aSource.texCoords.size() )
+				aTile.texCoords.emplace_back( aSource.texCoords[i] );
+		}
+	}
+
+	TerrainTileLod cluster_( SimpleMeshData const& aTile, AABB const& aBounds, unsigned aCells, OwnerMap_ const& aOwners )
+	{
+		TerrainTileLod lod;
+
+		auto const count = aTile.positions.size();
+		if( 0 == count )
+			return lod;
+
+		float const sizeX = std::max( aBounds.max.x - aBounds.min.x, 1e-6f );
+		float const sizeZ = std::max( aBounds.max.z - aBounds.min.z, 1e-6f );
+
+		auto const cell_of = [&]( Vec3f const& aPosition )
+		{
+			auto const cx = std::min( unsigned(std::max( 0.f, (aPosition.x - aBounds.min.x) / sizeX * float(aCells) )), aCells-1 );
+			auto const cz = std::min( unsigned(std::max( 0.f, (aPosition.z - aBounds.min.z) / sizeZ * float(aCells) )), aCells-1 );
+			return cz * aCells + cx;
+		};
+
+		// Output vertex of each cell and of each locked position. Cell
+		// vertices accumulate the attributes of their members and are
+		// averaged at the end; locked vertices are copied as-is.
+		std::vector<GLuint> cellVertex( std::size_t(aCells) * aCells, ~GLuint(0) );
+		std::unordered_map<Vec3f, GLuint, PositionHash_, PositionEqual_> lockedVertex;
+		std::vector<unsigned> memberCount;
+
+		std::vector<GLuint> corners( count );
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			auto const vertex = interleaved_vertex( aTile, i );
+
+			auto const owner = aOwners.find( vertex.position );
+			assert( aOwners.end() != owner );
+
+			if( kShared_ == owner->second )
+			{
+				auto const [it, inserted] = lockedVertex.emplace( vertex.position, GLuint(lod.vertices.size()) );
+				if( inserted )
+				{
+					lod.vertices.emplace_back( vertex );
+					memberCount.emplace_back( 0 );
+				}
+
+				corners[i] = it->second;
+				continue;
+			}
+
+			auto& index = cellVertex[cell_of( vertex.position )];
+			if( ~GLuint(0) == index )
+			{
+				index = GLuint(lod.vertices.size());
+				lod.vertices.emplace_back( InterleavedVertex{} );
+				memberCount.emplace_back( 0 );
+			}
+
+			auto& sum = lod.vertices[index];
+			sum.position += vertex.position;
+			sum.color += vertex.color;
+			sum.normal += vertex.normal;
+			sum.texCoord += vertex.texCoord;
+			++memberCount[index];
+
+			corners[i] = index;
+		}
+
+		for( std::size_t i = 0; i < lod.vertices.size(); ++i )
+		{
+			if( 0 == memberCount[i] )
+				continue;
+
+			auto& vertex = lod.vertices[i];
+			float const inv = 1.f / float(memberCount[i]);
+
+			vertex.position = vertex.position * inv;
+			vertex.color = vertex.color * inv;
+			vertex.texCoord = vertex.texCoord * inv;
+
+			if( float const len = length( vertex.normal ); len > 0.f )
+				vertex.normal = vertex.normal / len;
+		}
+
+		// Triangles whose corners collapsed into the same vertex vanish.
+		for( std::size_t i = 0; i < count; i += 3 )
+		{
+			auto const a = corners[i], b = corners[i+1], c = corners[i+2];
+			if( a == b || b == c || a == c )
+				continue;
+
+			lod.indices.insert( lod.indices.end(), { a, b, c } );
+		}
+
+		return lod;
+	}
+}
+
+TerrainTiles make_terrain_tiles( SimpleMeshData const& aMeshData, unsigned aTilesX, unsigned aTilesZ )
+{
+	assert( aTilesX > 0 && aTilesZ > 0 );
+	assert( aMeshData.positions.size() % 3 == 0 );
+
+	TerrainTiles ret{};
+	ret.tilesX = aTilesX;
+	ret.tilesZ = aTilesZ;
+	ret.bounds = kEmptyAABB;
+
+	for( auto const& position : aMeshData.positions )
+		ret.bounds = expand( ret.bounds, position );
+
+	float const sizeX = std::max( ret.bounds.max.x - ret.bounds.min.x, 1e-6f );
+	float const sizeZ = std::max( ret.bounds.max.z - ret.bounds.min.z, 1e-6f );
+
+	// Assign triangles to tiles and record which positions are shared
+	auto const tileCount = std::size_t(aTilesX) * aTilesZ;
+	std::vector<SimpleMeshData> soups( tileCount );
+
+	OwnerMap_ owners;
+	owners.reserve( aMeshData.positions.size() / 2 );
+
+	for( std::size_t i = 0; i < aMeshData.positions.size(); i += 3 )
+	{
+		auto const& p0 = aMeshData.positions[i];
+		auto const& p1 = aMeshData.positions[i+1];
+		auto const& p2 = aMeshData.positions[i+2];
+
+		float const cx = (p0.x + p1.x + p2.x) / 3.f;
+		float const cz = (p0.z + p1.z + p2.z) / 3.f;
+
+		auto const tx = std::min( unsigned(std::max( 0.f, (cx - ret.bounds.min.x) / sizeX * float(aTilesX) )), aTilesX-1 );
+		auto const tz = std::min( unsigned(std::max( 0.f, (cz - ret.bounds.min.z) / sizeZ * float(aTilesZ) )), aTilesZ-1 );
+		auto const tile = std::size_t(tz) * aTilesX + tx;
+
+		append_triangle_( soups[tile], aMeshData, i );
+
+		for( auto const* p : { &p0, &p1, &p2 } )
+		{
+			auto const [it, inserted] = owners.emplace( *p, tile );
+			if( !inserted && it->second != tile )
+				it->second = kShared_;
+		}
+	}
+
+	// Build the detail levels of each tile
+	ret.tiles.resize( tileCount );
+	for( std::size_t i = 0; i < tileCount; ++i )
+	{
+		auto& tile = ret.tiles[i];
+		auto const& soup = soups[i];
+
+		tile.x = unsigned(i % aTilesX);
+		tile.z = unsigned(i / aTilesX);
+		tile.bounds = kEmptyAABB;
+
+		for( auto const& position : soup.positions )
+			tile.bounds = expand( tile.bounds, position );
+
+		weld_vertices( soup, tile.lods[0].vertices, tile.lods[0].indices );
+
+		for( std::size_t level = 1; level < kTerrainLodCount; ++level )
+			tile.lods[level] = cluster_( soup, tile.bounds, kClusterCells_[level], owners );
+	}
+
+	return ret;
+}
+
+std::size_t select_terrain_lod( TerrainTile const& aTile, Vec3f aCameraPosition ) noexcept
+{
+	if( is_empty( aTile.bounds ) )
+		return 0;
+
+	float const tileSize = std::max( aTile.bounds.max.x - aTile.bounds.min.x, aTile.bounds.max.z - aTile.bounds.min.z );
+	float const relative = distance( aTile.bounds, aCameraPosition ) / std::max( tileSize, 1e-6f );
+
+	std::size_t level = 0;
+	while( level < kTerrainLodCount-1 && relative > kLodDistance_[level] )
+		++level;
+
+	return level;
+}
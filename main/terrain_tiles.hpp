@@ -0,0 +1,64 @@
+#ifndef TERRAIN_TILES_HPP_47D0A2C8_93E1_4B6F_8E25_1F6C0B9D3A72
+#define TERRAIN_TILES_HPP_47D0A2C8_93E1_4B6F_8E25_1F6C0B9D3A72
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+
+#include "../vmlib/aabb.hpp"
+#include "../vmlib/vec3.hpp"
+
+#include "gpu_mesh.hpp"
+#include "simple_mesh.hpp"
+
+// Number of detail levels per tile. Level 0 is the original geometry.
+constexpr std::size_t kTerrainLodCount = 3;
+
+struct TerrainTileLod
+{
+	std::vector<InterleavedVertex> vertices;
+	std::vector<GLuint> indices; // Relative to the first vertex
+};
+
+struct TerrainTile
+{
+	unsigned x, z; // Position in the tile grid
+
+	AABB bounds;
+	TerrainTileLod lods[kTerrainLodCount];
+};
+
+struct TerrainTiles
+{
+	unsigned tilesX, tilesZ;
+
+	AABB bounds;
+	std::vector<TerrainTile> tiles; // tilesX * tilesZ, row by row along x
+};
+
+/* Splits a heightfield-like mesh into a tilesX by tilesZ grid of tiles
+ *
+ * Triangles are assigned to tiles by their centroid in the XZ plane. They are
+ * never split, so neighbouring tiles share the vertices along their common
+ * edge exactly. Empty tiles are kept (with empty geometry) so that the grid
+ * stays addressable by (x, z).
+ *
+ * Detail levels 1 and up are built by vertex clustering on a regular XZ grid
+ * that gets coarser with each level. Vertices that are shared with another
+ * tile are locked (never clustered). The edges between tiles are therefore
+ * identical at all detail levels, and neighbouring tiles can use different
+ * levels without cracks.
+ */
+TerrainTiles make_terrain_tiles(
+	SimpleMeshData const&,
+	unsigned aTilesX,
+	unsigned aTilesZ
+);
+
+// Selects the detail level for a tile, based on the distance between the
+// camera and the tile's bounds, relative to the tile size.
+std::size_t select_terrain_lod( TerrainTile const&, Vec3f aCameraPosition ) noexcept;
+
+#endif // TERRAIN_TILES_HPP_47D0A2C8_93E1_4B6F_8E25_1F6C0B9D3A72
@@ -0,0 +1,171 @@
+#include "tessellated_terrain.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <cassert>
+
+#include "../support/checkpoint.hpp"
+
+namespace
+{
+	// Upper bound on the tessellation level of an edge. GL guarantees at
+	// least 64 (GL_MAX_TESS_GEN_LEVEL).
+	constexpr GLint kMaxTessLevel_ = 64;
+}
+
+TessellatedTerrain::TessellatedTerrain( TerrainHeightmap const& aHeightmap, unsigned aPatchesPerSide, std::uint32_t aDrawFlags )
+	: mVao( 0 )
+	, mVertexBuffer( 0 )
+	, mHeightmap( 0 )
+	, mPatchCount( std::size_t(aPatchesPerSide) * aPatchesPerSide )
+	, mUniforms{}
+{
+	assert( aPatchesPerSide > 0 );
+	assert( aHeightmap.width > 1 && aHeightmap.height > 1 );
+	assert( aHeightmap.samples.size() == std::size_t(aHeightmap.width) * aHeightmap.height );
+
+	// Four corners per patch, in grid units: (i,j), (i+1,j), (i+1,j+1),
+	// (i,j+1). terrain.tesc relies on this order.
+	std::vector<float> corners;
+	corners.reserve( mPatchCount * 4 * 2 );
+	for( unsigned j = 0; j < aPatchesPerSide; ++j )
+	{
+		for( unsigned i = 0; i < aPatchesPerSide; ++i )
+		{
+			float const x0 = float(i), x1 = float(i+1);
+			float const z0 = float(j), z1 = float(j+1);
+			corners.insert( corners.end(), { x0, z0, x1, z0, x1, z1, x0, z1 } );
+		}
+	}
+
+	auto const cornerBytes = GLsizeiptr(corners.size() * sizeof(float));
+
+	glGenBuffers( 1, &mVertexBuffer );
+	glBindBuffer( GL_ARRAY_BUFFER, mVertexBuffer );
+	if( GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage )
+		glBufferStorage( GL_ARRAY_BUFFER, cornerBytes, corners.data(), 0 );
+	else
+		glBufferData( GL_ARRAY_BUFFER, cornerBytes, corners.data(), GL_STATIC_DRAW );
+
+	glGenVertexArrays( 1, &mVao );
+	glBindVertexArray( mVao );
+	glEnableVertexAttribArray( 0 );
+	glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr );
+	glBindVertexArray( 0 );
+
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	// Heightmap: (height, u, v) per texel, filtered linearly. Sample (i, j)
+	// sits at the centre of texel (i, j).
+	glGenTextures( 1, &mHeightmap );
+	glBindTexture( GL_TEXTURE_2D, mHeightmap );
+	glTexStorage2D( GL_TEXTURE_2D, 1, GL_RGB32F, GLsizei(aHeightmap.width), GLsizei(aHeightmap.height) );
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+	glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, GLsizei(aHeightmap.width), GLsizei(aHeightmap.height), GL_RGB, GL_FLOAT, aHeightmap.samples.data() );
+
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+	glBindTexture( GL_TEXTURE_2D, 0 );
+
+	// Fixed part of the uniform block
+	auto const& bounds = aHeightmap.bounds;
+	float const sizeX = bounds.max.x - bounds.min.x;
+	float const sizeZ = bounds.max.z - bounds.min.z;
+	float const w = float(aHeightmap.width), h = float(aHeightmap.height);
+
+	mUniforms.heightmapTransform = Vec4f{
+		(w - 1.f) / (sizeX * w),
+		(h - 1.f) / (sizeZ * h),
+		(0.5f - bounds.min.x * (w - 1.f) / sizeX) / w,
+		(0.5f - bounds.min.z * (h - 1.f) / sizeZ) / h
+	};
+	mUniforms.grid = Vec4f{ bounds.min.x, bounds.min.z, sizeX / float(aPatchesPerSide), sizeZ / float(aPatchesPerSide) };
+	mUniforms.color = Vec4f{ aHeightmap.color.x, aHeightmap.color.y, aHeightmap.color.z, 1.f };
+	mUniforms.heightRange[0] = bounds.min.y;
+	mUniforms.heightRange[1] = bounds.max.y;
+
+	// Splitting an edge finer than the heightmap's texels adds vertices but
+	// no detail
+	GLint maxLevel = 0;
+	glGetIntegerv( GL_MAX_TESS_GEN_LEVEL, &maxLevel );
+
+	auto const texelsPerPatch = (std::max( aHeightmap.width, aHeightmap.height ) - 1 + aPatchesPerSide - 1) / aPatchesPerSide;
+	mUniforms.maxTessLevel = float(std::min( { maxLevel, kMaxTessLevel_, GLint(std::max( texelsPerPatch, 1u )) } ));
+	mUniforms.flags = aDrawFlags;
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+TessellatedTerrain::~TessellatedTerrain()
+{
+	glDeleteVertexArrays( 1, &mVao );
+	glDeleteBuffers( 1, &mVertexBuffer );
+	glDeleteTextures( 1, &mHeightmap );
+}
+
+TessellatedTerrain::TessellatedTerrain( TessellatedTerrain&& aOther ) noexcept
+	: mVao( std::exchange( aOther.mVao, 0 ) )
+	, mVertexBuffer( std::exchange( aOther.mVertexBuffer, 0 ) )
+	, mHeightmap( std::exchange( aOther.mHeightmap, 0 ) )
+	, mPatchCount( std::exchange( aOther.mPatchCount, 0 ) )
+	, mUniforms( aOther.mUniforms )
+{}
+TessellatedTerrain& TessellatedTerrain::operator= (TessellatedTerrain&& aOther) noexcept
+{
+	std::swap( mVao, aOther.mVao );
+	std::swap( mVertexBuffer, aOther.mVertexBuffer );
+	std::swap( mHeightmap, aOther.mHeightmap );
+	std::swap( mPatchCount, aOther.mPatchCount );
+	std::swap( mUniforms, aOther.mUniforms );
+	return *this;
+}
+
+RenderPacket TessellatedTerrain::make_packet( RingBuffer& aRing, GLuint aProgram, GLuint aTexture, float aWidth, float aHeight, float aPixelsPerEdge )
+{
+	assert( aPixelsPerEdge > 0.f );
+
+	TerrainUniforms uniforms = mUniforms;
+	uniforms.viewportSize[0] = aWidth;
+	uniforms.viewportSize[1] = aHeight;
+	uniforms.pixelsPerEdge = aPixelsPerEdge;
+
+	GLintptr offset = 0;
+	*aRing.allocate_as<TerrainUniforms>( aRing.uniform_alignment(), offset ) = uniforms;
+
+	// Not tracked by the RenderStateCache, which only touches the units it
+	// binds itself.
+	glActiveTexture( GL_TEXTURE0 + kTerrainHeightmapUnit );
+	glBindTexture( GL_TEXTURE_2D, mHeightmap );
+	glActiveTexture( GL_TEXTURE0 );
+
+	glPatchParameteri( GL_PATCH_VERTICES, 4 );
+
+	RenderPacket packet{};
+	packet.kind = RenderPacket::Kind::Arrays;
+	packet.mode = GL_PATCHES;
+	packet.program = aProgram;
+	packet.vertexArray = mVao;
+	packet.texture = aTexture;
+	packet.first = 0;
+	packet.count = GLsizei(mPatchCount * 4);
+	packet.dataTarget = GL_UNIFORM_BUFFER;
+	packet.dataBinding = kTerrainBlockBinding;
+	packet.dataBuffer = aRing.bufferId();
+	packet.dataOffset = offset;
+	packet.dataSize = sizeof(TerrainUniforms);
+	return packet;
+}
+
+GLuint TessellatedTerrain::vao() const noexcept
+{
+	return mVao;
+}
+std::size_t TessellatedTerrain::patch_count() const noexcept
+{
+	return mPatchCount;
+}
@@ -0,0 +1,68 @@
+#ifndef TESSELLATED_TERRAIN_HPP_7C4B2A91_E03D_4F68_95B1_D82A6E1F0C37
+#define TESSELLATED_TERRAIN_HPP_7C4B2A91_E03D_4F68_95B1_D82A6E1F0C37
+
+#include <glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../support/ring_buffer.hpp"
+
+#include "render_queue.hpp"
+#include "terrain_heightmap.hpp"
+#include "uniform_blocks.hpp"
+
+/* Terrain drawn with hardware tessellation
+ *
+ * The terrain is a coarse grid of aPatchesPerSide x aPatchesPerSide quad
+ * patches that only store their grid corners. The tessellation control
+ * shader (terrain.tesc) subdivides each patch edge according to its length
+ * on screen, so that tessellated edges are about pixelsPerEdge pixels long;
+ * the evaluation shader (terrain.tese) displaces the generated vertices with
+ * the heightmap, and derives their normals from it. Detail therefore follows
+ * the view rather than the resolution of the source mesh. Edges are never
+ * split finer than the heightmap's texels.
+ *
+ * The level of an edge only depends on the edge's end points, which are
+ * computed identically by both patches that share it, so neighbouring
+ * patches agree on it and no cracks appear. Patches outside of the view
+ * frustum get a level of zero and are discarded before tessellation.
+ *
+ * make_packet() writes the TerrainUniforms block into the ring buffer and
+ * returns a GL_PATCHES draw (terrain.vert, terrain.tesc and terrain.tese,
+ * with any of the fragment shaders that read the batched.vert outputs). It
+ * also binds the heightmap to kTerrainHeightmapUnit and sets
+ * GL_PATCH_VERTICES, which is global state. For a depth pre-pass, the same
+ * stages without a fragment shader can be used with vao().
+ */
+constexpr GLuint kTerrainHeightmapUnit = 3;
+
+class TessellatedTerrain final
+{
+	public:
+		TessellatedTerrain( TerrainHeightmap const&, unsigned aPatchesPerSide, std::uint32_t aDrawFlags = 0 );
+		~TessellatedTerrain();
+
+		TessellatedTerrain( TessellatedTerrain const& ) = delete;
+		TessellatedTerrain& operator= (TessellatedTerrain const&) = delete;
+
+		TessellatedTerrain( TessellatedTerrain&& ) noexcept;
+		TessellatedTerrain& operator= (TessellatedTerrain&&) noexcept;
+
+	public:
+		RenderPacket make_packet( RingBuffer&, GLuint aProgram, GLuint aTexture, float aWidth, float aHeight, float aPixelsPerEdge );
+
+		GLuint vao() const noexcept;
+		std::size_t patch_count() const noexcept;
+
+	private:
+		GLuint mVao;
+		GLuint mVertexBuffer;
+		GLuint mHeightmap;
+
+		std::size_t mPatchCount;
+
+		TerrainUniforms mUniforms; // All but viewportSize and pixelsPerEdge are fixed
+};
+
+#endif // TESSELLATED_TERRAIN_HPP_7C4B2A91_E03D_4F68_95B1_D82A6E1F0C37
@@ -0,0 +1,279 @@
+#include "text_renderer.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+#include <cstring>
+#include <cstdio>
+
+#define FONTSTASH_IMPLEMENTATION
+#include <fontstash.h>
+
+#include "../support/error.hpp"
+#include "../support/checkpoint.hpp"
+
+namespace
+{
+	// Initial atlas size; doubled (up to GL_MAX_TEXTURE_SIZE) when it is full
+	constexpr int kInitialAtlasSize_ = 512;
+
+	// Vertex attributes of text.vert
+	constexpr GLuint kAttribPosition_ = 0;
+	constexpr GLuint kAttribTexCoord_ = 1;
+	constexpr GLuint kAttribColor_ = 2;
+
+	constexpr GLuint kAtlasUnit_ = 0;
+}
+
+TextRenderer::TextRenderer( ShaderProgram& aProgram, char const* aFontPath, std::size_t aMaxQuadsPerFrame )
+	: mProgram( &aProgram )
+	, mViewportUniform( aProgram.uniform<Vec2f>( "viewportSize" ) )
+	, mVertexRing( GLsizeiptr(aMaxQuadsPerFrame * 6 * sizeof(Vertex_)) )
+	, mVao( 0 )
+	, mAtlas( 0 )
+	, mAtlasWidth( 0 )
+	, mAtlasHeight( 0 )
+	, mMaxAtlasSize( 0 )
+	, mFons( nullptr )
+	, mFont( FONS_INVALID )
+	, mMaxVertices( aMaxQuadsPerFrame * 6 )
+	, mDroppedQuads( 0 )
+{
+	assert( aFontPath );
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	glGetIntegerv( GL_MAX_TEXTURE_SIZE, &mMaxAtlasSize );
+
+	glGenVertexArrays( 1, &mVao );
+	glBindVertexArray( mVao );
+
+	glEnableVertexAttribArray( kAttribPosition_ );
+	glEnableVertexAttribArray( kAttribTexCoord_ );
+	glEnableVertexAttribArray( kAttribColor_ );
+
+	glVertexAttribFormat( kAttribPosition_, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex_, x) );
+	glVertexAttribFormat( kAttribTexCoord_, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex_, s) );
+	glVertexAttribFormat( kAttribColor_, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(Vertex_, color) );
+
+	for( auto const attrib : { kAttribPosition_, kAttribTexCoord_, kAttribColor_ } )
+		glVertexAttribBinding( attrib, 0 );
+
+	glBindVertexArray( 0 );
+
+	// fontstash creates the atlas texture through fons_create_()
+	FONSparams params{};
+	params.width = kInitialAtlasSize_;
+	params.height = kInitialAtlasSize_;
+	params.flags = FONS_ZERO_TOPLEFT;
+	params.userPtr = this;
+	params.renderCreate = &TextRenderer::fons_create_;
+	params.renderResize = &TextRenderer::fons_resize_;
+	params.renderUpdate = &TextRenderer::fons_update_;
+	params.renderDraw = &TextRenderer::fons_draw_;
+
+	mFons = fonsCreateInternal( &params );
+	if( !mFons )
+	{
+		glDeleteVertexArrays( 1, &mVao );
+		glDeleteTextures( 1, &mAtlas );
+		throw Error( "TextRenderer: fonsCreateInternal() failed" );
+	}
+
+	fonsSetErrorCallback( mFons, &TextRenderer::fons_error_, this );
+
+	mFont = fonsAddFont( mFons, "hud", aFontPath );
+	if( FONS_INVALID == mFont )
+	{
+		fonsDeleteInternal( mFons );
+		glDeleteVertexArrays( 1, &mVao );
+		glDeleteTextures( 1, &mAtlas );
+		throw Error( "TextRenderer: unable to load font '%s'", aFontPath );
+	}
+
+	mVertices.reserve( mMaxVertices );
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+TextRenderer::~TextRenderer()
+{
+	fonsDeleteInternal( mFons );
+
+	glDeleteVertexArrays( 1, &mVao );
+	glDeleteTextures( 1, &mAtlas );
+}
+
+float TextRenderer::text( float aX, float aY, char const* aText, std::uint32_t aColor, float aSize )
+{
+	assert( aText );
+
+	fonsClearState( mFons );
+	fonsSetFont( mFons, mFont );
+	fonsSetSize( mFons, aSize );
+	fonsSetColor( mFons, aColor );
+	fonsSetAlign( mFons, FONS_ALIGN_LEFT | FONS_ALIGN_BASELINE );
+
+	// The quads arrive through fons_draw_()
+	return fonsDrawText( mFons, aX, aY, aText, nullptr );
+}
+
+float TextRenderer::text_width( char const* aText, float aSize )
+{
+	assert( aText );
+
+	fonsClearState( mFons );
+	fonsSetFont( mFons, mFont );
+	fonsSetSize( mFons, aSize );
+
+	return fonsTextBounds( mFons, 0.f, 0.f, aText, nullptr, nullptr );
+}
+
+void TextRenderer::rect( float aX0, float aY0, float aX1, float aY1, std::uint32_t aColor )
+{
+	if( mVertices.size() + 6 > mMaxVertices )
+	{
+		++mDroppedQuads;
+		return;
+	}
+
+	Vertex_ const v0{ aX0, aY0, -1.f, -1.f, aColor };
+	Vertex_ const v1{ aX1, aY0, -1.f, -1.f, aColor };
+	Vertex_ const v2{ aX1, aY1, -1.f, -1.f, aColor };
+	Vertex_ const v3{ aX0, aY1, -1.f, -1.f, aColor };
+
+	for( auto const& v : { v0, v1, v2, v0, v2, v3 } )
+		mVertices.emplace_back( v );
+}
+
+void TextRenderer::draw( float aViewportWidth, float aViewportHeight )
+{
+	if( mVertices.empty() )
+		return;
+
+	mVertexRing.begin_frame();
+
+	auto const bytes = GLsizeiptr(mVertices.size() * sizeof(Vertex_));
+	auto const alloc = mVertexRing.allocate( bytes, sizeof(Vertex_) );
+	std::memcpy( alloc.data, mVertices.data(), std::size_t(bytes) );
+
+	mProgram->set( mViewportUniform, Vec2f{ aViewportWidth, aViewportHeight } );
+
+	glDisable( GL_DEPTH_TEST );
+	glEnable( GL_BLEND );
+	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+	glUseProgram( mProgram->programId() );
+	glActiveTexture( GL_TEXTURE0 + kAtlasUnit_ );
+	glBindTexture( GL_TEXTURE_2D, mAtlas );
+
+	glBindVertexArray( mVao );
+	glBindVertexBuffer( 0, mVertexRing.bufferId(), alloc.offset, sizeof(Vertex_) );
+
+	glDrawArrays( GL_TRIANGLES, 0, GLsizei(mVertices.size()) );
+
+	glBindVertexArray( 0 );
+	glDisable( GL_BLEND );
+	glEnable( GL_DEPTH_TEST );
+
+	mVertexRing.end_frame();
+	mVertices.clear();
+
+	OGL_CHECKPOINT_DEBUG();
+}
+
+std::size_t TextRenderer::dropped_quads() const noexcept
+{
+	return mDroppedQuads;
+}
+
+int TextRenderer::fons_create_( void* aSelf, int aWidth, int aHeight )
+{
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	glGenTextures( 1, &self->mAtlas );
+	glBindTexture( GL_TEXTURE_2D, self->mAtlas );
+
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_R8, aWidth, aHeight, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr );
+
+	self->mAtlasWidth = aWidth;
+	self->mAtlasHeight = aHeight;
+	return 1;
+}
+
+int TextRenderer::fons_resize_( void* aSelf, int aWidth, int aHeight )
+{
+	// fontstash keeps the old glyphs where they were, and re-uploads them
+	// through fons_update_(). Texture coordinates are stored in texels, so
+	// quads that were collected before the resize remain valid.
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	glBindTexture( GL_TEXTURE_2D, self->mAtlas );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_R8, aWidth, aHeight, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr );
+
+	self->mAtlasWidth = aWidth;
+	self->mAtlasHeight = aHeight;
+	return 1;
+}
+
+void TextRenderer::fons_update_( void* aSelf, int* aRect, unsigned char const* aData )
+{
+	// aData is the whole atlas; only aRect (x0, y0, x1, y1) has changed.
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	glBindTexture( GL_TEXTURE_2D, self->mAtlas );
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, self->mAtlasWidth );
+	glPixelStorei( GL_UNPACK_SKIP_PIXELS, aRect[0] );
+	glPixelStorei( GL_UNPACK_SKIP_ROWS, aRect[1] );
+
+	glTexSubImage2D( GL_TEXTURE_2D, 0, aRect[0], aRect[1], aRect[2] - aRect[0], aRect[3] - aRect[1], GL_RED, GL_UNSIGNED_BYTE, aData );
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+	glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+	glPixelStorei( GL_UNPACK_SKIP_PIXELS, 0 );
+	glPixelStorei( GL_UNPACK_SKIP_ROWS, 0 );
+}
+
+void TextRenderer::fons_draw_( void* aSelf, float const* aVerts, float const* aTexCoords, unsigned int const* aColors, int aCount )
+{
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	// Whole glyphs (six vertices each) only
+	auto const space = (self->mMaxVertices - self->mVertices.size()) / 6 * 6;
+	auto const count = std::min( std::size_t(aCount), space );
+	self->mDroppedQuads += (std::size_t(aCount) - count) / 6;
+
+	auto const width = float(self->mAtlasWidth);
+	auto const height = float(self->mAtlasHeight);
+
+	for( std::size_t i = 0; i < count; ++i )
+	{
+		self->mVertices.emplace_back( Vertex_{
+			aVerts[2*i+0], aVerts[2*i+1],
+			aTexCoords[2*i+0] * width, aTexCoords[2*i+1] * height,
+			aColors[i]
+		} );
+	}
+}
+
+void TextRenderer::fons_error_( void* aSelf, int aError, int )
+{
+	auto* self = static_cast<TextRenderer*>(aSelf);
+
+	if( FONS_ATLAS_FULL == aError )
+	{
+		int const width = std::min( self->mAtlasWidth * 2, self->mMaxAtlasSize );
+		int const height = std::min( self->mAtlasHeight * 2, self->mMaxAtlasSize );
+
+		// Glyphs that still do not fit are not drawn.
+		if( width > self->mAtlasWidth || height > self->mAtlasHeight )
+			fonsExpandAtlas( self->mFons, width, height );
+	}
+}
@@ -0,0 +1,96 @@
+#ifndef TEXT_RENDERER_HPP_8D31F6A2_5C7E_4B09_9E14_B62A07C3D5E1
+#define TEXT_RENDERER_HPP_8D31F6A2_5C7E_4B09_9E14_B62A07C3D5E1
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../support/program.hpp"
+#include "../support/ring_buffer.hpp"
+
+struct FONScontext;
+
+// Colours of text() and rect(): sRGB, 8 bits per channel, red in the lowest
+// byte (the layout used by fontstash)
+constexpr std::uint32_t rgba( std::uint8_t aR, std::uint8_t aG, std::uint8_t aB, std::uint8_t aA = 255 ) noexcept
+{
+	return std::uint32_t(aR) | (std::uint32_t(aG) << 8) | (std::uint32_t(aB) << 16) | (std::uint32_t(aA) << 24);
+}
+
+/* Batched screen-space text with fontstash
+ *
+ * fontstash lays out the text and rasterises glyphs on demand into an atlas
+ * (a GL_R8 texture, grown when it fills up). text() and rect() only collect
+ * quads on the CPU; draw() copies all quads of the frame into the frame's
+ * segment of a persistently mapped vertex ring buffer (see RingBuffer) and
+ * draws them with a single glDrawArrays(), alpha blended over whatever is in
+ * the framebuffer.
+ *
+ * Positions are in pixels, with the origin in the top-left corner; text()
+ * places the baseline at aY. Quads beyond aMaxQuadsPerFrame are dropped.
+ *
+ * The program (text.vert, text.frag) must outlive the TextRenderer. fontstash
+ * keeps a pointer to the TextRenderer, which can therefore not be moved.
+ */
+class TextRenderer final
+{
+	public:
+		TextRenderer(
+			ShaderProgram& aProgram,
+			char const* aFontPath,
+			std::size_t aMaxQuadsPerFrame = 8192
+		);
+		~TextRenderer();
+
+		TextRenderer( TextRenderer const& ) = delete;
+		TextRenderer& operator= (TextRenderer const&) = delete;
+
+	public:
+		// Returns the x coordinate after the text
+		float text( float aX, float aY, char const* aText, std::uint32_t aColor, float aSize );
+		float text_width( char const* aText, float aSize );
+
+		void rect( float aX0, float aY0, float aX1, float aY1, std::uint32_t aColor );
+
+		// Draws and clears the quads collected since the last draw()
+		void draw( float aViewportWidth, float aViewportHeight );
+
+		std::size_t dropped_quads() const noexcept;
+
+	private:
+		struct Vertex_
+		{
+			float x, y;
+			float s, t; // In texels; negative for rect()
+			std::uint32_t color;
+		};
+
+		static int fons_create_( void*, int, int );
+		static int fons_resize_( void*, int, int );
+		static void fons_update_( void*, int*, unsigned char const* );
+		static void fons_draw_( void*, float const*, float const*, unsigned int const*, int );
+		static void fons_error_( void*, int, int );
+
+	private:
+		ShaderProgram* mProgram;
+		ShaderProgram::Uniform<Vec2f> mViewportUniform;
+
+		RingBuffer mVertexRing;
+		GLuint mVao;
+
+		GLuint mAtlas;
+		GLsizei mAtlasWidth, mAtlasHeight;
+		GLint mMaxAtlasSize;
+
+		FONScontext* mFons;
+		int mFont;
+
+		std::vector<Vertex_> mVertices;
+		std::size_t mMaxVertices;
+		std::size_t mDroppedQuads;
+};
+
+#endif // TEXT_RENDERER_HPP_8D31F6A2_5C7E_4B09_9E14_B62A07C3D5E1
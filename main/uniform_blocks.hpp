@@ -0,0 +1,131 @@
+#ifndef UNIFORM_BLOCKS_HPP_6F1E3B2A_84C7_4D59_A0E3_2B7C9D41F856
+#define UNIFORM_BLOCKS_HPP_6F1E3B2A_84C7_4D59_A0E3_2B7C9D41F856
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/vec4.hpp"
+#include "../vmlib/mat44.hpp"
+
+/* CPU-side mirrors of the std140 uniform blocks (and std430 storage blocks)
+ * declared in the shaders.
+ *
+ * The blocks are declared with the row_major qualifier, so Mat44f can be
+ * copied as-is (no transpose). All members are padded to 16 bytes, which
+ * keeps the std140 rules trivial: vec3 values are stored in Vec4f, and
+ * scalars at the end of a block are followed by explicit padding.
+ *
+ * Keep in sync with assets/frame_block.glsl, assets/default.frag,
+ * assets/batched.vert, assets/instanced.vert, assets/depth.vert,
+ * assets/cull.comp and the assets/terrain.* shaders.
+ */
+
+// Uniform block binding points
+constexpr unsigned kFrameBlockBinding = 0;
+constexpr unsigned kClusterBlockBinding = 2;
+constexpr unsigned kTerrainBlockBinding = 3;
+
+// Shader storage block binding points
+constexpr unsigned kInstanceBufferBinding = 0;
+constexpr unsigned kDrawBufferBinding = 1;
+constexpr unsigned kLightBufferBinding = 2;
+constexpr unsigned kClusterBufferBinding = 3;
+constexpr unsigned kLightIndexBufferBinding = 4;
+constexpr unsigned kCullObjectBufferBinding = 5;
+constexpr unsigned kCullCommandBufferBinding = 6;
+constexpr unsigned kCullDrawBufferBinding = 7;
+
+// Atomic counter binding points
+constexpr unsigned kCullCounterBinding = 0;
+
+// DrawData::flags and InstanceData::flags. Keep in sync with
+// assets/object_flags.glsl
+constexpr std::uint32_t kObjectFlagApplyLighting = 1u << 0;
+
+// The Frame block (assets/frame_block.glsl)
+struct FrameUniforms
+{
+	Mat44f view;
+	Mat44f projection;
+	Mat44f projView;
+
+	Vec4f dirLightDirection; // xyz
+	Vec4f dirLightColor;     // rgb
+	Vec4f ambientColor;      // rgb
+};
+
+// Element of the Instances storage block (std430) read by instanced.vert
+struct InstanceData
+{
+	Mat44f model;
+	std::uint32_t flags; // Same as DrawData::flags
+	std::uint32_t _pad[3];
+};
+
+// Element of the Draws storage block (std430) read by batched.vert, one per
+// command of a multi-draw
+struct DrawData
+{
+	Mat44f model;
+	std::uint32_t flags;
+	std::uint32_t _pad[3];
+};
+
+// Element of the CullObjects storage block (std430) read by cull.comp: one
+// object to test, and the draw to emit if it is visible
+struct CullObjectData
+{
+	Mat44f model;
+	Vec4f boundsMin;            // xyz, object space
+	Vec4f boundsMax;            // xyz, object space
+	std::uint32_t indexCount;   // DrawElementsIndirectCommand::count
+	std::uint32_t firstIndex;
+	std::int32_t baseVertex;
+	std::uint32_t flags;        // Same as DrawData::flags
+};
+
+// Element of the Lights storage block (std430) read by default.frag
+struct PointLightData
+{
+	Vec4f positionRadius; // xyz = world-space position, w = radius of influence
+	Vec4f color;          // rgb = color
+};
+
+// Clustered lighting parameters (see ClusteredLights). The Clusters storage
+// block holds one (first index, count) pair per cluster into the
+// LightIndices storage block.
+struct ClusterUniforms
+{
+	std::uint32_t gridSize[3]; // Clusters in x, y (screen tiles) and z (depth slices)
+	std::uint32_t lightCount;
+	float tileSize[2];         // Tile size in pixels
+	float sliceScale;          // slice = log(viewDepth) * sliceScale + sliceBias
+	float sliceBias;
+};
+
+// Tessellated terrain parameters (see TessellatedTerrain)
+struct TerrainUniforms
+{
+	Vec4f heightmapTransform; // heightmap texcoord = world xz * xy + zw
+	Vec4f grid;               // xy = world-space origin (x, z), zw = patch size
+	Vec4f color;              // rgb, the fragColor of all vertices
+	float viewportSize[2];    // pixels
+	float heightRange[2];     // Lowest and highest heights of the heightmap
+	float pixelsPerEdge;      // Target length of a tessellated edge on screen
+	float maxTessLevel;
+	std::uint32_t flags;      // Same as DrawData::flags
+	std::uint32_t _pad;
+};
+
+static_assert( offsetof(FrameUniforms, dirLightDirection) == 192 );
+static_assert( sizeof(FrameUniforms) == 240 );
+static_assert( sizeof(InstanceData) == 80 );
+static_assert( sizeof(DrawData) == 80 );
+static_assert( sizeof(CullObjectData) == 112 );
+static_assert( sizeof(PointLightData) == 32 );
+static_assert( offsetof(ClusterUniforms, tileSize) == 16 );
+static_assert( sizeof(ClusterUniforms) == 32 );
+static_assert( offsetof(TerrainUniforms, viewportSize) == 48 );
+static_assert( sizeof(TerrainUniforms) == 80 );
+
+#endif // UNIFORM_BLOCKS_HPP_6F1E3B2A_84C7_4D59_A0E3_2B7C9D41F856
@@ -0,0 +1,339 @@
+#include "alloc_tracker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#include <cassert>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#	include <malloc.h>
+#endif
+
+namespace
+{
+	struct ThreadSlot_
+	{
+		std::atomic<std::uint64_t> allocations{ 0 };
+		std::atomic<std::uint64_t> frees{ 0 };
+		std::atomic<std::uint64_t> bytes{ 0 };
+	};
+
+	// Constant-initialized, so that allocations made during the dynamic
+	// initialization of other translation units are counted too.
+	ThreadSlot_ gThreadSlots_[kMaxTrackedThreads];
+	std::atomic<std::size_t> gUsedSlots_{ 0 };
+
+	thread_local ThreadSlot_* tThreadSlot_ = nullptr;
+
+	ThreadSlot_& thread_slot_() noexcept
+	{
+		if( !tThreadSlot_ )
+		{
+			auto const index = gUsedSlots_.fetch_add( 1, std::memory_order_relaxed );
+			tThreadSlot_ = &gThreadSlots_[std::min( index, kMaxTrackedThreads-1 )];
+		}
+
+		return *tThreadSlot_;
+	}
+
+	void count_allocation_( std::size_t aSize ) noexcept
+	{
+		auto& slot = thread_slot_();
+		slot.allocations.fetch_add( 1, std::memory_order_relaxed );
+		slot.bytes.fetch_add( aSize, std::memory_order_relaxed );
+	}
+
+	void count_free_( void* aPtr ) noexcept
+	{
+		if( aPtr )
+			thread_slot_().frees.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	AllocCounters load_( ThreadSlot_ const& aSlot ) noexcept
+	{
+		return AllocCounters{
+			aSlot.allocations.load( std::memory_order_relaxed ),
+			aSlot.frees.load( std::memory_order_relaxed ),
+			aSlot.bytes.load( std::memory_order_relaxed )
+		};
+	}
+
+	void* try_allocate_( std::size_t aSize, std::size_t aAlign ) noexcept
+	{
+		// operator new must return a unique pointer for zero-sized requests
+		aSize = std::max<std::size_t>( aSize, 1 );
+
+		void* ptr = nullptr;
+		if( aAlign <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ )
+			ptr = std::malloc( aSize );
+		else
+		{
+#			if defined(_WIN32)
+			ptr = _aligned_malloc( aSize, aAlign );
+#			else
+			if( 0 != posix_memalign( &ptr, std::max( aAlign, sizeof(void*) ), aSize ) )
+				ptr = nullptr;
+#			endif
+		}
+
+		if( ptr )
+			count_allocation_( aSize );
+
+		return ptr;
+	}
+
+	// As required of the replaceable operator new: call the new-handler
+	// until the allocation succeeds, or throw if there is none.
+	void* allocate_( std::size_t aSize, std::size_t aAlign )
+	{
+		for( ;; )
+		{
+			if( void* ptr = try_allocate_( aSize, aAlign ) )
+				return ptr;
+
+			auto const handler = std::get_new_handler();
+			if( !handler )
+				throw std::bad_alloc();
+
+			handler();
+		}
+	}
+
+	void* allocate_nothrow_( std::size_t aSize, std::size_t aAlign ) noexcept
+	{
+		try
+		{
+			return allocate_( aSize, aAlign );
+		}
+		catch( std::bad_alloc const& )
+		{
+			return nullptr;
+		}
+	}
+
+	void free_( void* aPtr, std::size_t aAlign ) noexcept
+	{
+		count_free_( aPtr );
+
+#		if defined(_WIN32)
+		if( aAlign > __STDCPP_DEFAULT_NEW_ALIGNMENT__ )
+		{
+			_aligned_free( aPtr );
+			return;
+		}
+#		else
+		(void)aAlign;
+#		endif
+
+		std::free( aPtr );
+	}
+
+	constexpr std::size_t kDefaultAlign_ = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+}
+
+
+// Replaceable global allocation functions
+void* operator new( std::size_t aSize )
+{
+	return allocate_( aSize, kDefaultAlign_ );
+}
+void* operator new[]( std::size_t aSize )
+{
+	return allocate_( aSize, kDefaultAlign_ );
+}
+void* operator new( std::size_t aSize, std::nothrow_t const& ) noexcept
+{
+	return allocate_nothrow_( aSize, kDefaultAlign_ );
+}
+void* operator new[]( std::size_t aSize, std::nothrow_t const& ) noexcept
+{
+	return allocate_nothrow_( aSize, kDefaultAlign_ );
+}
+void* operator new( std::size_t aSize, std::align_val_t aAlign )
+{
+	return allocate_( aSize, std::size_t(aAlign) );
+}
+void* operator new[]( std::size_t aSize, std::align_val_t aAlign )
+{
+	return allocate_( aSize, std::size_t(aAlign) );
+}
+void* operator new( std::size_t aSize, std::align_val_t aAlign, std::nothrow_t const& ) noexcept
+{
+	return allocate_nothrow_( aSize, std::size_t(aAlign) );
+}
+void* operator new[]( std::size_t aSize, std::align_val_t aAlign, std::nothrow_t const& ) noexcept
+{
+	return allocate_nothrow_( aSize, std::size_t(aAlign) );
+}
+
+void operator delete( void* aPtr ) noexcept
+{
+	free_( aPtr, kDefaultAlign_ );
+}
+void operator delete[]( void* aPtr ) noexcept
+{
+	free_( aPtr, kDefaultAlign_ );
+}
+void operator delete( void* aPtr, std::size_t ) noexcept
+{
+	free_( aPtr, kDefaultAlign_ );
+}
+void operator delete[]( void* aPtr, std::size_t ) noexcept
+{
+	free_( aPtr, kDefaultAlign_ );
+}
+void operator delete( void* aPtr, std::nothrow_t const& ) noexcept
+{
+	free_( aPtr, kDefaultAlign_ );
+}
+void operator delete[]( void* aPtr, std::nothrow_t const& ) noexcept
+{
+	free_( aPtr, kDefaultAlign_ );
+}
+void operator delete( void* aPtr, std::align_val_t aAlign ) noexcept
+{
+	free_( aPtr, std::size_t(aAlign) );
+}
+void operator delete[]( void* aPtr, std::align_val_t aAlign ) noexcept
+{
+	free_( aPtr, std::size_t(aAlign) );
+}
+void operator delete( void* aPtr, std::size_t, std::align_val_t aAlign ) noexcept
+{
+	free_( aPtr, std::size_t(aAlign) );
+}
+void operator delete[]( void* aPtr, std::size_t, std::align_val_t aAlign ) noexcept
+{
+	free_( aPtr, std::size_t(aAlign) );
+}
+void operator delete( void* aPtr, std::align_val_t aAlign, std::nothrow_t const& ) noexcept
+{
+	free_( aPtr, std::size_t(aAlign) );
+}
+void operator delete[]( void* aPtr, std::align_val_t aAlign, std::nothrow_t const& ) noexcept
+{
+	free_( aPtr, std::size_t(aAlign) );
+}
+
+
+AllocCounters operator- ( AllocCounters const& aA, AllocCounters const& aB ) noexcept
+{
+	return AllocCounters{ aA.allocations - aB.allocations, aA.frees - aB.frees, aA.bytes - aB.bytes };
+}
+
+AllocCounters thread_alloc_counters() noexcept
+{
+	return load_( thread_slot_() );
+}
+
+AllocCounters total_alloc_counters() noexcept
+{
+	AllocCounters ret{};
+
+	auto const used = std::min( gUsedSlots_.load( std::memory_order_relaxed ), kMaxTrackedThreads );
+	for( std::size_t i = 0; i < used; ++i )
+	{
+		auto const counters = load_( gThreadSlots_[i] );
+		ret.allocations += counters.allocations;
+		ret.frees += counters.frees;
+		ret.bytes += counters.bytes;
+	}
+
+	return ret;
+}
+
+void print_alloc_statistics( std::FILE* aOut )
+{
+	assert( aOut );
+
+	// Slots are claimed in order; the first is usually the main thread
+	auto const used = std::min( gUsedSlots_.load( std::memory_order_relaxed ), kMaxTrackedThreads );
+
+	std::fprintf( aOut, "Heap allocations (operator new) per thread:\n" );
+	for( std::size_t i = 0; i < used; ++i )
+	{
+		auto const counters = load_( gThreadSlots_[i] );
+		std::fprintf( aOut, "  thread %2zu%s: %10llu allocations, %10llu frees, %10.1f MiB\n",
+			i, kMaxTrackedThreads-1 == i ? "+" : " ",
+			static_cast<unsigned long long>(counters.allocations),
+			static_cast<unsigned long long>(counters.frees),
+			double(counters.bytes) / (1024.0 * 1024.0)
+		);
+	}
+}
+
+
+FrameAllocations::FrameAllocations( std::size_t aWarmupFrames ) noexcept
+	: mWarmupFrames( aWarmupFrames )
+	, mFrames( 0 )
+	, mBegin{}
+	, mLastFrame{}
+	, mWarmup{}
+	, mSteady{}
+	, mAllocatingFrames( 0 )
+	, mMaxAllocations( 0 )
+	, mMaxBytes( 0 )
+{}
+
+void FrameAllocations::begin_frame() noexcept
+{
+	mBegin = thread_alloc_counters();
+}
+
+AllocCounters FrameAllocations::end_frame() noexcept
+{
+	mLastFrame = thread_alloc_counters() - mBegin;
+
+	auto& sum = steady_state() ? mSteady : mWarmup;
+	sum.allocations += mLastFrame.allocations;
+	sum.frees += mLastFrame.frees;
+	sum.bytes += mLastFrame.bytes;
+
+	if( steady_state() )
+	{
+		if( mLastFrame.allocations > 0 )
+			++mAllocatingFrames;
+
+		mMaxAllocations = std::max( mMaxAllocations, mLastFrame.allocations );
+		mMaxBytes = std::max( mMaxBytes, mLastFrame.bytes );
+	}
+
+	++mFrames;
+	return mLastFrame;
+}
+
+bool FrameAllocations::steady_state() const noexcept
+{
+	return mFrames >= mWarmupFrames;
+}
+
+AllocCounters const& FrameAllocations::last_frame() const noexcept
+{
+	return mLastFrame;
+}
+
+void FrameAllocations::print( std::FILE* aOut, char const* aLabel ) const
+{
+	assert( aOut && aLabel );
+
+	auto const warmup = std::min( mFrames, mWarmupFrames );
+	auto const steady = mFrames - warmup;
+
+	std::fprintf( aOut, "%s allocations (operator new):\n", aLabel );
+	if( warmup > 0 )
+		std::fprintf( aOut, "  first %zu frames: %llu allocations, %.1f KiB\n", warmup, static_cast<unsigned long long>(mWarmup.allocations), double(mWarmup.bytes) / 1024.0 );
+
+	if( 0 == steady )
+		return;
+
+	std::fprintf( aOut, "  next %zu frames: %.1f allocations, %.1f KiB per frame (max %llu, %.1f KiB); %zu frames allocated\n",
+		steady,
+		double(mSteady.allocations) / double(steady),
+		double(mSteady.bytes) / double(steady) / 1024.0,
+		static_cast<unsigned long long>(mMaxAllocations),
+		double(mMaxBytes) / 1024.0,
+		mAllocatingFrames
+	);
+}
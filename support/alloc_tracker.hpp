@@ -0,0 +1,77 @@
+#ifndef ALLOC_TRACKER_HPP_C2A84F1E_6D39_4B70_95E8_3F1B07D6A2C9
+#define ALLOC_TRACKER_HPP_C2A84F1E_6D39_4B70_95E8_3F1B07D6A2C9
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+/* Heap allocation counters
+ *
+ * alloc_tracker.cpp replaces the global operator new and operator delete
+ * (all forms). Each allocation and deallocation is counted per thread, in
+ * one of kMaxTrackedThreads slots that a thread claims on its first
+ * allocation; threads beyond that share the last slot. Counting takes a
+ * few relaxed atomic operations and never allocates. Memory from malloc()
+ * and friends is not counted.
+ *
+ * Profiler scopes record the allocations of their thread between begin and
+ * end (see Profiler::ScopeStats). FrameAllocations collects the
+ * allocations of each frame of a loop on one thread.
+ */
+constexpr std::size_t kMaxTrackedThreads = 64;
+
+struct AllocCounters
+{
+	std::uint64_t allocations;
+	std::uint64_t frees;
+	std::uint64_t bytes; // Allocated (requested sizes)
+};
+
+AllocCounters operator- ( AllocCounters const&, AllocCounters const& ) noexcept;
+
+// Counters of the calling thread, since it started
+AllocCounters thread_alloc_counters() noexcept;
+
+// Counters of all threads, since the program started
+AllocCounters total_alloc_counters() noexcept;
+
+// One line per thread that has allocated
+void print_alloc_statistics( std::FILE* );
+
+/* Allocations per frame of a loop, on the thread that calls begin_frame()
+ * and end_frame(). Frames before aWarmupFrames (loading, first uses of
+ * lazily created resources) are counted separately from the steady state.
+ */
+class FrameAllocations final
+{
+	public:
+		explicit FrameAllocations( std::size_t aWarmupFrames = 0 ) noexcept;
+
+	public:
+		void begin_frame() noexcept;
+
+		// Returns the allocations since begin_frame()
+		AllocCounters end_frame() noexcept;
+
+		// Whether the next end_frame() ends a steady-state frame
+		bool steady_state() const noexcept;
+
+		AllocCounters const& last_frame() const noexcept;
+
+		void print( std::FILE*, char const* aLabel ) const;
+
+	private:
+		std::size_t mWarmupFrames;
+		std::size_t mFrames;
+
+		AllocCounters mBegin;
+		AllocCounters mLastFrame;
+
+		AllocCounters mWarmup;
+		AllocCounters mSteady;
+		std::size_t mAllocatingFrames; // Steady state only
+		std::uint64_t mMaxAllocations;
+		std::uint64_t mMaxBytes;
+};
+
+#endif // ALLOC_TRACKER_HPP_C2A84F1E_6D39_4B70_95E8_3F1B07D6A2C9
@@ -23,10 +23,28 @@ namespace
 
 		return "<unknown error value>";
 	}
+
+	unsigned gCheckpointInterval_ = 1;
+	unsigned gCheckpointFrame_ = 0;
+}
+
+void set_checkpoint_interval( unsigned aFrames ) noexcept
+{
+	gCheckpointInterval_ = aFrames > 0 ? aFrames : 1;
+	gCheckpointFrame_ = 0;
+	detail::gDebugCheckpointsActive = true;
+}
+
+void end_checkpoint_frame() noexcept
+{
+	gCheckpointFrame_ = (gCheckpointFrame_ + 1) % gCheckpointInterval_;
+	detail::gDebugCheckpointsActive = 0 == gCheckpointFrame_;
 }
 
 namespace detail
 {
+	bool gDebugCheckpointsActive = true;
+
 	void check_gl_error( char const* aSourceFile, int aSourceLine )
 	{
 		auto const res = glGetError();
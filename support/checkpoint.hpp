@@ -9,12 +9,28 @@
 #if defined(NDEBUG)
 #	define OGL_CHECKPOINT_DEBUG()   do {} while(0)
 #else
-#	define OGL_CHECKPOINT_DEBUG()   OGL_CHECKPOINT_ALWAYS()
+#	define OGL_CHECKPOINT_DEBUG()   do {                            \
+		if( ::detail::gDebugCheckpointsActive )                     \
+			::detail::check_gl_error( __FILE__, __LINE__ );         \
+	} while(0)                                                      \
+	/*ENDM*/
 #endif
 
+// glGetError() waits for the driver to catch up with the calls made so far.
+// To keep debug builds fast, OGL_CHECKPOINT_DEBUG() can be sampled: with an
+// interval of N, its checks only run during every N-th frame (frames are
+// counted by end_checkpoint_frame()). An error is then reported by the
+// first checkpoint of a checked frame, which may be some way from the call
+// that caused it. The default interval of 1 checks every frame.
+// OGL_CHECKPOINT_ALWAYS() is never sampled.
+void set_checkpoint_interval( unsigned aFrames ) noexcept;
+void end_checkpoint_frame() noexcept;
+
 namespace detail
 {
 	void check_gl_error( char const*, int );
+
+	extern bool gDebugCheckpointsActive;
 }
 
 #endif // CHECKPOINT_HPP_3DFDA796_469C_4D37_B904_1C8D8FAE207B
@@ -1,12 +1,23 @@
 #include "debug_output.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
 #include <cstdio>
+#include <cstdint>
+#include <cstring>
 #include <cassert>
 
 #include <glad.h>
 #include <GLFW/glfw3.h>
 
 #include "error.hpp"
+#include "hash.hpp"
 #include "checkpoint.hpp"
 
 namespace
@@ -14,10 +25,62 @@ namespace
 	// Debug callback
 #	if !defined(NDEBUG)
 	void GLAPIENTRY callback_gldebug_( GLenum, GLenum, GLuint, GLenum, GLsizei, GLchar const*, void const* );
+	void GLAPIENTRY callback_gldebug_async_( GLenum, GLenum, GLuint, GLenum, GLsizei, GLchar const*, void const* );
+
+	// Longer messages are truncated
+	constexpr std::size_t kMaxMessageLength_ = 512;
+	constexpr std::size_t kRingSize_ = 1024; // Power of two
+
+	constexpr auto kFlushInterval_ = std::chrono::milliseconds( 50 );
+
+	// Multiple-producer, single-consumer ring (after D. Vyukov's bounded
+	// queue). The driver may call the callback from several threads at once
+	// when GL_DEBUG_OUTPUT_SYNCHRONOUS is off. Each slot's sequence number
+	// says whether it is free for the producer that claimed it (== index),
+	// or holds a message for the consumer (== index+1).
+	struct Message_
+	{
+		std::atomic<std::size_t> sequence;
+
+		GLenum source, type, severity;
+		GLuint id;
+		char text[kMaxMessageLength_];
+	};
+
+	struct Seen_
+	{
+		std::size_t count;
+		GLenum source, type, severity;
+		GLuint id;
+		std::string text;
+	};
+
+	struct AsyncOutput_
+	{
+		std::array<Message_,kRingSize_> ring;
+		std::atomic<std::size_t> head{ 0 }; // Next slot to claim
+		std::size_t tail = 0; // Next slot to read; flush thread only
+		std::atomic<std::size_t> dropped{ 0 };
+
+		std::thread flusher;
+		std::atomic<bool> running{ false };
+
+		// Flush thread only. Keyed by the hash of the message; messages with
+		// the same hash are told apart by comparing them in full.
+		std::unordered_multimap<std::uint64_t,Seen_> seen;
+		std::size_t received = 0;
+
+		~AsyncOutput_();
+	};
+
+	AsyncOutput_ gAsyncOutput_;
+
+	void flush_async_();
+	void print_repeats_();
 #	endif // ~ !NDEBUG
 }
 
-void setup_gl_debug_output()
+void setup_gl_debug_output( DebugOutputMode aMode )
 {
 #	if !defined(NDEBUG)
 	OGL_CHECKPOINT_ALWAYS();
@@ -26,15 +89,71 @@ void setup_gl_debug_output()
 	// Apple. The extension (ARB_debug_output), which predates standardization
 	// doesn't seem to exist on Apple either.
 #	if !defined(__APPLE__)
-	glDebugMessageCallback( &callback_gldebug_, nullptr );
-	glEnable( GL_DEBUG_OUTPUT );
+	if( DebugOutputMode::Asynchronous == aMode )
+	{
+		auto& out = gAsyncOutput_;
+		if( !out.running.exchange( true ) )
+		{
+			for( std::size_t i = 0; i < kRingSize_; ++i )
+				out.ring[i].sequence.store( i, std::memory_order_relaxed );
 
-	// Make sure the callback is called synchronously and from the same thread.
-	// This makes the debugger more useful.
-	glEnable( GL_DEBUG_OUTPUT_SYNCHRONOUS );
+			out.flusher = std::thread( [&out] {
+				while( out.running.load( std::memory_order_acquire ) )
+				{
+					flush_async_();
+					std::this_thread::sleep_for( kFlushInterval_ );
+				}
+			} );
+		}
+
+		glDebugMessageCallback( &callback_gldebug_async_, nullptr );
+		glEnable( GL_DEBUG_OUTPUT );
+
+		// Let the driver report messages whenever (and from wherever) it
+		// likes.
+		glDisable( GL_DEBUG_OUTPUT_SYNCHRONOUS );
+	}
+	else
+	{
+		glDebugMessageCallback( &callback_gldebug_, nullptr );
+		glEnable( GL_DEBUG_OUTPUT );
+
+		// Make sure the callback is called synchronously and from the same
+		// thread. This makes the debugger more useful.
+		glEnable( GL_DEBUG_OUTPUT_SYNCHRONOUS );
+	}
 #	endif // ~ __APPLE__
 
 	OGL_CHECKPOINT_ALWAYS();
+#	else // NDEBUG
+	(void)aMode;
+#	endif // ~ !NDEBUG
+}
+
+void shutdown_gl_debug_output()
+{
+#	if !defined(NDEBUG)
+	auto& out = gAsyncOutput_;
+	if( !out.running.load() )
+		return;
+
+	// Nothing drains the ring after this; messages from the rest of the
+	// shutdown (e.g., destroying the context) go to the synchronous
+	// callback instead. glFinish() lets the driver deliver the messages of
+	// the commands that are still pending (through either callback) before
+	// the ring is drained for the last time.
+#	if !defined(__APPLE__)
+	glDebugMessageCallback( &callback_gldebug_, nullptr );
+	glEnable( GL_DEBUG_OUTPUT_SYNCHRONOUS );
+#	endif // ~ __APPLE__
+	glFinish();
+
+	out.running.store( false );
+	out.flusher.join();
+
+	// Messages that arrived during the last sleep
+	flush_async_();
+	print_repeats_();
 #	endif // ~ !NDEBUG
 }
 
@@ -71,7 +190,7 @@ namespace
 		return "<unknown severity>";
 	}
 
-	void GLAPIENTRY callback_gldebug_( GLenum, GLenum aType, GLuint, GLenum aSeverity, GLsizei, GLchar const* aMessage, void const* /*aUser*/ )
+	void GLAPIENTRY callback_gldebug_( GLenum aSource, GLenum aType, GLuint, GLenum aSeverity, GLsizei, GLchar const* aMessage, void const* /*aUser*/ )
 	{
 		// "Other" can be a bit spammy at times. However, it can include fairly
 		// interesting information on e.g. NVIDIA (such as in what memory VBOs
@@ -82,10 +201,126 @@ namespace
 
 		std::fprintf( stderr, "OpenGL Debug: %s [%s]: %s\n", severity_str_(aSeverity), type_str_(aType), aMessage );
 
-		// For high severity errors, break into the debugger now.
-		if( GL_DEBUG_SEVERITY_HIGH == aSeverity )
+		// For high severity errors, break into the debugger now. Some drivers
+		// also report shader compile errors this way; those are handled by
+		// ShaderProgram (which keeps the old program on reload).
+		if( GL_DEBUG_SEVERITY_HIGH == aSeverity && GL_DEBUG_SOURCE_SHADER_COMPILER != aSource )
 			assert( false );
 	}
+
+	void GLAPIENTRY callback_gldebug_async_( GLenum aSource, GLenum aType, GLuint aId, GLenum aSeverity, GLsizei aLength, GLchar const* aMessage, void const* /*aUser*/ )
+	{
+		// See callback_gldebug_()
+		if( GL_DEBUG_TYPE_OTHER == aType )
+			return;
+
+		auto& out = gAsyncOutput_;
+
+		// Claim a free slot. If the ring is full, the message is dropped
+		// rather than waiting for the flush thread.
+		Message_* slot = nullptr;
+		auto pos = out.head.load( std::memory_order_relaxed );
+		for( ;; )
+		{
+			auto& candidate = out.ring[pos & (kRingSize_-1)];
+			auto const seq = candidate.sequence.load( std::memory_order_acquire );
+
+			if( seq == pos )
+			{
+				if( out.head.compare_exchange_weak( pos, pos+1, std::memory_order_relaxed ) )
+				{
+					slot = &candidate;
+					break;
+				}
+			}
+			else if( seq < pos )
+			{
+				out.dropped.fetch_add( 1, std::memory_order_relaxed );
+				return;
+			}
+			else
+			{
+				pos = out.head.load( std::memory_order_relaxed );
+			}
+		}
+
+		auto const length = aLength >= 0 ? std::size_t(aLength) : std::strlen( aMessage );
+		auto const copied = std::min( length, kMaxMessageLength_-1 );
+
+		slot->source = aSource;
+		slot->type = aType;
+		slot->severity = aSeverity;
+		slot->id = aId;
+		std::memcpy( slot->text, aMessage, copied );
+		slot->text[copied] = '\0';
+
+		slot->sequence.store( pos+1, std::memory_order_release );
+	}
+
+	void flush_async_()
+	{
+		auto& out = gAsyncOutput_;
+
+		for( ;; )
+		{
+			auto& slot = out.ring[out.tail & (kRingSize_-1)];
+			if( slot.sequence.load( std::memory_order_acquire ) != out.tail+1 )
+				break;
+
+			// Identical messages share a key
+			auto key = hash_bytes( &slot.source, sizeof(slot.source) );
+			key = hash_bytes( &slot.type, sizeof(slot.type), key );
+			key = hash_bytes( &slot.id, sizeof(slot.id), key );
+			key = hash_bytes( &slot.severity, sizeof(slot.severity), key );
+			key = hash_bytes( slot.text, std::strlen( slot.text ), key );
+
+			auto const [begin, end] = out.seen.equal_range( key );
+			auto it = std::find_if( begin, end, [&slot] (auto const& aSeen) {
+				auto const& seen = aSeen.second;
+				return seen.source == slot.source && seen.type == slot.type && seen.id == slot.id && seen.severity == slot.severity && seen.text == slot.text;
+			} );
+
+			if( end == it )
+			{
+				it = out.seen.emplace( key, Seen_{ 0, slot.source, slot.type, slot.severity, slot.id, slot.text } );
+				std::fprintf( stderr, "OpenGL Debug: %s [%s]: %s\n", severity_str_(slot.severity), type_str_(slot.type), slot.text );
+			}
+
+			++it->second.count;
+			++out.received;
+
+			// Hand the slot back to the producers, one lap later
+			slot.sequence.store( out.tail + kRingSize_, std::memory_order_release );
+			++out.tail;
+		}
+	}
+
+	void print_repeats_()
+	{
+		auto& out = gAsyncOutput_;
+
+		std::size_t repeated = 0;
+		for( auto const& [key, seen] : out.seen )
+		{
+			if( seen.count < 2 )
+				continue;
+
+			if( 0 == repeated++ )
+				std::fprintf( stderr, "OpenGL Debug: repeated messages:\n" );
+
+			std::fprintf( stderr, "  %zux %s [%s]: %s\n", seen.count, severity_str_(seen.severity), type_str_(seen.type), seen.text.c_str() );
+		}
+
+		if( auto const dropped = out.dropped.load() )
+			std::fprintf( stderr, "OpenGL Debug: %zu messages dropped (of %zu); the ring was full\n", dropped, dropped + out.received );
+	}
+
+	AsyncOutput_::~AsyncOutput_()
+	{
+		// shutdown_gl_debug_output() was not called; a joinable std::thread
+		// would terminate the program.
+		if( running.exchange( false ) )
+			flusher.join();
+	}
 #	endif // ~ !NDEBUG
 }
-
@@ -1,6 +1,25 @@
 #ifndef DEBUG_OUTPUT_HPP_91C7C3DF_B7F1_4025_B682_2456DFD7C05D
 #define DEBUG_OUTPUT_HPP_91C7C3DF_B7F1_4025_B682_2456DFD7C05D
 
-void setup_gl_debug_output();
+enum class DebugOutputMode
+{
+	// Messages are printed by the callback, on the thread that made the
+	// offending GL call (GL_DEBUG_OUTPUT_SYNCHRONOUS). Errors break into the
+	// debugger at the call. Slow: every message stalls the driver.
+	Synchronous,
+
+	// The callback only copies messages into a lock-free ring. A background
+	// thread prints each distinct message once, and counts repeats; the
+	// counts are printed by shutdown_gl_debug_output().
+	Asynchronous
+};
+
+void setup_gl_debug_output( DebugOutputMode = DebugOutputMode::Synchronous );
+
+// Prints the remaining messages, and stops the background thread of
+// DebugOutputMode::Asynchronous. Later messages are printed by the
+// synchronous callback. Does nothing in the other mode. GL thread only; the
+// context must still be current.
+void shutdown_gl_debug_output();
 
 #endif // DEBUG_OUTPUT_HPP_91C7C3DF_B7F1_4025_B682_2456DFD7C05D
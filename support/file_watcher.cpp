@@ -0,0 +1,147 @@
+#include "file_watcher.hpp"
+
+#include <algorithm>
+#include <system_error>
+#include <utility>
+
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+#	include <unistd.h>
+#	include <sys/inotify.h>
+#endif
+
+namespace
+{
+#	if !defined(__linux__)
+	// Rescanning the directory is cheap, but not free
+	constexpr auto kScanInterval_ = std::chrono::milliseconds( 250 );
+#	endif
+}
+
+#if defined(__linux__)
+FileWatcher::FileWatcher( std::string aDirectory )
+	: mDirectory( std::move(aDirectory) )
+	, mNotifyFd( -1 )
+{
+	mNotifyFd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	if( -1 == mNotifyFd )
+	{
+		std::fprintf( stderr, "Note: not watching '%s': inotify_init1(): %s\n", mDirectory.c_str(), std::strerror( errno ) );
+		return;
+	}
+
+	if( -1 == inotify_add_watch( mNotifyFd, mDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO ) )
+	{
+		std::fprintf( stderr, "Note: not watching '%s': inotify_add_watch(): %s\n", mDirectory.c_str(), std::strerror( errno ) );
+		close( std::exchange( mNotifyFd, -1 ) );
+	}
+}
+
+FileWatcher::~FileWatcher()
+{
+	if( -1 != mNotifyFd )
+		close( mNotifyFd );
+}
+
+FileWatcher::FileWatcher( FileWatcher&& aOther ) noexcept
+	: mDirectory( std::move(aOther.mDirectory) )
+	, mNotifyFd( std::exchange( aOther.mNotifyFd, -1 ) )
+{}
+FileWatcher& FileWatcher::operator= (FileWatcher&& aOther) noexcept
+{
+	std::swap( mDirectory, aOther.mDirectory );
+	std::swap( mNotifyFd, aOther.mNotifyFd );
+	return *this;
+}
+
+std::vector<std::string> FileWatcher::poll()
+{
+	std::vector<std::string> changed;
+	if( -1 == mNotifyFd )
+		return changed;
+
+	// Several events may arrive per read(); the buffer must be aligned for
+	// struct inotify_event.
+	alignas(inotify_event) char buffer[4096];
+
+	for( ;; )
+	{
+		auto const bytes = read( mNotifyFd, buffer, sizeof(buffer) );
+		if( bytes <= 0 )
+			break; // EAGAIN: no more events
+
+		for( char const* ptr = buffer; ptr < buffer + bytes; )
+		{
+			auto const* event = reinterpret_cast<inotify_event const*>(ptr);
+			ptr += sizeof(inotify_event) + event->len;
+
+			if( 0 == event->len )
+				continue;
+
+			std::string name( event->name ); // NUL padded
+			if( changed.end() == std::find( changed.begin(), changed.end(), name ) )
+				changed.emplace_back( std::move(name) );
+		}
+	}
+
+	return changed;
+}
+
+#else // !__linux__
+FileWatcher::FileWatcher( std::string aDirectory )
+	: mDirectory( std::move(aDirectory) )
+	, mLastScan( Clock_::now() )
+{
+	scan_( nullptr );
+}
+
+FileWatcher::~FileWatcher() = default;
+
+FileWatcher::FileWatcher( FileWatcher&& ) noexcept = default;
+FileWatcher& FileWatcher::operator= (FileWatcher&&) noexcept = default;
+
+std::vector<std::string> FileWatcher::poll()
+{
+	std::vector<std::string> changed;
+
+	auto const now = Clock_::now();
+	if( now - mLastScan < kScanInterval_ )
+		return changed;
+
+	mLastScan = now;
+	scan_( &changed );
+	return changed;
+}
+
+void FileWatcher::scan_( std::vector<std::string>* aChanged )
+{
+	std::error_code ec;
+	for( auto it = std::filesystem::directory_iterator( mDirectory, ec ); !ec && it != std::filesystem::directory_iterator(); it.increment( ec ) )
+	{
+		if( !it->is_regular_file( ec ) )
+			continue;
+
+		auto const time = it->last_write_time( ec );
+		if( ec )
+			continue;
+
+		auto name = it->path().filename().string();
+		auto const [entry, inserted] = mTimes.try_emplace( name, time );
+
+		if( !inserted && entry->second != time )
+		{
+			entry->second = time;
+			if( aChanged )
+				aChanged->emplace_back( std::move(name) );
+		}
+	}
+}
+#endif // ~ __linux__
+
+std::string const& FileWatcher::directory() const noexcept
+{
+	return mDirectory;
+}
@@ -0,0 +1,53 @@
+#ifndef FILE_WATCHER_HPP_D3A85F21_6C0B_4E97_A412_9B7E50C2F86D
+#define FILE_WATCHER_HPP_D3A85F21_6C0B_4E97_A412_9B7E50C2F86D
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+
+/* Reports files that change in a directory (not recursive)
+ *
+ * poll() never blocks, and returns the names (relative to the directory) of
+ * the files that were written or moved into it since the last call; each
+ * name is reported once per call. On Linux, this uses inotify, and only
+ * reports files once the writer has closed them. Elsewhere, the directory
+ * is rescanned for modification times at most a few times per second.
+ *
+ * Editors that save by writing a temporary file and renaming it over the
+ * original are covered by both (IN_MOVED_TO, or the new time stamp).
+ */
+class FileWatcher final
+{
+	public:
+		explicit FileWatcher( std::string aDirectory );
+		~FileWatcher();
+
+		FileWatcher( FileWatcher const& ) = delete;
+		FileWatcher& operator= (FileWatcher const&) = delete;
+
+		FileWatcher( FileWatcher&& ) noexcept;
+		FileWatcher& operator= (FileWatcher&&) noexcept;
+
+	public:
+		std::string const& directory() const noexcept;
+
+		std::vector<std::string> poll();
+
+	private:
+		std::string mDirectory;
+
+#		if defined(__linux__)
+		int mNotifyFd;
+#		else
+		using Clock_ = std::chrono::steady_clock;
+
+		void scan_( std::vector<std::string>* aChanged );
+
+		std::unordered_map<std::string,std::filesystem::file_time_type> mTimes;
+		Clock_::time_point mLastScan;
+#		endif
+};
+
+#endif // FILE_WATCHER_HPP_D3A85F21_6C0B_4E97_A412_9B7E50C2F86D
@@ -0,0 +1,743 @@
+#include "gl_trace.hpp"
+
+#if !defined(NDEBUG)
+#include <glad.h>
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+// Entry points that are traced. Entry points that are not listed here are
+// neither counted nor checked; add them as needed. Those that the driver
+// does not provide (extensions) are skipped by install_gl_trace().
+#define GL_TRACE_ENTRIES_(X)                                        \
+	X(glActiveTexture)                                              \
+	X(glAttachShader)                                               \
+	X(glBeginQuery)                                                 \
+	X(glBindBuffer)                                                 \
+	X(glBindBufferBase)                                             \
+	X(glBindBufferRange)                                            \
+	X(glBindFramebuffer)                                            \
+	X(glBindImageTexture)                                           \
+	X(glBindRenderbuffer)                                           \
+	X(glBindTexture)                                                \
+	X(glBindVertexArray)                                            \
+	X(glBindVertexBuffer)                                           \
+	X(glBlendFunc)                                                  \
+	X(glBufferData)                                                 \
+	X(glBufferStorage)                                              \
+	X(glBufferSubData)                                              \
+	X(glCheckFramebufferStatus)                                     \
+	X(glClear)                                                      \
+	X(glClearBufferSubData)                                         \
+	X(glClearColor)                                                 \
+	X(glClientWaitSync)                                             \
+	X(glColorMask)                                                  \
+	X(glCompileShader)                                              \
+	X(glCopyTexSubImage2D)                                          \
+	X(glCreateProgram)                                              \
+	X(glCreateShader)                                               \
+	X(glDeleteBuffers)                                              \
+	X(glDeleteFramebuffers)                                         \
+	X(glDeleteProgram)                                              \
+	X(glDeleteQueries)                                              \
+	X(glDeleteRenderbuffers)                                        \
+	X(glDeleteShader)                                               \
+	X(glDeleteSync)                                                 \
+	X(glDeleteTextures)                                             \
+	X(glDeleteVertexArrays)                                         \
+	X(glDepthFunc)                                                  \
+	X(glDepthMask)                                                  \
+	X(glDisable)                                                    \
+	X(glDispatchCompute)                                            \
+	X(glDrawArrays)                                                 \
+	X(glDrawArraysInstanced)                                        \
+	X(glDrawBuffers)                                                \
+	X(glDrawElements)                                               \
+	X(glDrawElementsInstanced)                                      \
+	X(glEnable)                                                     \
+	X(glEnableVertexAttribArray)                                    \
+	X(glEndQuery)                                                   \
+	X(glFenceSync)                                                  \
+	X(glFinish)                                                     \
+	X(glFlush)                                                      \
+	X(glFramebufferRenderbuffer)                                    \
+	X(glFramebufferTexture2D)                                       \
+	X(glGenBuffers)                                                 \
+	X(glGenFramebuffers)                                            \
+	X(glGenQueries)                                                 \
+	X(glGenRenderbuffers)                                           \
+	X(glGenTextures)                                                \
+	X(glGenVertexArrays)                                            \
+	X(glGenerateMipmap)                                             \
+	X(glGetError)                                                   \
+	X(glGetInteger64v)                                              \
+	X(glGetIntegerv)                                                \
+	X(glGetProgramBinary)                                           \
+	X(glGetProgramInfoLog)                                          \
+	X(glGetProgramInterfaceiv)                                      \
+	X(glGetProgramResourceName)                                     \
+	X(glGetProgramResourceiv)                                       \
+	X(glGetProgramiv)                                               \
+	X(glGetQueryObjectiv)                                           \
+	X(glGetQueryObjectui64v)                                        \
+	X(glGetQueryObjectuiv)                                          \
+	X(glGetShaderInfoLog)                                           \
+	X(glGetShaderiv)                                                \
+	X(glGetTexImage)                                                \
+	X(glLinkProgram)                                                \
+	X(glMapBufferRange)                                             \
+	X(glMemoryBarrier)                                              \
+	X(glMultiDrawElementsIndirect)                                  \
+	X(glMultiDrawElementsIndirectCountARB)                          \
+	X(glPatchParameteri)                                            \
+	X(glPixelStorei)                                                \
+	X(glPolygonMode)                                                \
+	X(glProgramBinary)                                              \
+	X(glProgramParameteri)                                          \
+	X(glProgramUniform1f)                                           \
+	X(glProgramUniform1i)                                           \
+	X(glProgramUniform2fv)                                          \
+	X(glProgramUniform3fv)                                          \
+	X(glProgramUniform4fv)                                          \
+	X(glProgramUniformMatrix4fv)                                    \
+	X(glQueryCounter)                                               \
+	X(glReadBuffer)                                                 \
+	X(glReadPixels)                                                 \
+	X(glRenderbufferStorage)                                        \
+	X(glShaderSource)                                               \
+	X(glTexImage2D)                                                 \
+	X(glTexParameterf)                                              \
+	X(glTexParameteri)                                              \
+	X(glTexStorage2D)                                               \
+	X(glTexSubImage2D)                                              \
+	X(glUnmapBuffer)                                                \
+	X(glUseProgram)                                                 \
+	X(glVertexAttribBinding)                                        \
+	X(glVertexAttribFormat)                                         \
+	X(glVertexAttribIFormat)                                        \
+	X(glVertexAttribPointer)                                        \
+	X(glVertexBindingDivisor)                                       \
+	X(glViewport)                                                   \
+	/*ENDM*/
+
+namespace
+{
+	enum Entry_ : std::size_t
+	{
+#		define GL_TRACE_ENUM_(name) entry_##name,
+		GL_TRACE_ENTRIES_(GL_TRACE_ENUM_)
+#		undef GL_TRACE_ENUM_
+
+		kEntryCount_
+	};
+
+	constexpr char const* kEntryNames_[kEntryCount_] = {
+#		define GL_TRACE_NAME_(name) #name,
+		GL_TRACE_ENTRIES_(GL_TRACE_NAME_)
+#		undef GL_TRACE_NAME_
+	};
+
+	// Redundant calls, by reason
+	enum class Redundancy_ : std::size_t
+	{
+		SameValue,
+		WastedUnbind,
+
+		Count
+	};
+
+	constexpr char const* kRedundancyNames_[std::size_t(Redundancy_::Count)] = {
+		"same value as before",
+		"bound 0, rebound before a draw"
+	};
+
+	// Kinds of state, combined with a target/index into a slot_() key
+	enum class Slot_ : std::uint64_t
+	{
+		Program = 1,
+		VertexArray,
+		Buffer,
+		IndexedBuffer,
+		ActiveTexture,
+		Texture,
+		DrawFramebuffer,
+		ReadFramebuffer,
+		Capability,
+		Uniform,
+		Fixed // Non-indexed state: depth mask, viewport, ...
+	};
+
+	struct Tracer_
+	{
+		bool installed = false;
+
+		std::uint64_t frames = 0;
+		std::array<std::uint64_t,kEntryCount_> frameCalls{};
+		std::array<std::uint64_t,kEntryCount_> totalCalls{};
+		std::array<std::uint64_t,kEntryCount_> maxCalls{};
+		std::array<std::array<std::uint64_t,std::size_t(Redundancy_::Count)>,kEntryCount_> redundant{};
+
+		// Last known value of each piece of state. Bindings are kept
+		// separately, as binding 0 has a meaning of its own.
+		std::unordered_map<std::uint64_t,GLuint> bindings;
+		std::unordered_map<std::uint64_t,std::vector<unsigned char>> values;
+
+		// Bindings to 0 since the last draw, and the entry point that made
+		// them
+		std::unordered_map<std::uint64_t,Entry_> unbinds;
+
+		GLenum activeTexture = GL_TEXTURE0;
+
+		std::vector<GLfloat> scratch;
+	};
+
+	Tracer_ gTracer_;
+
+	constexpr std::uint64_t slot_( Slot_ aKind, std::uint64_t aTarget = 0, std::uint64_t aIndex = 0 ) noexcept
+	{
+		return (std::uint64_t(aKind) << 56) ^ (aTarget << 24) ^ aIndex;
+	}
+
+	Slot_ slot_kind_( std::uint64_t aSlot ) noexcept
+	{
+		return Slot_(aSlot >> 56);
+	}
+
+	// The GL_ELEMENT_ARRAY_BUFFER binding is part of the bound VAO, so it is
+	// tracked per VAO. The other buffer bindings are global.
+	std::uint64_t buffer_slot_( GLenum aTarget )
+	{
+		if( GL_ELEMENT_ARRAY_BUFFER != aTarget )
+			return slot_( Slot_::Buffer, aTarget );
+
+		auto const vao = gTracer_.bindings.find( slot_( Slot_::VertexArray ) );
+		return slot_( Slot_::Buffer, aTarget, gTracer_.bindings.end() != vao ? vao->second : 0 );
+	}
+
+	void redundant_( Entry_ aEntry, Redundancy_ aReason ) noexcept
+	{
+		++gTracer_.redundant[aEntry][std::size_t(aReason)];
+	}
+
+	// Binding of an object to aSlot. With aZeroUnbinds, binding 0 unbinds
+	// (rather than binding e.g. the default framebuffer).
+	void bind_( Entry_ aEntry, std::uint64_t aSlot, GLuint aName, bool aZeroUnbinds = true )
+	{
+		auto const it = gTracer_.bindings.find( aSlot );
+		if( gTracer_.bindings.end() != it && it->second == aName )
+		{
+			redundant_( aEntry, Redundancy_::SameValue );
+			return;
+		}
+
+		if( aZeroUnbinds )
+		{
+			if( 0 == aName )
+				gTracer_.unbinds.emplace( aSlot, aEntry );
+			else if( auto const unbind = gTracer_.unbinds.find( aSlot ); gTracer_.unbinds.end() != unbind )
+			{
+				redundant_( unbind->second, Redundancy_::WastedUnbind );
+				gTracer_.unbinds.erase( unbind );
+			}
+		}
+
+		gTracer_.bindings[aSlot] = aName;
+	}
+
+	// Any other state: aSize bytes at aValue
+	void set_( Entry_ aEntry, std::uint64_t aSlot, void const* aValue, std::size_t aSize )
+	{
+		auto const* bytes = static_cast<unsigned char const*>(aValue);
+
+		auto& value = gTracer_.values[aSlot];
+		if( value.size() == aSize && std::equal( value.begin(), value.end(), bytes ) )
+		{
+			redundant_( aEntry, Redundancy_::SameValue );
+			return;
+		}
+
+		value.assign( bytes, bytes + aSize );
+	}
+
+	template< typename tValue >
+	void set_( Entry_ aEntry, std::uint64_t aSlot, tValue const& aValue )
+	{
+		set_( aEntry, aSlot, &aValue, sizeof(aValue) );
+	}
+
+	void draw_() noexcept
+	{
+		gTracer_.unbinds.clear();
+	}
+
+	// Deleted objects are no longer bound anywhere (their names may be
+	// reused by the next glGen*())
+	void forget_( Slot_ aKind, GLsizei aCount, GLuint const* aNames )
+	{
+		for( auto it = gTracer_.bindings.begin(); gTracer_.bindings.end() != it; )
+		{
+			bool const deleted = aKind == slot_kind_( it->first )
+				&& std::find( aNames, aNames + aCount, it->second ) != aNames + aCount;
+
+			if( deleted )
+			{
+				gTracer_.unbinds.erase( it->first );
+				it = gTracer_.bindings.erase( it );
+			}
+			else
+				++it;
+		}
+	}
+
+	void forget_uniforms_( GLuint aProgram )
+	{
+		for( auto it = gTracer_.values.begin(); gTracer_.values.end() != it; )
+		{
+			if( Slot_::Uniform == slot_kind_( it->first ) && aProgram == ((it->first >> 24) & 0xffffffffu) )
+				it = gTracer_.values.erase( it );
+			else
+				++it;
+		}
+	}
+
+	template< typename tValue >
+	void set_uniform_( Entry_ aEntry, GLuint aProgram, GLint aLocation, GLsizei aCount, tValue const* aValue, std::size_t aComponents )
+	{
+		if( aLocation < 0 || !aValue )
+			return;
+
+		set_( aEntry, slot_( Slot_::Uniform, aProgram, std::uint64_t(aLocation) ), aValue, sizeof(tValue) * aComponents * std::size_t(aCount) );
+	}
+
+	// Checks before each call of an entry point. Entry points without a
+	// specialization are only counted.
+	template< Entry_ >
+	struct Inspect_
+	{
+		template< typename... tArgs >
+		static void before( tArgs... ) noexcept
+		{}
+	};
+
+	template<> struct Inspect_<entry_glUseProgram>
+	{
+		static void before( GLuint aProgram )
+		{
+			bind_( entry_glUseProgram, slot_( Slot_::Program ), aProgram );
+		}
+	};
+	template<> struct Inspect_<entry_glBindVertexArray>
+	{
+		static void before( GLuint aVao )
+		{
+			bind_( entry_glBindVertexArray, slot_( Slot_::VertexArray ), aVao );
+		}
+	};
+	template<> struct Inspect_<entry_glBindBuffer>
+	{
+		static void before( GLenum aTarget, GLuint aBuffer )
+		{
+			bind_( entry_glBindBuffer, buffer_slot_( aTarget ), aBuffer );
+		}
+	};
+	template<> struct Inspect_<entry_glBindBufferBase>
+	{
+		static void before( GLenum aTarget, GLuint aIndex, GLuint aBuffer )
+		{
+			GLintptr const range[3] = { GLintptr(aBuffer), 0, -1 };
+			set_( entry_glBindBufferBase, slot_( Slot_::IndexedBuffer, aTarget, aIndex ), range );
+
+			// Also binds the generic binding point
+			gTracer_.bindings[slot_( Slot_::Buffer, aTarget )] = aBuffer;
+		}
+	};
+	template<> struct Inspect_<entry_glBindBufferRange>
+	{
+		static void before( GLenum aTarget, GLuint aIndex, GLuint aBuffer, GLintptr aOffset, GLsizeiptr aSize )
+		{
+			GLintptr const range[3] = { GLintptr(aBuffer), aOffset, GLintptr(aSize) };
+			set_( entry_glBindBufferRange, slot_( Slot_::IndexedBuffer, aTarget, aIndex ), range );
+
+			gTracer_.bindings[slot_( Slot_::Buffer, aTarget )] = aBuffer;
+		}
+	};
+	template<> struct Inspect_<entry_glActiveTexture>
+	{
+		static void before( GLenum aUnit )
+		{
+			set_( entry_glActiveTexture, slot_( Slot_::ActiveTexture ), aUnit );
+			gTracer_.activeTexture = aUnit;
+		}
+	};
+	template<> struct Inspect_<entry_glBindTexture>
+	{
+		static void before( GLenum aTarget, GLuint aTexture )
+		{
+			bind_( entry_glBindTexture, slot_( Slot_::Texture, aTarget, gTracer_.activeTexture ), aTexture );
+		}
+	};
+	template<> struct Inspect_<entry_glBindFramebuffer>
+	{
+		static void before( GLenum aTarget, GLuint aFramebuffer )
+		{
+			// 0 is the default framebuffer, not an unbind
+			auto const draw = slot_( Slot_::DrawFramebuffer );
+			auto const read = slot_( Slot_::ReadFramebuffer );
+
+			if( GL_FRAMEBUFFER == aTarget )
+			{
+				auto const d = gTracer_.bindings.find( draw ), r = gTracer_.bindings.find( read );
+				if( gTracer_.bindings.end() != d && gTracer_.bindings.end() != r && aFramebuffer == d->second && aFramebuffer == r->second )
+					redundant_( entry_glBindFramebuffer, Redundancy_::SameValue );
+
+				gTracer_.bindings[draw] = gTracer_.bindings[read] = aFramebuffer;
+			}
+			else
+			{
+				bind_( entry_glBindFramebuffer, GL_READ_FRAMEBUFFER == aTarget ? read : draw, aFramebuffer, false );
+			}
+		}
+	};
+	template<> struct Inspect_<entry_glEnable>
+	{
+		static void before( GLenum aCap )
+		{
+			set_( entry_glEnable, slot_( Slot_::Capability, aCap ), true );
+		}
+	};
+	template<> struct Inspect_<entry_glDisable>
+	{
+		static void before( GLenum aCap )
+		{
+			set_( entry_glDisable, slot_( Slot_::Capability, aCap ), false );
+		}
+	};
+	template<> struct Inspect_<entry_glDepthMask>
+	{
+		static void before( GLboolean aFlag )
+		{
+			set_( entry_glDepthMask, slot_( Slot_::Fixed, entry_glDepthMask ), aFlag );
+		}
+	};
+	template<> struct Inspect_<entry_glDepthFunc>
+	{
+		static void before( GLenum aFunc )
+		{
+			set_( entry_glDepthFunc, slot_( Slot_::Fixed, entry_glDepthFunc ), aFunc );
+		}
+	};
+	template<> struct Inspect_<entry_glColorMask>
+	{
+		static void before( GLboolean aR, GLboolean aG, GLboolean aB, GLboolean aA )
+		{
+			GLboolean const mask[4] = { aR, aG, aB, aA };
+			set_( entry_glColorMask, slot_( Slot_::Fixed, entry_glColorMask ), mask );
+		}
+	};
+	template<> struct Inspect_<entry_glBlendFunc>
+	{
+		static void before( GLenum aSrc, GLenum aDst )
+		{
+			GLenum const func[2] = { aSrc, aDst };
+			set_( entry_glBlendFunc, slot_( Slot_::Fixed, entry_glBlendFunc ), func );
+		}
+	};
+	template<> struct Inspect_<entry_glPolygonMode>
+	{
+		static void before( GLenum aFace, GLenum aMode )
+		{
+			set_( entry_glPolygonMode, slot_( Slot_::Fixed, entry_glPolygonMode, aFace ), aMode );
+		}
+	};
+	template<> struct Inspect_<entry_glViewport>
+	{
+		static void before( GLint aX, GLint aY, GLsizei aWidth, GLsizei aHeight )
+		{
+			GLint const viewport[4] = { aX, aY, aWidth, aHeight };
+			set_( entry_glViewport, slot_( Slot_::Fixed, entry_glViewport ), viewport );
+		}
+	};
+	template<> struct Inspect_<entry_glClearColor>
+	{
+		static void before( GLfloat aR, GLfloat aG, GLfloat aB, GLfloat aA )
+		{
+			GLfloat const color[4] = { aR, aG, aB, aA };
+			set_( entry_glClearColor, slot_( Slot_::Fixed, entry_glClearColor ), color );
+		}
+	};
+
+	template<> struct Inspect_<entry_glProgramUniform1f>
+	{
+		static void before( GLuint aProgram, GLint aLocation, GLfloat aValue )
+		{
+			set_uniform_( entry_glProgramUniform1f, aProgram, aLocation, 1, &aValue, 1 );
+		}
+	};
+	template<> struct Inspect_<entry_glProgramUniform1i>
+	{
+		static void before( GLuint aProgram, GLint aLocation, GLint aValue )
+		{
+			set_uniform_( entry_glProgramUniform1i, aProgram, aLocation, 1, &aValue, 1 );
+		}
+	};
+	template<> struct Inspect_<entry_glProgramUniform2fv>
+	{
+		static void before( GLuint aProgram, GLint aLocation, GLsizei aCount, GLfloat const* aValue )
+		{
+			set_uniform_( entry_glProgramUniform2fv, aProgram, aLocation, aCount, aValue, 2 );
+		}
+	};
+	template<> struct Inspect_<entry_glProgramUniform3fv>
+	{
+		static void before( GLuint aProgram, GLint aLocation, GLsizei aCount, GLfloat const* aValue )
+		{
+			set_uniform_( entry_glProgramUniform3fv, aProgram, aLocation, aCount, aValue, 3 );
+		}
+	};
+	template<> struct Inspect_<entry_glProgramUniform4fv>
+	{
+		static void before( GLuint aProgram, GLint aLocation, GLsizei aCount, GLfloat const* aValue )
+		{
+			set_uniform_( entry_glProgramUniform4fv, aProgram, aLocation, aCount, aValue, 4 );
+		}
+	};
+	template<> struct Inspect_<entry_glProgramUniformMatrix4fv>
+	{
+		static void before( GLuint aProgram, GLint aLocation, GLsizei aCount, GLboolean aTranspose, GLfloat const* aValue )
+		{
+			if( !aValue )
+				return;
+
+			// The same values, transposed, are a different matrix
+			auto& value = gTracer_.scratch;
+			value.assign( aValue, aValue + 16 * std::size_t(aCount) );
+			value.emplace_back( aTranspose ? 1.f : 0.f );
+
+			set_uniform_( entry_glProgramUniformMatrix4fv, aProgram, aLocation, 1, value.data(), value.size() );
+		}
+	};
+
+	// Relinking a program resets its uniforms
+	template<> struct Inspect_<entry_glLinkProgram>
+	{
+		static void before( GLuint aProgram )
+		{
+			forget_uniforms_( aProgram );
+		}
+	};
+	template<> struct Inspect_<entry_glProgramBinary>
+	{
+		static void before( GLuint aProgram, GLenum, void const*, GLsizei )
+		{
+			forget_uniforms_( aProgram );
+		}
+	};
+	template<> struct Inspect_<entry_glDeleteProgram>
+	{
+		static void before( GLuint aProgram )
+		{
+			forget_uniforms_( aProgram );
+		}
+	};
+
+	template<> struct Inspect_<entry_glDeleteVertexArrays>
+	{
+		static void before( GLsizei aCount, GLuint const* aNames )
+		{
+			forget_( Slot_::VertexArray, aCount, aNames );
+
+			// A new VAO that reuses the name starts without an index buffer
+			for( GLsizei i = 0; i < aCount; ++i )
+			{
+				auto const slot = slot_( Slot_::Buffer, GL_ELEMENT_ARRAY_BUFFER, aNames[i] );
+				gTracer_.bindings.erase( slot );
+				gTracer_.unbinds.erase( slot );
+			}
+		}
+	};
+	template<> struct Inspect_<entry_glDeleteBuffers>
+	{
+		static void before( GLsizei aCount, GLuint const* aNames )
+		{
+			forget_( Slot_::Buffer, aCount, aNames );
+
+			// Indexed bindings are stored as values
+			for( auto it = gTracer_.values.begin(); gTracer_.values.end() != it; )
+			{
+				GLintptr buffer = 0;
+				bool const indexed = Slot_::IndexedBuffer == slot_kind_( it->first );
+				if( indexed )
+					std::memcpy( &buffer, it->second.data(), sizeof(buffer) );
+
+				if( indexed && std::find( aNames, aNames + aCount, GLuint(buffer) ) != aNames + aCount )
+					it = gTracer_.values.erase( it );
+				else
+					++it;
+			}
+		}
+	};
+	template<> struct Inspect_<entry_glDeleteTextures>
+	{
+		static void before( GLsizei aCount, GLuint const* aNames )
+		{
+			forget_( Slot_::Texture, aCount, aNames );
+		}
+	};
+	template<> struct Inspect_<entry_glDeleteFramebuffers>
+	{
+		static void before( GLsizei aCount, GLuint const* aNames )
+		{
+			// Deleting the bound framebuffer binds the default one
+			for( auto const kind : { Slot_::DrawFramebuffer, Slot_::ReadFramebuffer } )
+			{
+				auto& bound = gTracer_.bindings[slot_( kind )];
+				if( std::find( aNames, aNames + aCount, bound ) != aNames + aCount )
+					bound = 0;
+			}
+		}
+	};
+
+	// Draws and dispatches consume the bindings made before them
+#	define GL_TRACE_DRAW_(name)                                     \
+	template<> struct Inspect_<entry_##name>                        \
+	{                                                               \
+		template< typename... tArgs >                               \
+		static void before( tArgs... ) noexcept                     \
+		{                                                           \
+			draw_();                                                \
+		}                                                           \
+	};                                                              \
+	/*ENDM*/
+
+	GL_TRACE_DRAW_(glDrawArrays)
+	GL_TRACE_DRAW_(glDrawArraysInstanced)
+	GL_TRACE_DRAW_(glDrawElements)
+	GL_TRACE_DRAW_(glDrawElementsInstanced)
+	GL_TRACE_DRAW_(glMultiDrawElementsIndirect)
+	GL_TRACE_DRAW_(glMultiDrawElementsIndirectCountARB)
+	GL_TRACE_DRAW_(glDispatchCompute)
+
+#	undef GL_TRACE_DRAW_
+
+	// Replacement for the glad function pointer of entry point tEntry
+	template< Entry_ tEntry, typename tFn >
+	struct Hook_;
+
+	template< Entry_ tEntry, typename tRet, typename... tArgs >
+	struct Hook_< tEntry, tRet (GLAPIENTRY*)( tArgs... ) >
+	{
+		static inline tRet (GLAPIENTRY* original)( tArgs... ) = nullptr;
+
+		static tRet GLAPIENTRY call( tArgs... aArgs )
+		{
+			++gTracer_.frameCalls[tEntry];
+			Inspect_<tEntry>::before( aArgs... );
+
+			return original( aArgs... );
+		}
+	};
+
+	struct Ranked_
+	{
+		std::uint64_t count;
+		std::size_t entry;
+		std::size_t reason;
+	};
+}
+
+void install_gl_trace()
+{
+	if( gTracer_.installed )
+		return;
+
+	// Entry points that the driver does not provide stay null
+#	define GL_TRACE_INSTALL_(name)                                  \
+	if( glad_##name )                                               \
+	{                                                               \
+		using Hook = Hook_<entry_##name, decltype(glad_##name)>;    \
+		Hook::original = glad_##name;                               \
+		glad_##name = &Hook::call;                                  \
+	}                                                               \
+	/*ENDM*/
+
+	GL_TRACE_ENTRIES_(GL_TRACE_INSTALL_)
+
+#	undef GL_TRACE_INSTALL_
+
+	gTracer_.installed = true;
+}
+
+void end_gl_trace_frame() noexcept
+{
+	if( !gTracer_.installed )
+		return;
+
+	for( std::size_t i = 0; i < kEntryCount_; ++i )
+	{
+		gTracer_.totalCalls[i] += gTracer_.frameCalls[i];
+		gTracer_.maxCalls[i] = std::max( gTracer_.maxCalls[i], gTracer_.frameCalls[i] );
+	}
+
+	gTracer_.frameCalls.fill( 0 );
+	++gTracer_.frames;
+}
+
+void print_gl_trace( std::FILE* aOut, std::size_t aTopEntries )
+{
+	assert( aOut );
+
+	if( 0 == gTracer_.frames )
+		return;
+
+	auto const frames = double(gTracer_.frames);
+
+	std::vector<Ranked_> calls, redundant;
+	std::uint64_t totalCalls = 0, totalRedundant = 0;
+
+	for( std::size_t i = 0; i < kEntryCount_; ++i )
+	{
+		totalCalls += gTracer_.totalCalls[i];
+		if( gTracer_.totalCalls[i] > 0 )
+			calls.emplace_back( Ranked_{ gTracer_.totalCalls[i], i, 0 } );
+
+		for( std::size_t j = 0; j < std::size_t(Redundancy_::Count); ++j )
+		{
+			totalRedundant += gTracer_.redundant[i][j];
+			if( gTracer_.redundant[i][j] > 0 )
+				redundant.emplace_back( Ranked_{ gTracer_.redundant[i][j], i, j } );
+		}
+	}
+
+	auto const byCount = [] (Ranked_ const& aA, Ranked_ const& aB) {
+		return aA.count > aB.count;
+	};
+	std::sort( calls.begin(), calls.end(), byCount );
+	std::sort( redundant.begin(), redundant.end(), byCount );
+
+	std::fprintf( aOut, "GL calls: %.1f per frame over %llu frames, %.1f redundant\n", double(totalCalls) / frames, static_cast<unsigned long long>(gTracer_.frames), double(totalRedundant) / frames );
+
+	std::fprintf( aOut, "  %-40s %10s %10s\n", "entry point", "per frame", "max" );
+	for( std::size_t i = 0; i < std::min( aTopEntries, calls.size() ); ++i )
+	{
+		auto const& call = calls[i];
+		std::fprintf( aOut, "  %-40s %10.1f %10llu\n", kEntryNames_[call.entry], double(call.count) / frames, static_cast<unsigned long long>(gTracer_.maxCalls[call.entry]) );
+	}
+
+	if( redundant.empty() )
+		return;
+
+	std::fprintf( aOut, "  Redundant calls:\n" );
+	std::fprintf( aOut, "  %-40s %10s  %s\n", "entry point", "per frame", "reason" );
+	for( std::size_t i = 0; i < std::min( aTopEntries, redundant.size() ); ++i )
+	{
+		auto const& call = redundant[i];
+		std::fprintf( aOut, "  %-40s %10.1f  %s\n", kEntryNames_[call.entry], double(call.count) / frames, kRedundancyNames_[call.reason] );
+	}
+}
+#endif // ~ !NDEBUG
@@ -0,0 +1,54 @@
+#ifndef GL_TRACE_HPP_6E1D9A47_0B3C_4F25_8C7E_F45A2B91D083
+#define GL_TRACE_HPP_6E1D9A47_0B3C_4F25_8C7E_F45A2B91D083
+
+#include <cstdio>
+#include <cstddef>
+
+/* GL call tracing (debug builds only)
+ *
+ * install_gl_trace() replaces the glad function pointers of the GL entry
+ * points that this program uses with wrappers that count the calls of each
+ * entry point, and that detect redundant state changes:
+ *
+ *  - binding the object that is already bound (program, VAO, buffer,
+ *    texture, framebuffer), or enabling a capability that is already
+ *    enabled, and so on;
+ *  - setting a uniform to the value that it already has;
+ *  - binding 0, and then binding another object to the same point before
+ *    anything was drawn (the unbind was wasted).
+ *
+ * State that was set before install_gl_trace() is unknown to the tracer, so
+ * the first change of each piece of state is never reported as redundant.
+ *
+ * end_gl_trace_frame() ends a frame; print_gl_trace() lists the entry
+ * points with the most calls per frame, and the most frequent redundant
+ * calls. The tracer is not thread safe, which matches the rest of the GL
+ * code.
+ *
+ * In release builds (NDEBUG), these functions are empty inline functions,
+ * and the glad function pointers are never touched.
+ */
+#if !defined(NDEBUG)
+constexpr bool kGlTraceAvailable = true;
+
+// Call after gladLoadGLLoader(). Does nothing when called again.
+void install_gl_trace();
+
+void end_gl_trace_frame() noexcept;
+
+void print_gl_trace( std::FILE*, std::size_t aTopEntries = 15 );
+
+#else // NDEBUG
+constexpr bool kGlTraceAvailable = false;
+
+inline void install_gl_trace() noexcept
+{}
+
+inline void end_gl_trace_frame() noexcept
+{}
+
+inline void print_gl_trace( std::FILE*, std::size_t = 15 ) noexcept
+{}
+#endif // ~ NDEBUG
+
+#endif // GL_TRACE_HPP_6E1D9A47_0B3C_4F25_8C7E_F45A2B91D083
@@ -0,0 +1,15 @@
+#include "hash.hpp"
+
+std::uint64_t hash_bytes( void const* aData, std::size_t aSize, std::uint64_t aSeed ) noexcept
+{
+	auto const* bytes = static_cast<unsigned char const*>(aData);
+
+	std::uint64_t hash = aSeed;
+	for( std::size_t i = 0; i < aSize; ++i )
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
@@ -0,0 +1,13 @@
+#ifndef HASH_HPP_E5D16CCB_1491_40A2_BB00_2854CF275E51
+#define HASH_HPP_E5D16CCB_1491_40A2_BB00_2854CF275E51
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a. Chain calls by passing the previous result as aSeed.
+// Fast and good enough for hash tables and cache keys; not cryptographic.
+constexpr std::uint64_t kFnv1aOffsetBasis = 0xcbf29ce484222325ull;
+
+std::uint64_t hash_bytes( void const* aData, std::size_t aSize, std::uint64_t aSeed = kFnv1aOffsetBasis ) noexcept;
+
+#endif // HASH_HPP_E5D16CCB_1491_40A2_BB00_2854CF275E51
@@ -0,0 +1,449 @@
+#include "profiler.hpp"
+
+#include <atomic>
+#include <algorithm>
+#include <utility>
+
+#include <cmath>
+#include <cassert>
+#include <cstring>
+
+#include "checkpoint.hpp"
+
+// Single-producer, single-consumer ring: the owning thread appends at head,
+// begin_frame() consumes from tail on the main thread.
+struct Profiler::ThreadRing_
+{
+	std::uint64_t profilerId;
+	std::uint32_t tid;
+	std::uint32_t depth; // Owning thread only
+
+	std::atomic<std::size_t> head{ 0 };
+	std::atomic<std::size_t> tail{ 0 };
+	std::atomic<std::size_t> dropped{ 0 };
+
+	std::array<CpuEvent_,kThreadRingSize> events;
+};
+
+namespace
+{
+	// Identifies a Profiler in thread_local data, even if a later Profiler
+	// happens to reuse the address of an earlier one.
+	std::atomic<std::uint64_t> gNextProfilerId_{ 1 };
+
+	struct ThreadRingRef_
+	{
+		std::uint64_t profilerId = 0;
+		void* ring = nullptr;
+	};
+
+	thread_local ThreadRingRef_ tThreadRing_;
+}
+
+Profiler::Profiler( std::size_t aTraceCapacity )
+	: mId( gNextProfilerId_.fetch_add( 1 ) )
+	, mEpoch( std::chrono::steady_clock::now() )
+	, mGpuFrame( 0 )
+	, mGpuDepth( 0 )
+	, mTraceCapacity( aTraceCapacity )
+	, mDroppedGpu( 0 )
+{
+	// Storage is allocated up front, so that profiling does not allocate
+	// in the steady state (except when a new scope name is first seen).
+	for( auto& frame : mGpuFrames )
+	{
+		frame.queries.resize( 2 * kMaxGpuScopesPerFrame );
+		glGenQueries( GLsizei(frame.queries.size()), frame.queries.data() );
+
+		frame.scopes.resize( kMaxGpuScopesPerFrame );
+		frame.used = 0;
+		frame.lastQuery = 0;
+		frame.gpuToCpuNs = 0;
+	}
+
+	mTrace.reserve( mTraceCapacity );
+	mSortScratch.reserve( kStatsWindow );
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+Profiler::~Profiler()
+{
+	for( auto& frame : mGpuFrames )
+		glDeleteQueries( GLsizei(frame.queries.size()), frame.queries.data() );
+}
+
+void Profiler::begin_frame()
+{
+	collect_cpu_();
+
+	// Reuse the oldest set of queries. Its results are read now if they are
+	// available, and are dropped otherwise.
+	mGpuFrame = (mGpuFrame + 1) % kGpuFramesInFlight;
+
+	auto& frame = mGpuFrames[mGpuFrame];
+	collect_gpu_( frame );
+
+	// Maps GPU timestamps onto the CPU timeline of the trace. Querying
+	// GL_TIMESTAMP does not wait for the GPU.
+	GLint64 gpuNow = 0;
+	glGetInteger64v( GL_TIMESTAMP, &gpuNow );
+	frame.gpuToCpuNs = std::int64_t(now_ns_()) - gpuNow;
+
+	assert( 0 == mGpuDepth );
+	OGL_CHECKPOINT_DEBUG();
+}
+
+std::vector<Profiler::ScopeStats> Profiler::statistics( std::size_t aLastSamples ) const
+{
+	std::vector<ScopeStats> ret;
+	statistics( ret, aLastSamples );
+	return ret;
+}
+
+void Profiler::statistics( std::vector<ScopeStats>& aStats, std::size_t aLastSamples ) const
+{
+	aStats.clear();
+
+	auto& sorted = mSortScratch;
+	for( auto const& samples : mSamples )
+	{
+		if( samples.ms.empty() || 0 == aLastSamples )
+			continue;
+
+		// The newest sample is the one before next (which is also the number
+		// of samples while the window has not wrapped around yet).
+		auto const size = samples.ms.size();
+		auto const count = std::min( aLastSamples, size );
+
+		sorted.clear();
+		for( std::size_t i = 0; i < count; ++i )
+			sorted.emplace_back( samples.ms[(samples.next + size - 1 - i) % size] );
+
+		std::sort( sorted.begin(), sorted.end() );
+
+		double sum = 0.0;
+		for( auto const ms : sorted )
+			sum += double(ms);
+
+		double allocations = 0.0, allocBytes = 0.0;
+		for( std::size_t i = 0; i < count && !samples.allocs.empty(); ++i )
+		{
+			auto const& allocs = samples.allocs[(samples.next + size - 1 - i) % size];
+			allocations += double(allocs.allocations);
+			allocBytes += double(allocs.bytes);
+		}
+
+		ScopeStats stats{};
+		stats.name = samples.name;
+		stats.track = samples.track;
+		stats.depth = samples.depth;
+		stats.samples = sorted.size();
+		stats.minMs = sorted.front();
+		stats.avgMs = float(sum / double(sorted.size()));
+		stats.maxMs = sorted.back();
+		stats.p50Ms = percentile( sorted, 50.f );
+		stats.p95Ms = percentile( sorted, 95.f );
+		stats.p99Ms = percentile( sorted, 99.f );
+		stats.avgAllocations = float(allocations / double(count));
+		stats.avgAllocBytes = float(allocBytes / double(count));
+		aStats.emplace_back( stats );
+	}
+}
+
+void Profiler::print_statistics( std::FILE* aOut ) const
+{
+	std::fprintf( aOut, "Profile (last %zu samples per scope, ms):\n", kStatsWindow );
+	std::fprintf( aOut, "  %-36s %7s %8s %8s %8s %8s %8s %8s %8s\n", "scope", "samples", "min", "avg", "max", "p50", "p95", "p99", "allocs" );
+
+	for( auto const& stats : statistics() )
+	{
+		// Nested scopes are indented below their parents
+		char name[64];
+		std::snprintf( name, sizeof(name), "%*s%s %s", int(2 * stats.depth), "", Track::Gpu == stats.track ? "GPU" : "CPU", stats.name );
+
+		std::fprintf( aOut, "  %-36s %7zu %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f", name, stats.samples, double(stats.minMs), double(stats.avgMs), double(stats.maxMs), double(stats.p50Ms), double(stats.p95Ms), double(stats.p99Ms) );
+
+		// Allocations per sample
+		if( Track::Cpu == stats.track )
+			std::fprintf( aOut, " %8.1f\n", double(stats.avgAllocations) );
+		else
+			std::fprintf( aOut, " %8s\n", "-" );
+	}
+
+	if( auto const dropped = dropped_events() )
+		std::fprintf( aOut, "  (%zu events dropped)\n", dropped );
+}
+
+bool Profiler::write_chrome_trace( char const* aPath ) const
+{
+	std::FILE* fout = std::fopen( aPath, "wb" );
+	if( !fout )
+		return false;
+
+	std::fprintf( fout, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+
+	// Track names
+	std::fprintf( fout, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}" );
+	{
+		std::lock_guard<std::mutex> lock( mThreadsMutex );
+		for( auto const& ring : mThreads )
+			std::fprintf( fout, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"CPU thread %u\"}}", ring->tid, ring->tid-1 );
+	}
+
+	// Complete events, in microseconds
+	for( auto const& event : mTrace )
+	{
+		std::fprintf( fout, ",\n{\"name\":" );
+		write_json_string( fout, event.name );
+		std::fprintf( fout, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			0 == event.tid ? "gpu" : "cpu",
+			event.tid,
+			double(event.beginNs) * 1e-3,
+			double(event.endNs - event.beginNs) * 1e-3
+		);
+	}
+
+	std::fprintf( fout, "\n]}\n" );
+
+	return 0 == std::fclose( fout );
+}
+
+std::size_t Profiler::dropped_events() const noexcept
+{
+	std::size_t dropped = mDroppedGpu;
+
+	std::lock_guard<std::mutex> lock( mThreadsMutex );
+	for( auto const& ring : mThreads )
+		dropped += ring->dropped.load( std::memory_order_relaxed );
+
+	return dropped;
+}
+
+std::uint64_t Profiler::now_ns_() const noexcept
+{
+	return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - mEpoch ).count());
+}
+
+Profiler::ThreadRing_* Profiler::thread_ring_()
+{
+	if( mId == tThreadRing_.profilerId )
+		return static_cast<ThreadRing_*>(tThreadRing_.ring);
+
+	// First scope of this thread
+	auto ring = std::make_unique<ThreadRing_>();
+	ring->profilerId = mId;
+	ring->depth = 0;
+
+	auto* const ret = ring.get();
+	{
+		std::lock_guard<std::mutex> lock( mThreadsMutex );
+		ring->tid = std::uint32_t(mThreads.size() + 1);
+		mThreads.emplace_back( std::move(ring) );
+	}
+
+	tThreadRing_.profilerId = mId;
+	tThreadRing_.ring = ret;
+	return ret;
+}
+
+void Profiler::collect_cpu_()
+{
+	std::lock_guard<std::mutex> lock( mThreadsMutex );
+	for( auto const& ring : mThreads )
+	{
+		auto const tail = ring->tail.load( std::memory_order_relaxed );
+		auto const head = ring->head.load( std::memory_order_acquire );
+
+		for( auto i = tail; i != head; ++i )
+		{
+			auto const& event = ring->events[i % kThreadRingSize];
+			record_( event.name, Track::Cpu, event.depth, event.beginNs, event.endNs, ring->tid, event.allocs );
+		}
+
+		ring->tail.store( head, std::memory_order_release );
+	}
+}
+
+void Profiler::collect_gpu_( GpuFrame_& aFrame )
+{
+	if( 0 == aFrame.used )
+		return;
+
+	// Timestamps complete in the order in which they were issued, so the
+	// last one covers all of them. That is not the end of the last scope:
+	// outer scopes end after their nested scopes.
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv( aFrame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available );
+
+	if( GL_TRUE == available )
+	{
+		for( std::size_t i = 0; i < aFrame.used; ++i )
+		{
+			GLuint64 begin = 0, end = 0;
+			glGetQueryObjectui64v( aFrame.queries[2*i+0], GL_QUERY_RESULT, &begin );
+			glGetQueryObjectui64v( aFrame.queries[2*i+1], GL_QUERY_RESULT, &end );
+
+			auto const beginNs = std::uint64_t(std::max<std::int64_t>( std::int64_t(begin) + aFrame.gpuToCpuNs, 0 ));
+			auto const& scope = aFrame.scopes[i];
+			record_( scope.name, Track::Gpu, scope.depth, beginNs, beginNs + (end - begin), 0 );
+		}
+	}
+	else
+	{
+		mDroppedGpu += aFrame.used;
+	}
+
+	aFrame.used = 0;
+	aFrame.lastQuery = 0;
+}
+
+void Profiler::record_( char const* aName, Track aTrack, std::uint32_t aDepth, std::uint64_t aBeginNs, std::uint64_t aEndNs, std::uint32_t aTid, AllocCounters const& aAllocs )
+{
+	// Few scopes, so a linear search is fine. The same literal may have
+	// different addresses in different translation units.
+	auto it = std::find_if( mSamples.begin(), mSamples.end(), [&] (Samples_ const& aSamples) {
+		return aSamples.track == aTrack && (aSamples.name == aName || 0 == std::strcmp( aSamples.name, aName ));
+	} );
+
+	if( mSamples.end() == it )
+	{
+		Samples_ samples{ aName, aTrack, aDepth, {}, {}, 0 };
+		samples.ms.reserve( kStatsWindow );
+		if( Track::Cpu == aTrack )
+			samples.allocs.reserve( kStatsWindow );
+		it = mSamples.emplace( mSamples.end(), std::move(samples) );
+	}
+
+	float const ms = float(double(aEndNs - aBeginNs) * 1e-6);
+	if( it->ms.size() < kStatsWindow )
+		it->ms.emplace_back( ms );
+	else
+		it->ms[it->next] = ms;
+
+	if( Track::Cpu == aTrack )
+	{
+		if( it->allocs.size() < kStatsWindow )
+			it->allocs.emplace_back( aAllocs );
+		else
+			it->allocs[it->next] = aAllocs;
+	}
+
+	it->next = (it->next + 1) % kStatsWindow;
+
+	if( mTrace.size() < mTraceCapacity )
+		mTrace.emplace_back( TraceEvent_{ aName, aBeginNs, aEndNs, aTid } );
+}
+
+std::int32_t Profiler::begin_gpu_( char const* aName ) noexcept
+{
+	auto& frame = mGpuFrames[mGpuFrame];
+	if( frame.used == kMaxGpuScopesPerFrame )
+	{
+		++mDroppedGpu;
+		return -1;
+	}
+
+	auto const index = frame.used++;
+	frame.scopes[index] = GpuScope_{ aName, mGpuDepth++ };
+	frame.lastQuery = frame.queries[2*index+0];
+	glQueryCounter( frame.lastQuery, GL_TIMESTAMP );
+
+	return std::int32_t(index);
+}
+
+void Profiler::end_gpu_( std::int32_t aIndex ) noexcept
+{
+	if( aIndex < 0 )
+		return;
+
+	assert( mGpuDepth > 0 );
+	--mGpuDepth;
+
+	auto& frame = mGpuFrames[mGpuFrame];
+	frame.lastQuery = frame.queries[2*std::size_t(aIndex)+1];
+	glQueryCounter( frame.lastQuery, GL_TIMESTAMP );
+}
+
+
+ProfileScope::ProfileScope( Profiler* aProfiler, char const* aName )
+	: mRing( aProfiler ? aProfiler->thread_ring_() : nullptr )
+	, mName( aName )
+	, mBeginNs( aProfiler ? aProfiler->now_ns_() : 0 )
+	, mAllocBegin( aProfiler ? thread_alloc_counters() : AllocCounters{} )
+	, mProfiler( aProfiler )
+{
+	if( mRing )
+		++mRing->depth;
+}
+
+ProfileScope::~ProfileScope()
+{
+	end();
+}
+
+void ProfileScope::end() noexcept
+{
+	if( !mRing )
+		return;
+
+	auto const endNs = mProfiler->now_ns_();
+	auto const depth = --mRing->depth;
+
+	auto const head = mRing->head.load( std::memory_order_relaxed );
+	if( head - mRing->tail.load( std::memory_order_acquire ) < Profiler::kThreadRingSize )
+	{
+		mRing->events[head % Profiler::kThreadRingSize] = Profiler::CpuEvent_{ mName, mBeginNs, endNs, depth, thread_alloc_counters() - mAllocBegin };
+		mRing->head.store( head + 1, std::memory_order_release );
+	}
+	else
+	{
+		mRing->dropped.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	mRing = nullptr;
+}
+
+
+GpuProfileScope::GpuProfileScope( Profiler* aProfiler, char const* aName ) noexcept
+	: mProfiler( aProfiler )
+	, mIndex( aProfiler ? aProfiler->begin_gpu_( aName ) : -1 )
+{}
+
+GpuProfileScope::~GpuProfileScope()
+{
+	end();
+}
+
+void GpuProfileScope::end() noexcept
+{
+	if( mProfiler )
+		mProfiler->end_gpu_( mIndex );
+
+	mProfiler = nullptr;
+}
+
+
+float percentile( std::vector<float> const& aSorted, float aPercent ) noexcept
+{
+	assert( !aSorted.empty() );
+
+	// Smallest value with at least aPercent percent of the values at or
+	// below it: rank ceil(P/100 * N), clamped to [1, N]
+	auto const rank = std::size_t(std::ceil( aPercent / 100.f * float(aSorted.size()) ));
+	return aSorted[std::clamp( rank, std::size_t(1), aSorted.size() ) - 1];
+}
+
+void write_json_string( std::FILE* aOut, char const* aString )
+{
+	std::fputc( '"', aOut );
+	for( char const* ch = aString; *ch; ++ch )
+	{
+		if( '"' == *ch || '\\' == *ch )
+			std::fputc( '\\', aOut );
+
+		if( static_cast<unsigned char>(*ch) >= 0x20 )
+			std::fputc( *ch, aOut );
+	}
+	std::fputc( '"', aOut );
+}
@@ -0,0 +1,225 @@
+#ifndef PROFILER_HPP_4B8E2D17_C95A_4F03_A6D1_E072B39C5F84
+#define PROFILER_HPP_4B8E2D17_C95A_4F03_A6D1_E072B39C5F84
+
+#include <glad.h>
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+#include "alloc_tracker.hpp"
+
+/* Frame profiler with nested CPU and GPU scopes
+ *
+ * CPU scopes (ProfileScope) may be opened on any thread. Each thread writes
+ * its finished scopes into its own single-producer ring buffer, without
+ * locking; begin_frame() drains the rings on the main thread. If a ring
+ * fills up between two frames, events are dropped (dropped_events()).
+ *
+ * GPU scopes (GpuProfileScope, GL thread only) write GL_TIMESTAMP queries
+ * with glQueryCounter(), which, unlike GL_TIME_ELAPSED, may be nested. Each
+ * frame has its own set of queries, and results are read kGpuFramesInFlight
+ * frames later, once they are available; results that are still not
+ * available are dropped instead of waiting for the GPU.
+ *
+ * Each scope keeps its durations over the last kStatsWindow samples, from
+ * which statistics() computes the minimum, average, maximum and the 50th,
+ * 95th and 99th percentiles. CPU scopes also count the heap allocations
+ * made by their thread (see alloc_tracker.hpp), nested scopes included,
+ * which statistics() averages over the same samples.
+ *
+ * With a non-zero aTraceCapacity, the first aTraceCapacity scopes are also
+ * kept for write_chrome_trace(), which writes the Chrome trace event format
+ * (chrome://tracing, Perfetto).
+ *
+ * Scope names must be string literals (or otherwise outlive the Profiler).
+ * Scopes with a null Profiler do nothing, so that profiling can be turned
+ * off without changing the instrumented code.
+ */
+class Profiler final
+{
+	public:
+		static constexpr std::size_t kGpuFramesInFlight = 3;
+		static constexpr std::size_t kMaxGpuScopesPerFrame = 128;
+		static constexpr std::size_t kThreadRingSize = 4096;
+		static constexpr std::size_t kStatsWindow = 512;
+
+		enum class Track : std::uint8_t
+		{
+			Cpu,
+			Gpu
+		};
+
+		struct ScopeStats
+		{
+			char const* name;
+			Track track;
+			std::uint32_t depth; // Nesting depth when the scope was first seen
+
+			std::size_t samples;
+			float minMs, avgMs, maxMs;
+			float p50Ms, p95Ms, p99Ms;
+
+			float avgAllocations, avgAllocBytes; // CPU scopes only
+		};
+
+	public:
+		explicit Profiler( std::size_t aTraceCapacity = 0 );
+		~Profiler();
+
+		Profiler( Profiler const& ) = delete;
+		Profiler& operator= (Profiler const&) = delete;
+
+	public:
+		// Main (GL) thread, once per frame, before any GPU scope of the frame
+		void begin_frame();
+
+		// Scopes in the order in which they were first seen, over the last
+		// aLastSamples samples of each (at most kStatsWindow)
+		std::vector<ScopeStats> statistics( std::size_t aLastSamples = kStatsWindow ) const;
+
+		// Same, into aStats (replacing its contents). Does not allocate
+		// unless new scopes were seen since the last call with aStats.
+		void statistics( std::vector<ScopeStats>& aStats, std::size_t aLastSamples = kStatsWindow ) const;
+		void print_statistics( std::FILE* ) const;
+
+		bool write_chrome_trace( char const* aPath ) const;
+
+		std::size_t dropped_events() const noexcept;
+
+	private:
+		friend class ProfileScope;
+		friend class GpuProfileScope;
+
+		struct CpuEvent_
+		{
+			char const* name;
+			std::uint64_t beginNs, endNs;
+			std::uint32_t depth;
+
+			AllocCounters allocs;
+		};
+
+		struct ThreadRing_;
+
+		struct GpuScope_
+		{
+			char const* name;
+			std::uint32_t depth;
+		};
+
+		struct GpuFrame_
+		{
+			std::vector<GLuint> queries; // Begin and end of each scope
+			std::vector<GpuScope_> scopes;
+			std::size_t used;
+			GLuint lastQuery; // Most recently issued; 0 if none
+			std::int64_t gpuToCpuNs;
+		};
+
+		struct Samples_
+		{
+			char const* name;
+			Track track;
+			std::uint32_t depth;
+
+			std::vector<float> ms; // Ring of kStatsWindow
+			std::vector<AllocCounters> allocs; // Same ring; CPU scopes only
+			std::size_t next;
+		};
+
+		struct TraceEvent_
+		{
+			char const* name;
+			std::uint64_t beginNs, endNs;
+			std::uint32_t tid; // 0 = GPU, CPU threads from 1
+		};
+
+		std::uint64_t now_ns_() const noexcept;
+		ThreadRing_* thread_ring_();
+
+		void collect_cpu_();
+		void collect_gpu_( GpuFrame_& );
+		void record_( char const* aName, Track, std::uint32_t aDepth, std::uint64_t aBeginNs, std::uint64_t aEndNs, std::uint32_t aTid, AllocCounters const& = AllocCounters{} );
+
+		std::int32_t begin_gpu_( char const* aName ) noexcept;
+		void end_gpu_( std::int32_t ) noexcept;
+
+	private:
+		std::uint64_t mId; // Identifies the thread rings of this Profiler
+		std::chrono::steady_clock::time_point mEpoch;
+
+		mutable std::mutex mThreadsMutex; // Only for registering threads
+		std::vector<std::unique_ptr<ThreadRing_>> mThreads;
+
+		std::array<GpuFrame_,kGpuFramesInFlight> mGpuFrames;
+		std::size_t mGpuFrame;
+		std::uint32_t mGpuDepth;
+
+		std::vector<Samples_> mSamples;
+		mutable std::vector<float> mSortScratch; // statistics() only
+
+		std::size_t mTraceCapacity;
+		std::vector<TraceEvent_> mTrace;
+
+		std::size_t mDroppedGpu;
+};
+
+/* CPU scope: records the time from construction to end() or destruction,
+ * whichever comes first. end() allows closing a scope early in code that
+ * does not nest well (e.g., the sections of a long function).
+ */
+class ProfileScope final
+{
+	public:
+		ProfileScope( Profiler*, char const* aName );
+		~ProfileScope();
+
+		ProfileScope( ProfileScope const& ) = delete;
+		ProfileScope& operator= (ProfileScope const&) = delete;
+
+	public:
+		void end() noexcept;
+
+	private:
+		Profiler::ThreadRing_* mRing;
+		char const* mName;
+		std::uint64_t mBeginNs;
+		AllocCounters mAllocBegin;
+		Profiler* mProfiler;
+};
+
+// GPU scope: the GPU time between the commands issued before construction
+// and before end() or destruction. GL thread only.
+class GpuProfileScope final
+{
+	public:
+		GpuProfileScope( Profiler*, char const* aName ) noexcept;
+		~GpuProfileScope();
+
+		GpuProfileScope( GpuProfileScope const& ) = delete;
+		GpuProfileScope& operator= (GpuProfileScope const&) = delete;
+
+	public:
+		void end() noexcept;
+
+	private:
+		Profiler* mProfiler;
+		std::int32_t mIndex;
+};
+
+
+// Nearest-rank percentile (0..100) of sorted values. aSorted must not be
+// empty.
+float percentile( std::vector<float> const& aSorted, float aPercent ) noexcept;
+
+// Writes aString as a quoted JSON string. Control characters are dropped.
+void write_json_string( std::FILE*, char const* aString );
+
+#endif // PROFILER_HPP_4B8E2D17_C95A_4F03_A6D1_E072B39C5F84
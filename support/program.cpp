@@ -2,22 +2,51 @@
 
 #include <vector>
 #include <utility>
+#include <algorithm>
+#include <filesystem>
 
 #include <cstdio>
+#include <cassert>
+#include <cstring>
 
 #include <glad.h>
 #include <GLFW/glfw3.h>
 
 #include "error.hpp"
+#include "hash.hpp"
 #include "checkpoint.hpp"
+#include "program_cache.hpp"
+
+#if !defined(GL_COMPLETION_STATUS_KHR)
+#	define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 namespace
 {
-	GLuint load_shader_( 
+	std::vector<GLchar> read_source_( char const* aSourcePath );
+
+	// Applies the defines and resolves #include. aFiles receives the paths of
+	// the main file and its includes, indexed by source string number.
+	std::vector<GLchar> preprocess_source_(
+		std::string const& aSourcePath,
+		std::vector<std::string> const& aDefines,
+		std::vector<std::string>& aFiles
+	);
+
+	// Only issues the compile. check_shader_() and check_program_() wait for
+	// the result, and throw on failure.
+	GLuint compile_shader_( 
 		GLenum aShaderType, 
-		char const* aSourcePath
+		std::vector<GLchar> const& aSource
 	);
 
+	void check_shader_( GLuint aShader, GLenum aShaderType, std::vector<std::string> const& aFiles );
+	void check_program_( GLuint aProgram );
+
+#	if !defined(NDEBUG)
+	bool uniform_type_compatible_( GLenum aExpected, GLenum aActual ) noexcept;
+#	endif // ~ !NDEBUG
+
 	// lightweight std::experimental::scope_exit alternative
 	// Not the most complete or convenient implementation...
 	template< typename tFunc >
@@ -37,15 +66,27 @@ namespace
 	}
 }
 
-ShaderProgram::ShaderProgram( std::vector<ShaderSource> aShaderSources )
+ShaderProgram::ShaderProgram( std::vector<ShaderSource> aShaderSources, ProgramBinaryCache* aBinaryCache, BuildMode aBuildMode )
+	: ShaderProgram( std::move(aShaderSources), {}, aBinaryCache, aBuildMode )
+{}
+
+ShaderProgram::ShaderProgram( std::vector<ShaderSource> aShaderSources, std::vector<std::string> aDefines, ProgramBinaryCache* aBinaryCache, BuildMode aBuildMode )
 	: mProgram( 0 )
 	, mSources( std::move(aShaderSources) )
+	, mDefines( std::move(aDefines) )
+	, mBinaryCache( aBinaryCache )
+	, mReloadFailed( false )
 {
-	reload();
+	if( BuildMode::Deferred == aBuildMode )
+		reload_async();
+	else
+		reload();
 }
 
 ShaderProgram::~ShaderProgram()
 {
+	cancel_build_();
+
 	if( 0 != mProgram )
 		glDeleteProgram( mProgram );
 }
@@ -53,11 +94,29 @@ ShaderProgram::~ShaderProgram()
 ShaderProgram::ShaderProgram( ShaderProgram&& aOther ) noexcept
 	: mProgram( std::exchange( aOther.mProgram, 0 ) )
 	, mSources( std::move(aOther.mSources) )
+	, mDefines( std::move(aOther.mDefines) )
+	, mDependencies( std::move(aOther.mDependencies) )
+	, mBinaryCache( std::exchange( aOther.mBinaryCache, nullptr ) )
+	, mPending( std::exchange( aOther.mPending, PendingBuild_{} ) )
+	, mReloadError( std::move(aOther.mReloadError) )
+	, mReloadFailed( std::exchange( aOther.mReloadFailed, false ) )
+	, mUniforms( std::move(aOther.mUniforms) )
+	, mBlocks( std::move(aOther.mBlocks) )
+	, mSlots( std::move(aOther.mSlots) )
 {}
 ShaderProgram& ShaderProgram::operator= (ShaderProgram&& aOther) noexcept
 {
 	std::swap( mProgram, aOther.mProgram );
 	std::swap( mSources, aOther.mSources );
+	std::swap( mDefines, aOther.mDefines );
+	std::swap( mDependencies, aOther.mDependencies );
+	std::swap( mBinaryCache, aOther.mBinaryCache );
+	std::swap( mPending, aOther.mPending );
+	std::swap( mReloadError, aOther.mReloadError );
+	std::swap( mReloadFailed, aOther.mReloadFailed );
+	std::swap( mUniforms, aOther.mUniforms );
+	std::swap( mBlocks, aOther.mBlocks );
+	std::swap( mSlots, aOther.mSlots );
 	return *this;
 }
 
@@ -68,79 +127,375 @@ GLuint ShaderProgram::programId() const noexcept
 
 void ShaderProgram::reload()
 {
-	// Space to hold the shaders when we load them
-	std::vector<GLuint> shaders;
-	shaders.reserve( mSources.size() );
+	begin_build_();
+	finish_build_();
+}
 
-	// Ensure that shaders are cleaned up properly, regardless of how we leave
-	// the function (e.g., either by returning or by exception)
-	auto const scopeShaders_ = scope_exit_( [&shaders] {
-		for( auto const shader : shaders )
-			glDeleteShader( shader );
-	} );
+void ShaderProgram::reload_async()
+{
+	mReloadFailed = false;
+
+	try
+	{
+		begin_build_();
+	}
+	catch( std::exception const& eErr )
+	{
+		// Reported by the next poll_reload() or finish_reload()
+		mReloadError = eErr.what();
+		mReloadFailed = true;
+	}
+}
+
+ShaderProgram::ReloadStatus ShaderProgram::poll_reload()
+{
+	if( std::exchange( mReloadFailed, false ) )
+		return ReloadStatus::Failed;
+
+	if( 0 == mPending.program )
+		return ReloadStatus::Idle;
+
+	// Programs from the binary cache are linked already. Without the
+	// extension, finish_build_() simply waits for the driver.
+	if( !mPending.shaders.empty() && (GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile) )
+	{
+		GLint done = GL_FALSE;
+		glGetProgramiv( mPending.program, GL_COMPLETION_STATUS_KHR, &done );
+
+		if( GL_TRUE != done )
+			return ReloadStatus::Pending;
+	}
+
+	try
+	{
+		finish_build_();
+	}
+	catch( std::exception const& eErr )
+	{
+		mReloadError = eErr.what();
+		return ReloadStatus::Failed;
+	}
+
+	return ReloadStatus::Done;
+}
+
+void ShaderProgram::finish_reload()
+{
+	if( std::exchange( mReloadFailed, false ) )
+		throw Error( "%s", mReloadError.c_str() );
+
+	if( 0 != mPending.program )
+		finish_build_();
+}
 
-	// Load shaders
+std::string const& ShaderProgram::reload_error() const noexcept
+{
+	return mReloadError;
+}
+
+bool ShaderProgram::depends_on( std::string const& aSourcePath ) const noexcept
+{
 	for( auto const& source : mSources )
-		shaders.emplace_back( load_shader_( source.type, source.sourcePath.c_str() ) );
+	{
+		if( source.sourcePath == aSourcePath )
+			return true;
+	}
 
-	// Create program object
-	OGL_CHECKPOINT_ALWAYS();
+	return mDependencies.end() != std::find( mDependencies.begin(), mDependencies.end(), aSourcePath );
+}
+
+void ShaderProgram::set( Uniform<float> aUniform, float aValue ) noexcept
+{
+	glProgramUniform1f( mProgram, location_( aUniform.slot ), aValue );
+}
+void ShaderProgram::set( Uniform<int> aUniform, int aValue ) noexcept
+{
+	glProgramUniform1i( mProgram, location_( aUniform.slot ), aValue );
+}
+void ShaderProgram::set( Uniform<Vec2f> aUniform, Vec2f const& aValue ) noexcept
+{
+	glProgramUniform2fv( mProgram, location_( aUniform.slot ), 1, &aValue.x );
+}
+void ShaderProgram::set( Uniform<Vec3f> aUniform, Vec3f const& aValue ) noexcept
+{
+	glProgramUniform3fv( mProgram, location_( aUniform.slot ), 1, &aValue.x );
+}
+void ShaderProgram::set( Uniform<Vec4f> aUniform, Vec4f const& aValue ) noexcept
+{
+	glProgramUniform4fv( mProgram, location_( aUniform.slot ), 1, &aValue.x );
+}
+void ShaderProgram::set( Uniform<Mat44f> aUniform, Mat44f const& aValue ) noexcept
+{
+	glProgramUniformMatrix4fv( mProgram, location_( aUniform.slot ), 1, GL_TRUE, aValue.v );
+}
 
-	GLuint prog = glCreateProgram();
+std::vector<ShaderProgram::UniformInfo> const& ShaderProgram::uniforms() const noexcept
+{
+	return mUniforms;
+}
+std::vector<ShaderProgram::BlockInfo> const& ShaderProgram::blocks() const noexcept
+{
+	return mBlocks;
+}
+
+ShaderProgram::UniformInfo const* ShaderProgram::find_uniform( char const* aName ) const noexcept
+{
+	for( auto const& uniform : mUniforms )
+	{
+		if( uniform.name == aName )
+			return &uniform;
+	}
 
-	// Ensure that the program is cleaned up. 
+	return nullptr;
+}
+ShaderProgram::BlockInfo const* ShaderProgram::find_block( char const* aName, GLenum aInterface ) const noexcept
+{
+	for( auto const& block : mBlocks )
+	{
+		if( block.programInterface == aInterface && block.name == aName )
+			return &block;
+	}
 
-	/* There is a small trick here. If we successfully compile and link the new
-	 * program, we will replace the value of the "prog" variable with the old
-	 * program's ID. In this case, the following will delete the old program
-	 * (if there was any). If we do not reach the end (e.g. exception thrown),
-	 * the new program ID will still be in the "prog" variable, and we will
-	 * delete it appropriately. (However, the old program in mProgram is left
-	 * intact).
-	 */
-	auto const scopeProgram_ = scope_exit_( [&prog] {
-		if( 0 != prog )
-			glDeleteProgram( prog );
-	} );
+	return nullptr;
+}
 
-	// Link individual shaders to create the final shader program
-	for( auto const shader : shaders )
-		glAttachShader( prog, shader );
+std::uint32_t ShaderProgram::resolve_( char const* aName, GLenum aExpectedType )
+{
+	// Handing out the same slot for repeated requests keeps the slot table
+	// small if the same name is looked up in several places.
+	for( std::size_t i = 0; i < mSlots.size(); ++i )
+	{
+		if( mSlots[i].name == aName && mSlots[i].expectedType == aExpectedType )
+			return std::uint32_t(i);
+	}
+
+	Slot_ slot{ aName, aExpectedType, -1, false };
+	resolve_slot_( slot );
+
+	mSlots.emplace_back( std::move(slot) );
+	return std::uint32_t(mSlots.size()-1);
+}
 
-	glLinkProgram( prog );
+void ShaderProgram::resolve_slot_( Slot_& aSlot )
+{
+	aSlot.location = -1;
+	aSlot.warned = false;
 
+	if( auto const* info = find_uniform( aSlot.name.c_str() ) )
 	{
-		// Get info log
-		GLint logLength = 0;
-		glGetProgramiv( prog, GL_INFO_LOG_LENGTH, &logLength );
+		aSlot.location = info->location;
 
-		std::vector<GLchar> log;
-		if( logLength )
+#		if !defined(NDEBUG)
+		if( !uniform_type_compatible_( aSlot.expectedType, info->type ) )
 		{
-			log.resize( logLength );
-			glGetProgramInfoLog( prog, GLsizei(log.size()), nullptr, log.data() );
+			std::fprintf( stderr, "Warning: uniform \"%s\" is declared with GL type 0x%x, but the handle expects 0x%x\n", aSlot.name.c_str(), info->type, aSlot.expectedType );
 		}
+#		endif // ~ !NDEBUG
+	}
+}
 
-		// Check link status
-		GLint status = 0;
-		glGetProgramiv( prog, GL_LINK_STATUS, &status );
+GLint ShaderProgram::location_( std::uint32_t aSlot ) noexcept
+{
+	if( aSlot >= mSlots.size() )
+		return -1;
 
-		if( GL_TRUE != status )
-			throw Error( "Shader program linking failed: \n%s\n", log.data() );
+	auto& slot = mSlots[aSlot];
 
-		if( !log.empty() )
-			std::fprintf( stderr, "Note: shader program linking log:\n%s\n", log.data() );
+#	if !defined(NDEBUG)
+	// A location of -1 is silently ignored by GL. This typically means that
+	// the uniform was removed from the shader (or optimized out) during a
+	// reload, so point that out once per handle.
+	if( -1 == slot.location && !slot.warned )
+	{
+		std::fprintf( stderr, "Warning: setting uniform \"%s\", which is not active in program %u\n", slot.name.c_str(), mProgram );
+		slot.warned = true;
+	}
+#	endif // ~ !NDEBUG
+
+	return slot.location;
+}
+
+void ShaderProgram::begin_build_()
+{
+	// A new request replaces one that is still in flight
+	cancel_build_();
+
+	// The sources are read even if the program comes from the binary cache,
+	// as they are part of its key.
+	std::vector<std::vector<GLchar>> sources;
+	sources.reserve( mSources.size() );
+
+	mPending.files.resize( mSources.size() );
+	for( std::size_t i = 0; i < mSources.size(); ++i )
+		sources.emplace_back( preprocess_source_( mSources[i].sourcePath, mDefines, mPending.files[i] ) );
+
+	// Kept even if the build fails, so that fixing an included file triggers
+	// a reload through depends_on()
+	mDependencies.clear();
+	for( auto const& files : mPending.files )
+	{
+		for( auto const& file : files )
+		{
+			if( mDependencies.end() == std::find( mDependencies.begin(), mDependencies.end(), file ) )
+				mDependencies.emplace_back( file );
+		}
+	}
+
+	if( mBinaryCache )
+	{
+		mPending.cacheKey = mBinaryCache->driver_key();
+		for( std::size_t i = 0; i < mSources.size(); ++i )
+		{
+			mPending.cacheKey = hash_bytes( &mSources[i].type, sizeof(mSources[i].type), mPending.cacheKey );
+			mPending.cacheKey = hash_bytes( sources[i].data(), sources[i].size(), mPending.cacheKey );
+		}
+
+		mPending.program = mBinaryCache->load( mPending.cacheKey );
+		if( 0 != mPending.program )
+			return;
 	}
-	
+
+	// Issue the compiles and the link without querying any status; with
+	// KHR_parallel_shader_compile, the driver runs them on its own threads.
+	mPending.shaders.reserve( mSources.size() );
+	for( std::size_t i = 0; i < mSources.size(); ++i )
+		mPending.shaders.emplace_back( compile_shader_( mSources[i].type, sources[i] ) );
+
+	mPending.program = glCreateProgram();
+
+	// Must be set before linking for glGetProgramBinary()
+	if( mBinaryCache )
+		glProgramParameteri( mPending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+
+	for( auto const shader : mPending.shaders )
+		glAttachShader( mPending.program, shader );
+
+	glLinkProgram( mPending.program );
+
 	OGL_CHECKPOINT_ALWAYS();
+}
+
+void ShaderProgram::finish_build_()
+{
+	assert( 0 != mPending.program );
+
+	/* There is a small trick here. Once the new program is known to be good,
+	 * we swap it with the old program's ID in mProgram. In this case, the
+	 * following will delete the old program (if there was any). If we do not
+	 * reach the end (e.g. exception thrown), the new program ID will still be
+	 * pending, and we will delete it appropriately. (However, the old program
+	 * in mProgram is left intact).
+	 */
+	auto const scopePending_ = scope_exit_( [this] {
+		cancel_build_();
+	} );
+
+	if( !mPending.shaders.empty() )
+	{
+		// Compile errors are reported before the link error they cause
+		for( std::size_t i = 0; i < mPending.shaders.size(); ++i )
+			check_shader_( mPending.shaders[i], mSources[i].type, mPending.files[i] );
+
+		check_program_( mPending.program );
+
+		if( mBinaryCache )
+			mBinaryCache->store( mPending.cacheKey, mPending.program );
+	}
 
 	// Replace the old shader program (if any) with the new one
-	std::swap( mProgram, prog );
+	std::swap( mProgram, mPending.program );
+
+	// Refresh reflection data and re-resolve any handles that were handed
+	// out for the previous program.
+	reflect_();
+
+	for( auto& slot : mSlots )
+		resolve_slot_( slot );
+}
+
+void ShaderProgram::cancel_build_() noexcept
+{
+	for( auto const shader : mPending.shaders )
+		glDeleteShader( shader );
+
+	if( 0 != mPending.program )
+		glDeleteProgram( mPending.program );
+
+	mPending.program = 0;
+	mPending.shaders.clear();
+	mPending.files.clear();
+	mPending.cacheKey = 0;
+}
+
+void ShaderProgram::reflect_()
+{
+	mUniforms.clear();
+	mBlocks.clear();
+
+	if( 0 == mProgram )
+		return;
+
+	// Default-block uniforms
+	{
+		GLint count = 0, maxNameLength = 0;
+		glGetProgramInterfaceiv( mProgram, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count );
+		glGetProgramInterfaceiv( mProgram, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength );
+
+		std::vector<GLchar> name( std::size_t(maxNameLength) + 1 );
+
+		GLenum const props[] = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX };
+		constexpr GLsizei kPropCount = GLsizei(sizeof(props)/sizeof(props[0]));
+
+		for( GLint i = 0; i < count; ++i )
+		{
+			GLint values[kPropCount]{};
+			glGetProgramResourceiv( mProgram, GL_UNIFORM, GLuint(i), kPropCount, props, kPropCount, nullptr, values );
+
+			// Members of uniform blocks are reported through their block
+			if( -1 != values[3] )
+				continue;
+
+			GLsizei length = 0;
+			glGetProgramResourceName( mProgram, GL_UNIFORM, GLuint(i), GLsizei(name.size()), &length, name.data() );
+
+			std::string uniformName( name.data(), std::size_t(length) );
+			if( auto const pos = uniformName.find( '[' ); std::string::npos != pos )
+				uniformName.resize( pos );
+
+			mUniforms.emplace_back( UniformInfo{ std::move(uniformName), GLenum(values[0]), values[1], values[2] } );
+		}
+	}
+
+	// Uniform blocks and shader storage blocks
+	for( GLenum const blockInterface : { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK } )
+	{
+		GLint count = 0, maxNameLength = 0;
+		glGetProgramInterfaceiv( mProgram, blockInterface, GL_ACTIVE_RESOURCES, &count );
+		glGetProgramInterfaceiv( mProgram, blockInterface, GL_MAX_NAME_LENGTH, &maxNameLength );
+
+		std::vector<GLchar> name( std::size_t(maxNameLength) + 1 );
+
+		GLenum const props[] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+		constexpr GLsizei kPropCount = GLsizei(sizeof(props)/sizeof(props[0]));
+
+		for( GLint i = 0; i < count; ++i )
+		{
+			GLint values[kPropCount]{};
+			glGetProgramResourceiv( mProgram, blockInterface, GLuint(i), kPropCount, props, kPropCount, nullptr, values );
+
+			GLsizei length = 0;
+			glGetProgramResourceName( mProgram, blockInterface, GLuint(i), GLsizei(name.size()), &length, name.data() );
+
+			mBlocks.emplace_back( BlockInfo{ std::string( name.data(), std::size_t(length) ), blockInterface, values[0], values[1] } );
+		}
+	}
+
+	OGL_CHECKPOINT_DEBUG();
 }
 
 namespace
 {
-	GLuint load_shader_( GLenum aShaderType, char const* aSourcePath )
+	std::vector<GLchar> read_source_( char const* aSourcePath )
 	{
 		// Load the shader source code from file
 		std::vector<GLchar> source;
@@ -176,6 +531,83 @@ namespace
 			throw Error( "load_shader_(): unable to open input file '%s'", aSourcePath );
 		}
 
+		return source;
+	}
+
+	void preprocess_file_( std::string const& aSourcePath, std::vector<std::string> const& aDefines, std::vector<std::string>& aFiles, std::string& aOut )
+	{
+		auto const fileIndex = aFiles.size();
+		aFiles.emplace_back( aSourcePath );
+
+		auto const source = read_source_( aSourcePath.c_str() );
+		auto const directory = std::filesystem::path( aSourcePath ).parent_path();
+
+		if( 0 != fileIndex )
+			aOut += "#line 1 " + std::to_string( fileIndex ) + "\n";
+
+		std::size_t lineNumber = 0;
+		for( auto it = source.begin(); it != source.end(); )
+		{
+			auto const eol = std::find( it, source.end(), '\n' );
+			std::string const line( it, eol );
+			it = (source.end() == eol) ? eol : eol+1;
+			++lineNumber;
+
+			// Directives may be indented, and "#  include" is valid too
+			auto directive = line.find_first_not_of( " \t" );
+			if( std::string::npos == directive || '#' != line[directive] )
+			{
+				aOut += line + "\n";
+				continue;
+			}
+
+			directive = line.find_first_not_of( " \t", directive+1 );
+			if( std::string::npos != directive && 0 == line.compare( directive, 7, "version" ) && 0 == fileIndex )
+			{
+				aOut += line + "\n";
+				for( auto const& define : aDefines )
+					aOut += "#define " + define + "\n";
+
+				aOut += "#line " + std::to_string( lineNumber+1 ) + " 0\n";
+			}
+			else if( std::string::npos != directive && 0 == line.compare( directive, 7, "include" ) )
+			{
+				auto const first = line.find( '"', directive+7 );
+				auto const last = std::string::npos == first ? first : line.find( '"', first+1 );
+				if( std::string::npos == last )
+					throw Error( "preprocess_source_(): malformed #include in '%s', line %zu", aSourcePath.c_str(), lineNumber );
+
+				auto const includePath = (directory / line.substr( first+1, last-first-1 )).lexically_normal().generic_string();
+
+				if( aFiles.end() == std::find( aFiles.begin(), aFiles.end(), includePath ) )
+				{
+					preprocess_file_( includePath, aDefines, aFiles, aOut );
+					aOut += "#line " + std::to_string( lineNumber+1 ) + " " + std::to_string( fileIndex ) + "\n";
+				}
+				else
+				{
+					aOut += "\n"; // Already included; keeps the line numbers
+				}
+			}
+			else
+			{
+				aOut += line + "\n";
+			}
+		}
+	}
+
+	std::vector<GLchar> preprocess_source_( std::string const& aSourcePath, std::vector<std::string> const& aDefines, std::vector<std::string>& aFiles )
+	{
+		aFiles.clear();
+
+		std::string out;
+		preprocess_file_( aSourcePath, aDefines, aFiles, out );
+
+		return std::vector<GLchar>( out.begin(), out.end() );
+	}
+
+	GLuint compile_shader_( GLenum aShaderType, std::vector<GLchar> const& aSource )
+	{
 		// Create shader object
 		OGL_CHECKPOINT_ALWAYS();
 
@@ -183,10 +615,10 @@ namespace
 
 		// Compile shader
 		GLchar const* sources[] = {
-			source.data()
+			aSource.data()
 		};
 		GLsizei lengths[] = {
-			GLsizei(source.size())
+			GLsizei(aSource.size())
 		};
 
 		glShaderSource( shader, sizeof(sources)/sizeof(sources[0]), sources, lengths );
@@ -195,19 +627,24 @@ namespace
 
 		OGL_CHECKPOINT_ALWAYS();
 
+		return shader;
+	}
+
+	void check_shader_( GLuint aShader, GLenum aShaderType, std::vector<std::string> const& aFiles )
+	{
 		// Get compile info log
 		/* The compile log is mainly relevant if there is an error. However, on some
 		 * systems, it can include additional information even if compilation was
 		 * successful. This might include warnings and/or usage hints.
 		 */
 		GLint logLength = 0;
-		glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &logLength );
+		glGetShaderiv( aShader, GL_INFO_LOG_LENGTH, &logLength );
 
 		std::vector<GLchar> log;
 		if( logLength )
 		{
 			log.resize( logLength );
-			glGetShaderInfoLog( shader, GLsizei(log.size()), nullptr, log.data() );
+			glGetShaderInfoLog( aShader, GLsizei(log.size()), nullptr, log.data() );
 		}
 
 		char const* shaderTypeName = "unknown shader";
@@ -223,19 +660,73 @@ namespace
 
 		// Check compile status
 		GLint status = 0;
-		glGetShaderiv( shader, GL_COMPILE_STATUS, &status );
+		glGetShaderiv( aShader, GL_COMPILE_STATUS, &status );
+
+		// Logs refer to included files by their source string number
+		std::string files = "\"" + aFiles.front() + "\"";
+		for( std::size_t i = 1; i < aFiles.size(); ++i )
+			files += (1 == i ? " (" : ", ") + std::to_string( i ) + ": \"" + aFiles[i] + "\"" + (aFiles.size()-1 == i ? ")" : "");
 
 		if( GL_TRUE != status )
+			throw Error( "%s %s compilation failed:\n%s\n", shaderTypeName, files.c_str(), log.data() );
+
+		if( !log.empty() )
+			std::fprintf( stderr, "Note: %s %s log:\n%s\n", shaderTypeName, files.c_str(), log.data() );
+
+		OGL_CHECKPOINT_ALWAYS();
+	}
+
+	void check_program_( GLuint aProgram )
+	{
+		// Get info log
+		GLint logLength = 0;
+		glGetProgramiv( aProgram, GL_INFO_LOG_LENGTH, &logLength );
+
+		std::vector<GLchar> log;
+		if( logLength )
 		{
-			glDeleteShader( shader );
-			throw Error( "%s \"%s\" compilation failed:\n%s\n", shaderTypeName, aSourcePath, log.data() );
+			log.resize( logLength );
+			glGetProgramInfoLog( aProgram, GLsizei(log.size()), nullptr, log.data() );
 		}
 
+		// Check link status
+		GLint status = 0;
+		glGetProgramiv( aProgram, GL_LINK_STATUS, &status );
+
+		if( GL_TRUE != status )
+			throw Error( "Shader program linking failed: \n%s\n", log.data() );
+
 		if( !log.empty() )
-			std::fprintf( stderr, "Note: %s \"%s\" log:\n%s\n", shaderTypeName, aSourcePath, log.data() );
+			std::fprintf( stderr, "Note: shader program linking log:\n%s\n", log.data() );
 
 		OGL_CHECKPOINT_ALWAYS();
+	}
 
-		return shader;
+#	if !defined(NDEBUG)
+	bool uniform_type_compatible_( GLenum aExpected, GLenum aActual ) noexcept
+	{
+		if( aExpected == aActual )
+			return true;
+
+		// Integer handles are also used for booleans and sampler units.
+		if( GL_INT == aExpected )
+		{
+			switch( aActual )
+			{
+				case GL_BOOL:
+				case GL_SAMPLER_2D:
+				case GL_SAMPLER_3D:
+				case GL_SAMPLER_CUBE:
+				case GL_SAMPLER_2D_SHADOW:
+				case GL_SAMPLER_2D_ARRAY:
+				case GL_UNSIGNED_INT_SAMPLER_2D:
+				case GL_INT_SAMPLER_2D:
+				case GL_IMAGE_2D:
+					return true;
+			}
+		}
+
+		return false;
 	}
+#	endif // ~ !NDEBUG
 }
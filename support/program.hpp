@@ -9,6 +9,27 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include "../vmlib/vec2.hpp"
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/vec4.hpp"
+#include "../vmlib/mat44.hpp"
+
+class ProgramBinaryCache;
+
+namespace detail
+{
+	// Maps a C++ type to the GL type that a uniform of that type is declared
+	// as in GLSL. Used to sanity-check handles against the reflected program.
+	template< typename tType > struct UniformGLType;
+
+	template<> struct UniformGLType<float> { static constexpr GLenum value = GL_FLOAT; };
+	template<> struct UniformGLType<int> { static constexpr GLenum value = GL_INT; };
+	template<> struct UniformGLType<Vec2f> { static constexpr GLenum value = GL_FLOAT_VEC2; };
+	template<> struct UniformGLType<Vec3f> { static constexpr GLenum value = GL_FLOAT_VEC3; };
+	template<> struct UniformGLType<Vec4f> { static constexpr GLenum value = GL_FLOAT_VEC4; };
+	template<> struct UniformGLType<Mat44f> { static constexpr GLenum value = GL_FLOAT_MAT4; };
+}
+
 class ShaderProgram final
 {
 	public:
@@ -18,9 +39,82 @@ class ShaderProgram final
 			std::string sourcePath;
 		};
 
+		// Active uniforms in the default block, as reported by the
+		// GL_PROGRAM_INTERFACE queries after linking. Uniforms that live in
+		// a uniform/storage block are described by their block instead.
+		struct UniformInfo
+		{
+			std::string name; // Array uniforms without the "[0]" suffix
+			GLenum type;
+			GLint arraySize;
+			GLint location;
+		};
+
+		// Active uniform blocks (GL_UNIFORM_BLOCK) and shader storage blocks
+		// (GL_SHADER_STORAGE_BLOCK).
+		struct BlockInfo
+		{
+			std::string name;
+			GLenum programInterface;
+			GLint binding;
+			GLint dataSize;
+		};
+
+		// With BuildMode::Deferred, the constructor only issues the compile
+		// and link, as reload_async() does.
+		enum class BuildMode
+		{
+			Immediate,
+			Deferred
+		};
+
+		enum class ReloadStatus
+		{
+			Idle,    // Nothing in flight
+			Pending, // Still compiling or linking
+			Done,    // The new program has replaced the old one
+			Failed   // See reload_error(); the old program is kept
+		};
+
+		/* Pre-resolved, typed uniform handle
+		 *
+		 * Handles are obtained once through uniform<T>() and refer to a slot
+		 * inside the ShaderProgram. The slot is re-resolved each time the
+		 * program is reloaded, so handles remain valid across reload().
+		 * Setting a value through a handle never queries the driver by name.
+		 */
+		template< typename tType >
+		struct Uniform
+		{
+			std::uint32_t slot = ~std::uint32_t(0);
+		};
+
 	public:
-		explicit ShaderProgram( 
-			std::vector<ShaderSource> = {}
+		// With a ProgramBinaryCache, reload() loads the linked program from
+		// the cache when the sources are unchanged, and stores it otherwise.
+		// The cache must outlive the ShaderProgram.
+		explicit ShaderProgram(
+			std::vector<ShaderSource> = {},
+			ProgramBinaryCache* = nullptr,
+			BuildMode = BuildMode::Immediate
+		);
+
+		/* Sources are preprocessed before compilation:
+		 *  - Each entry of aDefines ("NAME" or "NAME VALUE") is inserted as a
+		 *    #define directly after the #version line, so the same file can
+		 *    be compiled into specialised variants (see ShaderVariants).
+		 *  - #include "file" is replaced by the contents of that file, relative
+		 *    to the including file, also inside of #if blocks (which then
+		 *    still apply to the included text). Each file is included at most
+		 *    once per stage. The included files use source string numbers 1, 2, ...
+		 *    in compile logs, in the order in which they were first included.
+		 * The binary cache key covers the preprocessed sources.
+		 */
+		ShaderProgram(
+			std::vector<ShaderSource>,
+			std::vector<std::string> aDefines,
+			ProgramBinaryCache* = nullptr,
+			BuildMode = BuildMode::Immediate
 		);
 
 		~ShaderProgram();
@@ -34,11 +128,95 @@ class ShaderProgram final
 	public:
 		GLuint programId() const noexcept;
 
+		// Rebuilds the program and waits for the result. Throws on failure,
+		// in which case the old program is kept.
 		void reload();
 
+		/* Non-blocking rebuild
+		 *
+		 * reload_async() reads the sources and issues the compile and link
+		 * without querying their results. poll_reload() checks on them; with
+		 * GL_KHR_parallel_shader_compile (or the ARB version) it returns
+		 * Pending instead of blocking, so several programs can build on the
+		 * driver's threads while frames keep being rendered with the old
+		 * programs. Without the extension, the first poll waits for the
+		 * driver. finish_reload() always waits, and throws on failure.
+		 *
+		 * A new request replaces a pending one.
+		 */
+		void reload_async();
+		ReloadStatus poll_reload();
+		void finish_reload();
+
+		std::string const& reload_error() const noexcept;
+
+		// Also true for files that are #included by the sources
+		bool depends_on( std::string const& aSourcePath ) const noexcept;
+
+	public:
+		template< typename tType >
+		Uniform<tType> uniform( char const* aName )
+		{
+			return Uniform<tType>{ resolve_( aName, detail::UniformGLType<tType>::value ) };
+		}
+
+		// Set uniform values via glProgramUniform*(). The program does not
+		// need to be bound. Matrices are row-major (see mat44.hpp) and are
+		// transposed on upload.
+		void set( Uniform<float>, float ) noexcept;
+		void set( Uniform<int>, int ) noexcept;
+		void set( Uniform<Vec2f>, Vec2f const& ) noexcept;
+		void set( Uniform<Vec3f>, Vec3f const& ) noexcept;
+		void set( Uniform<Vec4f>, Vec4f const& ) noexcept;
+		void set( Uniform<Mat44f>, Mat44f const& ) noexcept;
+
+		std::vector<UniformInfo> const& uniforms() const noexcept;
+		std::vector<BlockInfo> const& blocks() const noexcept;
+
+		UniformInfo const* find_uniform( char const* ) const noexcept;
+		BlockInfo const* find_block( char const*, GLenum aInterface = GL_UNIFORM_BLOCK ) const noexcept;
+
+	private:
+		struct Slot_
+		{
+			std::string name;
+			GLenum expectedType;
+			GLint location;
+			bool warned;
+		};
+
+		std::uint32_t resolve_( char const*, GLenum );
+		void resolve_slot_( Slot_& );
+		GLint location_( std::uint32_t ) noexcept;
+
+		void begin_build_();
+		void finish_build_();
+		void cancel_build_() noexcept;
+
+		void reflect_();
+
 	private:
+		struct PendingBuild_
+		{
+			GLuint program = 0;
+			std::vector<GLuint> shaders; // Empty if loaded from the cache
+			std::vector<std::vector<std::string>> files; // Per stage, see check_shader_()
+			std::uint64_t cacheKey = 0;
+		};
+
 		GLuint mProgram;
 		std::vector<ShaderSource> mSources;
+		std::vector<std::string> mDefines;
+		std::vector<std::string> mDependencies; // Including #included files
+		ProgramBinaryCache* mBinaryCache;
+
+		PendingBuild_ mPending;
+		std::string mReloadError;
+		bool mReloadFailed;
+
+		std::vector<UniformInfo> mUniforms;
+		std::vector<BlockInfo> mBlocks;
+		std::vector<Slot_> mSlots;
 };
 
 #endif // PROGRAM_HPP_39793FD2_7845_47A7_9E21_6DDAD42C9A09
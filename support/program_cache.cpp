@@ -0,0 +1,230 @@
+#include "program_cache.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include <cstdio>
+#include <cstring>
+
+#include "hash.hpp"
+#include "checkpoint.hpp"
+
+namespace
+{
+	// File layout: FileHeader_, followed by FileHeader_::length bytes of
+	// program binary.
+	constexpr char kMagic_[4] = { 'G', 'L', 'P', 'B' };
+	constexpr std::uint32_t kFileVersion_ = 1;
+
+	struct FileHeader_
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t key;
+		std::uint32_t format;
+		std::uint32_t length;
+	};
+
+	std::uint64_t hash_string_( GLenum aName, std::uint64_t aSeed ) noexcept
+	{
+		auto const* str = reinterpret_cast<char const*>(glGetString( aName ));
+		if( !str )
+			return aSeed;
+
+		// Include the terminator, so that "ab"+"c" and "a"+"bc" differ
+		return hash_bytes( str, std::strlen( str ) + 1, aSeed );
+	}
+}
+
+ProgramBinaryCache::ProgramBinaryCache( std::string aDirectory )
+	: mDirectory( std::move(aDirectory) )
+	, mDriverKey( kFnv1aOffsetBasis )
+	, mEnabled( false )
+	, mStats{}
+{
+	for( GLenum const name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION } )
+		mDriverKey = hash_string_( name, mDriverKey );
+
+	GLint formatCount = 0;
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount );
+	if( formatCount > 0 )
+	{
+		mFormats.resize( std::size_t(formatCount) );
+		glGetIntegerv( GL_PROGRAM_BINARY_FORMATS, mFormats.data() );
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories( mDirectory, ec );
+
+	mEnabled = !mFormats.empty() && !ec;
+
+	if( formatCount > 0 && ec )
+		std::fprintf( stderr, "Note: program binary cache disabled, unable to create '%s': %s\n", mDirectory.c_str(), ec.message().c_str() );
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+bool ProgramBinaryCache::enabled() const noexcept
+{
+	return mEnabled;
+}
+
+std::uint64_t ProgramBinaryCache::driver_key() const noexcept
+{
+	return mDriverKey;
+}
+
+GLuint ProgramBinaryCache::load( std::uint64_t aKey )
+{
+	if( !mEnabled )
+	{
+		++mStats.misses;
+		return 0;
+	}
+
+	auto const path = path_( aKey );
+
+	FileHeader_ header{};
+	std::vector<char> binary;
+
+	{
+		std::FILE* fin = std::fopen( path.c_str(), "rb" );
+		if( !fin )
+		{
+			++mStats.misses;
+			return 0;
+		}
+
+		bool ok = 1 == std::fread( &header, sizeof(header), 1, fin )
+			&& 0 == std::memcmp( header.magic, kMagic_, sizeof(kMagic_) )
+			&& kFileVersion_ == header.version
+			&& aKey == header.key
+		;
+
+		// The length must match the rest of the file before anything is
+		// allocated for it; a damaged header could claim up to 4 GiB.
+		if( ok )
+		{
+			long const start = std::ftell( fin );
+			ok = start >= 0 && 0 == std::fseek( fin, 0, SEEK_END );
+
+			long const end = ok ? std::ftell( fin ) : -1;
+			ok = ok && end >= start && std::uint64_t(end - start) == header.length && 0 == std::fseek( fin, start, SEEK_SET );
+		}
+
+		if( ok )
+		{
+			binary.resize( header.length );
+			ok = header.length > 0 && 1 == std::fread( binary.data(), binary.size(), 1, fin );
+		}
+
+		std::fclose( fin );
+
+		if( !ok )
+		{
+			// Truncated or foreign file; it is rewritten by the next store()
+			++mStats.misses;
+			return 0;
+		}
+	}
+
+	// glProgramBinary() raises GL_INVALID_ENUM for unknown formats, which
+	// the debug output treats as fatal.
+	bool const knownFormat = mFormats.end() != std::find( mFormats.begin(), mFormats.end(), GLint(header.format) );
+
+	GLuint prog = 0;
+	GLint status = GL_FALSE;
+	if( knownFormat )
+	{
+		prog = glCreateProgram();
+		glProgramBinary( prog, GLenum(header.format), binary.data(), GLsizei(binary.size()) );
+		glGetProgramiv( prog, GL_LINK_STATUS, &status );
+	}
+
+	if( GL_TRUE != status )
+	{
+		if( 0 != prog )
+			glDeleteProgram( prog );
+
+		std::error_code ec;
+		std::filesystem::remove( path, ec );
+
+		++mStats.rejected;
+		return 0;
+	}
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	++mStats.hits;
+	return prog;
+}
+
+void ProgramBinaryCache::store( std::uint64_t aKey, GLuint aProgram )
+{
+	if( !mEnabled )
+		return;
+
+	GLint length = 0;
+	glGetProgramiv( aProgram, GL_PROGRAM_BINARY_LENGTH, &length );
+	if( length <= 0 )
+		return;
+
+	std::vector<char> binary( std::size_t(length), 0 );
+
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary( aProgram, length, &written, &format, binary.data() );
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	if( written <= 0 )
+		return;
+
+	FileHeader_ header{};
+	std::memcpy( header.magic, kMagic_, sizeof(kMagic_) );
+	header.version = kFileVersion_;
+	header.key = aKey;
+	header.format = format;
+	header.length = std::uint32_t(written);
+
+	// Write to a temporary file first, so that a crash (or a concurrent
+	// instance) never leaves a partial file under the final name.
+	auto const path = path_( aKey );
+	auto const tempPath = path + ".tmp";
+
+	std::FILE* fout = std::fopen( tempPath.c_str(), "wb" );
+	if( !fout )
+		return;
+
+	bool const ok = 1 == std::fwrite( &header, sizeof(header), 1, fout )
+		&& 1 == std::fwrite( binary.data(), std::size_t(written), 1, fout )
+	;
+
+	bool const closed = 0 == std::fclose( fout );
+
+	std::error_code ec;
+	if( ok && closed )
+		std::filesystem::rename( tempPath, path, ec );
+
+	if( !ok || !closed || ec )
+	{
+		std::filesystem::remove( tempPath, ec );
+		return;
+	}
+
+	++mStats.stores;
+}
+
+ProgramBinaryCache::Stats const& ProgramBinaryCache::stats() const noexcept
+{
+	return mStats;
+}
+
+std::string ProgramBinaryCache::path_( std::uint64_t aKey ) const
+{
+	char name[32];
+	std::snprintf( name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(aKey) );
+	return mDirectory + "/" + name;
+}
@@ -0,0 +1,70 @@
+#ifndef PROGRAM_CACHE_HPP_5A1C9E37_B2D4_4F86_8E03_71C6D94A2B1F
+#define PROGRAM_CACHE_HPP_5A1C9E37_B2D4_4F86_8E03_71C6D94A2B1F
+
+#include <glad.h>
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/* On-disk cache of linked program binaries
+ *
+ * Programs are stored with glGetProgramBinary() in one file per key in
+ * aDirectory, and loaded back with glProgramBinary(). The key is chosen by
+ * the caller (see ShaderProgram), and must cover everything that affects the
+ * compiled program: the shader sources and stage types, and any defines.
+ * driver_key() seeds it with the GL vendor, renderer and version strings,
+ * so that a driver update never loads stale binaries.
+ *
+ * The driver may still reject a binary. load() then deletes the file and
+ * returns 0, and the caller compiles the program from source as usual.
+ *
+ * Without a program binary format (GL_NUM_PROGRAM_BINARY_FORMATS is zero),
+ * or if aDirectory cannot be created, the cache is disabled: load() always
+ * misses, and store() does nothing.
+ */
+class ProgramBinaryCache final
+{
+	public:
+		struct Stats
+		{
+			std::size_t hits;
+			std::size_t misses;
+			std::size_t rejected; // Binaries that the driver refused to load
+			std::size_t stores;
+		};
+
+	public:
+		explicit ProgramBinaryCache( std::string aDirectory );
+
+		ProgramBinaryCache( ProgramBinaryCache const& ) = delete;
+		ProgramBinaryCache& operator= (ProgramBinaryCache const&) = delete;
+
+	public:
+		bool enabled() const noexcept;
+
+		std::uint64_t driver_key() const noexcept;
+
+		// Returns a linked program, or 0. The program is owned by the caller.
+		GLuint load( std::uint64_t aKey );
+
+		// aProgram should be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+		void store( std::uint64_t aKey, GLuint aProgram );
+
+		Stats const& stats() const noexcept;
+
+	private:
+		std::string path_( std::uint64_t ) const;
+
+	private:
+		std::string mDirectory;
+		std::uint64_t mDriverKey;
+		std::vector<GLint> mFormats;
+		bool mEnabled;
+
+		Stats mStats;
+};
+
+#endif // PROGRAM_CACHE_HPP_5A1C9E37_B2D4_4F86_8E03_71C6D94A2B1F
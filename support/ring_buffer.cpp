@@ -0,0 +1,164 @@
+#include "ring_buffer.hpp"
+
+#include <utility>
+
+#include <cassert>
+
+#include "error.hpp"
+#include "checkpoint.hpp"
+
+RingBuffer::RingBuffer( GLsizeiptr aBytesPerFrame, unsigned aFrameCount )
+	: mBuffer( 0 )
+	, mMapped( nullptr )
+	, mSegmentSize( 0 )
+	, mHead( 0 )
+	, mFrameCount( aFrameCount )
+	, mFrame( 0 )
+	, mUniformAlignment( 256 )
+	, mStorageAlignment( 256 )
+	, mFences( aFrameCount, nullptr )
+{
+	assert( aFrameCount > 0 );
+
+	// Persistent mapping requires immutable buffer storage, which is core in
+	// GL 4.4 and available as ARB_buffer_storage on essentially all desktop
+	// drivers that provide GL 4.3.
+	if( !GLAD_GL_VERSION_4_4 && !GLAD_GL_ARB_buffer_storage )
+		throw Error( "RingBuffer: GL 4.4 or ARB_buffer_storage is required for persistent mapping" );
+
+	GLint align = 0;
+	glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align );
+	if( align > 0 )
+		mUniformAlignment = align;
+
+	glGetIntegerv( GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align );
+	if( align > 0 )
+		mStorageAlignment = align;
+
+	// Keep each segment aligned, so that offsets computed relative to the
+	// segment start are also aligned in the buffer.
+	auto const segmentAlign = mUniformAlignment > mStorageAlignment ? mUniformAlignment : mStorageAlignment;
+	mSegmentSize = (aBytesPerFrame + segmentAlign - 1) / segmentAlign * segmentAlign;
+
+	auto const totalSize = mSegmentSize * GLsizeiptr(mFrameCount);
+	GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	OGL_CHECKPOINT_ALWAYS();
+
+	glGenBuffers( 1, &mBuffer );
+	glBindBuffer( GL_COPY_WRITE_BUFFER, mBuffer );
+	glBufferStorage( GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags );
+
+	mMapped = static_cast<std::byte*>(glMapBufferRange( GL_COPY_WRITE_BUFFER, 0, totalSize, flags ));
+	glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+
+	if( !mMapped )
+	{
+		glDeleteBuffers( 1, &mBuffer );
+		throw Error( "RingBuffer: unable to persistently map %lld bytes", (long long)totalSize );
+	}
+
+	OGL_CHECKPOINT_ALWAYS();
+}
+
+RingBuffer::~RingBuffer()
+{
+	for( auto const fence : mFences )
+	{
+		if( fence )
+			glDeleteSync( fence );
+	}
+
+	if( 0 != mBuffer )
+	{
+		// Deleting the buffer implicitly unmaps it.
+		glDeleteBuffers( 1, &mBuffer );
+	}
+}
+
+RingBuffer::RingBuffer( RingBuffer&& aOther ) noexcept
+	: mBuffer( std::exchange( aOther.mBuffer, 0 ) )
+	, mMapped( std::exchange( aOther.mMapped, nullptr ) )
+	, mSegmentSize( aOther.mSegmentSize )
+	, mHead( aOther.mHead )
+	, mFrameCount( aOther.mFrameCount )
+	, mFrame( aOther.mFrame )
+	, mUniformAlignment( aOther.mUniformAlignment )
+	, mStorageAlignment( aOther.mStorageAlignment )
+	, mFences( std::move(aOther.mFences) )
+{}
+RingBuffer& RingBuffer::operator= (RingBuffer&& aOther) noexcept
+{
+	std::swap( mBuffer, aOther.mBuffer );
+	std::swap( mMapped, aOther.mMapped );
+	std::swap( mSegmentSize, aOther.mSegmentSize );
+	std::swap( mHead, aOther.mHead );
+	std::swap( mFrameCount, aOther.mFrameCount );
+	std::swap( mFrame, aOther.mFrame );
+	std::swap( mUniformAlignment, aOther.mUniformAlignment );
+	std::swap( mStorageAlignment, aOther.mStorageAlignment );
+	std::swap( mFences, aOther.mFences );
+	return *this;
+}
+
+GLuint RingBuffer::bufferId() const noexcept
+{
+	return mBuffer;
+}
+
+GLsizeiptr RingBuffer::uniform_alignment() const noexcept
+{
+	return mUniformAlignment;
+}
+GLsizeiptr RingBuffer::storage_alignment() const noexcept
+{
+	return mStorageAlignment;
+}
+
+void RingBuffer::begin_frame()
+{
+	mFrame = (mFrame + 1) % mFrameCount;
+	mHead = 0;
+
+	// Wait until the GPU has finished with the segment we are about to
+	// overwrite. In the steady state, the fence has long been signalled.
+	if( GLsync fence = mFences[mFrame] )
+	{
+		GLbitfield waitFlags = 0;
+		for( ;; )
+		{
+			auto const ret = glClientWaitSync( fence, waitFlags, 1000000 /*ns*/ );
+			if( GL_ALREADY_SIGNALED == ret || GL_CONDITION_SATISFIED == ret )
+				break;
+
+			if( GL_WAIT_FAILED == ret )
+				throw Error( "RingBuffer: glClientWaitSync() failed" );
+
+			// Make sure the fence actually gets submitted before waiting again.
+			waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		}
+
+		glDeleteSync( fence );
+		mFences[mFrame] = nullptr;
+	}
+}
+
+void RingBuffer::end_frame()
+{
+	assert( !mFences[mFrame] );
+	mFences[mFrame] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
+
+RingBuffer::Allocation RingBuffer::allocate( GLsizeiptr aSize, GLsizeiptr aAlignment )
+{
+	assert( aAlignment > 0 );
+
+	auto const offset = (mHead + aAlignment - 1) / aAlignment * aAlignment;
+	if( offset + aSize > mSegmentSize )
+		throw Error( "RingBuffer: frame segment exhausted (%lld of %lld bytes requested)", (long long)(offset + aSize), (long long)mSegmentSize );
+
+	mHead = offset + aSize;
+
+	auto const base = GLintptr(mSegmentSize) * GLintptr(mFrame);
+	return Allocation{ mMapped + base + offset, base + offset, aSize };
+}
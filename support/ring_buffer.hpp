@@ -0,0 +1,96 @@
+#ifndef RING_BUFFER_HPP_0A6C2E51_9B7D_4F3A_8E2C_5D1F7B94C3A8
+#define RING_BUFFER_HPP_0A6C2E51_9B7D_4F3A_8E2C_5D1F7B94C3A8
+
+#include <glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+/* Persistently mapped, fenced ring buffer for per-frame GPU data
+ *
+ * The buffer is created once with immutable storage (glBufferStorage) and
+ * mapped with GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT. It is divided into
+ * aFrameCount equally sized segments; each frame writes into its own segment.
+ * A fence is inserted at the end of each frame, and begin_frame() waits on the
+ * fence of the segment that is about to be reused. With three segments, the
+ * CPU can run up to two frames ahead of the GPU without overwriting data that
+ * is still in use.
+ *
+ * Data is written directly through the pointer returned by allocate(); the
+ * returned offset is then used with glBindBufferRange() (or as a vertex
+ * buffer offset). Nothing needs to be flushed or unmapped.
+ *
+ * Example:
+ *    RingBuffer ring( 1024*1024 );
+ *    ...
+ *    ring.begin_frame();
+ *    auto const frame = ring.allocate( sizeof(FrameUniforms), ring.uniform_alignment() );
+ *    std::memcpy( frame.data, &frameData, sizeof(FrameUniforms) );
+ *    glBindBufferRange( GL_UNIFORM_BUFFER, 0, ring.bufferId(), frame.offset, frame.size );
+ *    ...
+ *    ring.end_frame();
+ */
+class RingBuffer final
+{
+	public:
+		struct Allocation
+		{
+			void* data;
+			GLintptr offset;
+			GLsizeiptr size;
+		};
+
+	public:
+		explicit RingBuffer(
+			GLsizeiptr aBytesPerFrame,
+			unsigned aFrameCount = 3
+		);
+
+		~RingBuffer();
+
+		RingBuffer( RingBuffer const& ) = delete;
+		RingBuffer& operator= (RingBuffer const&) = delete;
+
+		RingBuffer( RingBuffer&& ) noexcept;
+		RingBuffer& operator= (RingBuffer&&) noexcept;
+
+	public:
+		GLuint bufferId() const noexcept;
+
+		// Required offset alignments for glBindBufferRange() with the
+		// respective targets (queried from the driver).
+		GLsizeiptr uniform_alignment() const noexcept;
+		GLsizeiptr storage_alignment() const noexcept;
+
+		void begin_frame();
+		void end_frame();
+
+		Allocation allocate( GLsizeiptr aSize, GLsizeiptr aAlignment );
+
+		template< typename tType >
+		tType* allocate_as( GLsizeiptr aAlignment, GLintptr& aOffset )
+		{
+			auto const alloc = allocate( sizeof(tType), aAlignment );
+			aOffset = alloc.offset;
+			return static_cast<tType*>(alloc.data);
+		}
+
+	private:
+		GLuint mBuffer;
+		std::byte* mMapped;
+
+		GLsizeiptr mSegmentSize;
+		GLsizeiptr mHead;
+
+		unsigned mFrameCount;
+		unsigned mFrame;
+
+		GLsizeiptr mUniformAlignment;
+		GLsizeiptr mStorageAlignment;
+
+		std::vector<GLsync> mFences;
+};
+
+#endif // RING_BUFFER_HPP_0A6C2E51_9B7D_4F3A_8E2C_5D1F7B94C3A8
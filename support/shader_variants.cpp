@@ -0,0 +1,64 @@
+#include "shader_variants.hpp"
+
+#include <tuple>
+#include <utility>
+
+#include <cassert>
+
+#include "error.hpp"
+
+ShaderVariants::ShaderVariants( std::vector<ShaderProgram::ShaderSource> aSources, std::vector<std::string> aFeatureNames, ProgramBinaryCache* aBinaryCache )
+	: mSources( std::move(aSources) )
+	, mFeatureNames( std::move(aFeatureNames) )
+	, mBinaryCache( aBinaryCache )
+{
+	assert( mFeatureNames.size() <= sizeof(Features) * 8 );
+}
+
+ShaderProgram& ShaderVariants::prepare( Features aFeatures )
+{
+	assert( mFeatureNames.size() >= sizeof(Features) * 8 || 0 == (aFeatures >> mFeatureNames.size()) );
+
+	if( auto* program = find( aFeatures ) )
+		return *program;
+
+	std::vector<std::string> defines;
+	defines.reserve( mFeatureNames.size() );
+
+	for( std::size_t i = 0; i < mFeatureNames.size(); ++i )
+		defines.emplace_back( mFeatureNames[i] + ((aFeatures & (Features(1) << i)) ? " 1" : " 0") );
+
+	auto const [it, inserted] = mVariants.emplace(
+		std::piecewise_construct,
+		std::forward_as_tuple( aFeatures ),
+		std::forward_as_tuple( mSources, std::move(defines), mBinaryCache, ShaderProgram::BuildMode::Deferred )
+	);
+
+	assert( inserted );
+	return it->second;
+}
+
+ShaderProgram* ShaderVariants::find( Features aFeatures ) noexcept
+{
+	auto const it = mVariants.find( aFeatures );
+	return mVariants.end() != it ? &it->second : nullptr;
+}
+
+ShaderProgram& ShaderVariants::get( Features aFeatures )
+{
+	if( auto* program = find( aFeatures ) )
+		return *program;
+
+	throw Error( "ShaderVariants::get(): variant 0x%x was not prepared", unsigned(aFeatures) );
+}
+
+std::vector<ShaderProgram*> ShaderVariants::programs()
+{
+	std::vector<ShaderProgram*> ret;
+	ret.reserve( mVariants.size() );
+
+	for( auto& [features, program] : mVariants )
+		ret.emplace_back( &program );
+
+	return ret;
+}
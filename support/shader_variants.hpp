@@ -0,0 +1,59 @@
+#ifndef SHADER_VARIANTS_HPP_6E2F1B94_08C3_4D7A_B5E6_3A9C71D02F58
+#define SHADER_VARIANTS_HPP_6E2F1B94_08C3_4D7A_B5E6_3A9C71D02F58
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include "program.hpp"
+
+/* Compile-time specialised variants of one set of shader sources
+ *
+ * Each variant is a ShaderProgram compiled with one define per feature:
+ * bit i of the Features mask sets aFeatureNames[i] to 1, and a clear bit
+ * sets it to 0. The shaders test the features with #if, so code for
+ * disabled features (and the resources that only it uses) is removed by
+ * the compiler instead of being branched over at run time. Variants go
+ * through the binary cache like any other program.
+ *
+ * Variants are built by prepare(), without waiting for the compile (see
+ * ShaderProgram::BuildMode::Deferred). Looking up a variant that was not
+ * prepared is an error, rather than a compile in the middle of a frame.
+ * References to variants remain valid for the lifetime of the
+ * ShaderVariants.
+ */
+class ShaderVariants final
+{
+	public:
+		using Features = std::uint32_t;
+
+	public:
+		ShaderVariants(
+			std::vector<ShaderProgram::ShaderSource>,
+			std::vector<std::string> aFeatureNames,
+			ProgramBinaryCache* = nullptr
+		);
+
+		ShaderVariants( ShaderVariants const& ) = delete;
+		ShaderVariants& operator= (ShaderVariants const&) = delete;
+
+	public:
+		ShaderProgram& prepare( Features );
+
+		ShaderProgram* find( Features ) noexcept;
+		ShaderProgram& get( Features );
+
+		// All prepared variants, e.g. for reloading
+		std::vector<ShaderProgram*> programs();
+
+	private:
+		std::vector<ShaderProgram::ShaderSource> mSources;
+		std::vector<std::string> mFeatureNames;
+		ProgramBinaryCache* mBinaryCache;
+
+		std::map<Features,ShaderProgram> mVariants;
+};
+
+#endif // SHADER_VARIANTS_HPP_6E2F1B94_08C3_4D7A_B5E6_3A9C71D02F58
@@ -0,0 +1,108 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../vmlib/aabb.hpp"
+
+TEST_CASE("AABB operations", "[aabb]")
+{
+	static constexpr float kEps_ = 1e-6f;
+
+	using namespace Catch::Matchers;
+
+	AABB const unit{ { -1.f, -1.f, -1.f }, { 1.f, 1.f, 1.f } };
+
+	SECTION("Empty")
+	{
+		REQUIRE(is_empty(kEmptyAABB));
+		REQUIRE(!is_empty(unit));
+
+		auto const merged = merge(kEmptyAABB, unit);
+		REQUIRE_THAT(merged.min.x, WithinAbs(-1.f, kEps_));
+		REQUIRE_THAT(merged.max.z, WithinAbs(1.f, kEps_));
+
+		auto const point = expand(kEmptyAABB, Vec3f{ 2.f, 3.f, 4.f });
+		REQUIRE_THAT(point.min.y, WithinAbs(3.f, kEps_));
+		REQUIRE_THAT(point.max.y, WithinAbs(3.f, kEps_));
+	}
+
+	SECTION("Contains")
+	{
+		AABB const small{ { 0.f, 0.f, 0.f }, { 0.5f, 0.5f, 0.5f } };
+		REQUIRE(contains(unit, small));
+		REQUIRE(!contains(small, unit));
+	}
+
+	SECTION("Surface area")
+	{
+		REQUIRE_THAT(surface_area(unit), WithinAbs(24.f, kEps_));
+	}
+
+	SECTION("Distance")
+	{
+		REQUIRE_THAT(distance(unit, Vec3f{ 0.5f, 0.f, 0.f }), WithinAbs(0.f, kEps_));
+		REQUIRE_THAT(distance(unit, Vec3f{ 3.f, 0.f, 0.f }), WithinAbs(2.f, kEps_));
+		REQUIRE_THAT(distance(unit, Vec3f{ 4.f, -5.f, 0.5f }), WithinAbs(5.f, kEps_));
+	}
+
+	SECTION("Transform")
+	{
+		// Rotating by 45 degrees about z grows the box by sqrt(2) in x and y.
+		auto const box = transform(make_translation({ 5.f, 0.f, 0.f }) * make_rotation_z(3.1415926f / 4.f), unit);
+
+		REQUIRE_THAT(box.min.x, WithinAbs(5.f - std::sqrt(2.f), 1e-5f));
+		REQUIRE_THAT(box.max.x, WithinAbs(5.f + std::sqrt(2.f), 1e-5f));
+		REQUIRE_THAT(box.min.y, WithinAbs(-std::sqrt(2.f), 1e-5f));
+		REQUIRE_THAT(box.max.z, WithinAbs(1.f, 1e-5f));
+	}
+}
+
+TEST_CASE("Frustum culling", "[aabb]")
+{
+	// Camera at the origin looking down -z (identity view)
+	auto const proj = make_perspective_projection(
+		60.f * 3.1415926f / 180.f,
+		1280 / float(720),
+		0.1f, 100.f
+	);
+	auto const frustum = make_frustum(proj);
+
+	auto const box_at = [](Vec3f aCenter, float aHalfSize)
+	{
+		Vec3f const h{ aHalfSize, aHalfSize, aHalfSize };
+		return AABB{ aCenter - h, aCenter + h };
+	};
+
+	SECTION("Inside")
+	{
+		REQUIRE(FrustumTest::inside == test(frustum, box_at({ 0.f, 0.f, -10.f }, 1.f)));
+	}
+
+	SECTION("Behind")
+	{
+		REQUIRE(FrustumTest::outside == test(frustum, box_at({ 0.f, 0.f, 10.f }, 1.f)));
+	}
+
+	SECTION("Beside")
+	{
+		REQUIRE(FrustumTest::outside == test(frustum, box_at({ 50.f, 0.f, -10.f }, 1.f)));
+		REQUIRE(FrustumTest::outside == test(frustum, box_at({ 0.f, -50.f, -10.f }, 1.f)));
+	}
+
+	SECTION("Beyond far plane")
+	{
+		REQUIRE(FrustumTest::outside == test(frustum, box_at({ 0.f, 0.f, -200.f }, 1.f)));
+	}
+
+	SECTION("Straddling")
+	{
+		REQUIRE(FrustumTest::intersects == test(frustum, box_at({ 0.f, 0.f, 0.f }, 1.f)));
+		REQUIRE(FrustumTest::intersects == test(frustum, box_at({ 0.f, 0.f, -100.f }, 1.f)));
+	}
+
+	SECTION("View transform")
+	{
+		// Camera moved to z=20, still looking down -z: the box at z=10 is now
+		// in front of it.
+		auto const moved = make_frustum(proj * make_translation({ 0.f, 0.f, -20.f }));
+		REQUIRE(FrustumTest::inside == test(moved, box_at({ 0.f, 0.f, 10.f }, 1.f)));
+	}
+}
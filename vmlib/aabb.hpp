@@ -0,0 +1,178 @@
+#ifndef AABB_HPP_91C3F5E2_6A7D_4B08_B2E4_5D6F17A0C3B8
+#define AABB_HPP_91C3F5E2_6A7D_4B08_B2E4_5D6F17A0C3B8
+
+#include <cmath>
+#include <limits>
+
+#include "vec3.hpp"
+#include "vec4.hpp"
+#include "mat44.hpp"
+
+/** AABB: axis aligned bounding box
+ *
+ * An empty box (kEmptyAABB) has min > max, and absorbs nothing: the union of
+ * an empty box and any box B is B.
+ */
+struct AABB
+{
+	Vec3f min;
+	Vec3f max;
+};
+
+constexpr AABB kEmptyAABB = {
+	{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() },
+	{ -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() }
+};
+
+constexpr
+bool is_empty(AABB const& aBox) noexcept
+{
+	return aBox.min.x > aBox.max.x || aBox.min.y > aBox.max.y || aBox.min.z > aBox.max.z;
+}
+
+inline
+AABB expand(AABB const& aBox, Vec3f aPoint) noexcept
+{
+	return AABB{
+		{ std::fmin(aBox.min.x, aPoint.x), std::fmin(aBox.min.y, aPoint.y), std::fmin(aBox.min.z, aPoint.z) },
+		{ std::fmax(aBox.max.x, aPoint.x), std::fmax(aBox.max.y, aPoint.y), std::fmax(aBox.max.z, aPoint.z) }
+	};
+}
+
+inline
+AABB merge(AABB const& aLeft, AABB const& aRight) noexcept
+{
+	return AABB{
+		{ std::fmin(aLeft.min.x, aRight.min.x), std::fmin(aLeft.min.y, aRight.min.y), std::fmin(aLeft.min.z, aRight.min.z) },
+		{ std::fmax(aLeft.max.x, aRight.max.x), std::fmax(aLeft.max.y, aRight.max.y), std::fmax(aLeft.max.z, aRight.max.z) }
+	};
+}
+
+constexpr
+bool contains(AABB const& aOuter, AABB const& aInner) noexcept
+{
+	return aOuter.min.x <= aInner.min.x && aOuter.min.y <= aInner.min.y && aOuter.min.z <= aInner.min.z
+		&& aOuter.max.x >= aInner.max.x && aOuter.max.y >= aInner.max.y && aOuter.max.z >= aInner.max.z;
+}
+
+// Surface area. Used as the cost metric when building bounding volume
+// hierarchies.
+constexpr
+float surface_area(AABB const& aBox) noexcept
+{
+	auto const d = aBox.max - aBox.min;
+	return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+// Distance from aPoint to the closest point of aBox (zero if inside)
+inline
+float distance(AABB const& aBox, Vec3f aPoint) noexcept
+{
+	Vec3f const d{
+		std::fmax(std::fmax(aBox.min.x - aPoint.x, 0.f), aPoint.x - aBox.max.x),
+		std::fmax(std::fmax(aBox.min.y - aPoint.y, 0.f), aPoint.y - aBox.max.y),
+		std::fmax(std::fmax(aBox.min.z - aPoint.z, 0.f), aPoint.z - aBox.max.z)
+	};
+	return length(d);
+}
+
+// Bounds of aBox after transformation by aTransform (affine only). The
+// result is the tightest AABB around the transformed box, computed without
+// transforming the eight corners (J. Arvo, Graphics Gems, 1990).
+inline
+AABB transform(Mat44f const& aTransform, AABB const& aBox) noexcept
+{
+	if (is_empty(aBox))
+		return aBox;
+
+	AABB ret;
+	for (std::size_t i = 0; i < 3; ++i)
+	{
+		float lo = aTransform(i, 3), hi = aTransform(i, 3);
+		for (std::size_t j = 0; j < 3; ++j)
+		{
+			float const a = aTransform(i, j) * aBox.min[j];
+			float const b = aTransform(i, j) * aBox.max[j];
+			lo += std::fmin(a, b);
+			hi += std::fmax(a, b);
+		}
+
+		ret.min[i] = lo;
+		ret.max[i] = hi;
+	}
+
+	return ret;
+}
+
+
+/** Frustum: six planes, each stored as (nx, ny, nz, d)
+ *
+ * A point p is inside a plane if dot(n, p) + d >= 0. The normals point into
+ * the frustum.
+ */
+struct Frustum
+{
+	Vec4f planes[6]; // left, right, bottom, top, near, far
+};
+
+enum class FrustumTest
+{
+	outside,
+	intersects,
+	inside
+};
+
+// Extracts the planes from a (row-major) projection * view matrix, with
+// OpenGL clip space conventions (-w <= x,y,z <= w). See G. Gribb and
+// K. Hartmann, "Fast Extraction of Viewing Frustum Planes from the
+// World-View-Projection Matrix", 2001.
+inline
+Frustum make_frustum(Mat44f const& aProjView) noexcept
+{
+	auto const row = [&aProjView](std::size_t aI)
+	{
+		return Vec4f{ aProjView(aI, 0), aProjView(aI, 1), aProjView(aI, 2), aProjView(aI, 3) };
+	};
+
+	Vec4f const r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+	Frustum ret{ {
+		r3 + r0, r3 - r0,
+		r3 + r1, r3 - r1,
+		r3 + r2, r3 - r2
+	} };
+
+	for (auto& plane : ret.planes)
+	{
+		float const len = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (len > 0.f)
+			plane = plane / len;
+	}
+
+	return ret;
+}
+
+inline
+FrustumTest test(Frustum const& aFrustum, AABB const& aBox) noexcept
+{
+	auto const center = 0.5f * (aBox.min + aBox.max);
+	auto const extent = 0.5f * (aBox.max - aBox.min);
+
+	auto result = FrustumTest::inside;
+	for (auto const& plane : aFrustum.planes)
+	{
+		// Distance of the box center from the plane and the box's projected
+		// "radius" onto the plane normal.
+		float const d = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float const r = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+
+		if (d + r < 0.f)
+			return FrustumTest::outside;
+		if (d - r < 0.f)
+			result = FrustumTest::intersects;
+	}
+
+	return result;
+}
+
+#endif // AABB_HPP_91C3F5E2_6A7D_4B08_B2E4_5D6F17A0C3B8